@@ -22,6 +22,9 @@ MACRO(VTK_WRAP_HIERARCHY TARGET OUTPUT_DIR SOURCES)
     SET(TMP_INCLUDE "${TMP_INCLUDE}-I ${quote}${INCLUDE_DIR}${quote}\n")
   ENDFOREACH(INCLUDE_DIR ${VTK_INCLUDE_DIRS})
 
+  # the predefined macros are cached in a file that all kits share
+  SET(TMP_INCLUDE "${TMP_INCLUDE}--macros ${quote}${WrapVTK_BINARY_DIR}/vtkWrapHierarchyMacros.bin${quote}\n")
+
   # write wrapper-tool arguments to a file
   STRING(STRIP "${TMP_INCLUDE}" CMAKE_CONFIGURABLE_FILE_CONTENT)
   SET(RESPONSE_FILE ${OUTPUT_DIR}/${TARGET}.args)
@@ -162,6 +165,12 @@ MACRO(VTK_WRAP_HIERARCHY TARGET OUTPUT_DIR SOURCES)
     ENDIF(NOT TMP_KIT_DEPENDS)
   ENDIF(${KIT_TARGET_NAME}_LIB_DEPENDS)
 
+  # the number of threads to use for parsing
+  SET(TMP_THREADS)
+  IF(DEFINED WRAP_NUMBER_OF_THREADS)
+    SET(TMP_THREADS "-j" "${WRAP_NUMBER_OF_THREADS}")
+  ENDIF(DEFINED WRAP_NUMBER_OF_THREADS)
+
   # search for the hierarchy files for dependencies
   SET(OTHER_HIERARCHY_FILES)
   SET(QUOTED_HIERARCHY_FILES)
@@ -189,13 +198,16 @@ MACRO(VTK_WRAP_HIERARCHY TARGET OUTPUT_DIR SOURCES)
   # overwritten if it will changed
     ADD_CUSTOM_COMMAND(
       OUTPUT ${OUTPUT_DIR}/${TARGET}.target ${OUTPUT_DIR}/${TARGET}.txt
+      ${OUTPUT_DIR}/${TARGET}.bin
       DEPENDS ${VTK_WRAP_HIERARCHY_EXE} ${INPUT_FILES}
       ${OTHER_HIERARCHY_FILES}
       ${OUTPUT_DIR}/${TARGET}.data
 
       COMMAND ${VTK_WRAP_HIERARCHY_EXE}
       "${quote}@${RESPONSE_FILE}${quote}"
+      ${TMP_THREADS}
       "-o" "${quote}${OUTPUT_DIR}/${TARGET}.txt${quote}"
+      "--binary" "${quote}${OUTPUT_DIR}/${TARGET}.bin${quote}"
       "${quote}${OUTPUT_DIR}/${TARGET}.data${quote}"
       ${QUOTED_HIERARCHY_FILES}
 
@@ -220,7 +232,9 @@ MACRO(VTK_WRAP_HIERARCHY TARGET OUTPUT_DIR SOURCES)
 
       COMMAND ${VTK_WRAP_HIERARCHY_EXE}
       "${quote}@${RESPONSE_FILE}${quote}"
+      ${TMP_THREADS}
       "-o" "${quote}${OUTPUT_DIR}/${TARGET}.txt${quote}"
+      "--binary" "${quote}${OUTPUT_DIR}/${TARGET}.bin${quote}"
       "${quote}${OUTPUT_DIR}/${TARGET}.data${quote}"
       ${QUOTED_HIERARCHY_FILES}
       COMMENT "Hierarchy Wrapping - generating ${TARGET}.txt"
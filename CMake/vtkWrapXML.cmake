@@ -3,7 +3,7 @@
 #
 # Macro: VTK_WRAP_XML(TARGET, XML_LIST_NAME, OUTPUT_DIR, SOURCES)
 #         TARGET: the name of the kit being wrapped (currently unused)
-#         XML_LIST_NAME: list to add all generated xml filenames to
+#         XML_LIST_NAME: list to add the stamp files for the xml to
 #         OUTPUT_DIR: the generated xml file should go
 #         SOURCES: The header files to wrap, without the ".h"
 #
@@ -12,6 +12,8 @@
 #         KIT_NAME: the name of the kit being wrapped
 #         KIT_HEADER_DIR: the directory for the input files (optional)
 #         WrapVTK_HINTS: the hints file (optional)
+#         WRAP_XML_BATCH: wrap all the headers with one command (optional)
+#         WRAP_NUMBER_OF_THREADS: threads to use in batch mode (optional)
 MACRO(VTK_WRAP_XML TARGET XML_LIST_NAME OUTPUT_DIR SOURCES)
 
   IF(CMAKE_GENERATOR MATCHES "NMake Makefiles")
@@ -28,19 +30,37 @@ MACRO(VTK_WRAP_XML TARGET XML_LIST_NAME OUTPUT_DIR SOURCES)
     SET(TMP_HINTS)
   ENDIF(WrapVTK_HINTS)
 
-  SET(TMP_HIERARCHY "${OUTPUT_DIR}/${KIT_TARGET_NAME}Hierarchy.txt")
+  # the binary hierarchy file is mapped instead of being parsed
+  SET(TMP_HIERARCHY "${OUTPUT_DIR}/${KIT_TARGET_NAME}Hierarchy.bin")
 
   SET(TMP_INCLUDE)
   FOREACH(INCLUDE_DIR ${VTK_INCLUDE_DIRS})
     SET(TMP_INCLUDE "${TMP_INCLUDE}-I ${quote}${INCLUDE_DIR}${quote}\n")
   ENDFOREACH(INCLUDE_DIR ${VTK_INCLUDE_DIRS})
 
+  # the predefined macros are cached in a file that all kits share
+  SET(TMP_INCLUDE "${TMP_INCLUDE}--macros ${quote}${WrapVTK_BINARY_DIR}/vtkWrapXMLMacros.bin${quote}\n")
+
   # write wrapper-tool arguments to a file
   STRING(STRIP "${TMP_INCLUDE}" CMAKE_CONFIGURABLE_FILE_CONTENT)
   SET(RESPONSE_FILE ${OUTPUT_DIR}/${TARGET}.args)
   CONFIGURE_FILE(${CMAKE_ROOT}/Modules/CMakeConfigurableFile.in
                  ${RESPONSE_FILE} @ONLY)
 
+  # vtkWrapXML does not touch xml files that did not change, so each
+  # command also touches a stamp file that the kit target depends on,
+  # and the xml files are byproducts if this cmake supports them
+  IF(CMAKE_VERSION VERSION_LESS 3.2)
+    SET(TMP_USE_BYPRODUCTS 0)
+  ELSE(CMAKE_VERSION VERSION_LESS 3.2)
+    SET(TMP_USE_BYPRODUCTS 1)
+  ENDIF(CMAKE_VERSION VERSION_LESS 3.2)
+
+  # for batch mode, the per-header args and the inputs and outputs
+  SET(TMP_BATCH_CONTENT)
+  SET(TMP_BATCH_INPUTS)
+  SET(TMP_BATCH_OUTPUTS)
+
   FOREACH(INPUT_FILE ${SOURCES})
 
     # in case we were given a path with the class name
@@ -108,10 +128,22 @@ MACRO(VTK_WRAP_XML TARGET XML_LIST_NAME OUTPUT_DIR SOURCES)
       ENDIF(TMP_WRAP_SPECIAL)
 
       SET(TMP_OUTPUT "${OUTPUT_DIR}/${TMP_CLASS}.xml")
-
+      SET(TMP_STAMP "${OUTPUT_DIR}/${TMP_CLASS}.target")
+      SET(TMP_BYPRODUCTS)
+      IF(TMP_USE_BYPRODUCTS)
+        SET(TMP_BYPRODUCTS BYPRODUCTS ${TMP_OUTPUT})
+      ENDIF(TMP_USE_BYPRODUCTS)
+
+      IF(WRAP_XML_BATCH)
+        # add the header to the batch file
+        SET(TMP_BATCH_CONTENT "${TMP_BATCH_CONTENT}${TMP_CONCRETE} ${TMP_SPECIAL} -o \"${TMP_OUTPUT}\" \"${TMP_INPUT}\"\n")
+        SET(TMP_BATCH_INPUTS ${TMP_BATCH_INPUTS} ${TMP_INPUT})
+        SET(TMP_BATCH_OUTPUTS ${TMP_BATCH_OUTPUTS} ${TMP_OUTPUT})
+      ELSE(WRAP_XML_BATCH)
       # add custom command to output
       ADD_CUSTOM_COMMAND(
-        OUTPUT ${TMP_OUTPUT}
+        OUTPUT ${TMP_STAMP}
+        ${TMP_BYPRODUCTS}
         DEPENDS ${VTK_WRAP_XML_EXE} ${WrapVTK_HINTS}
         ${TMP_INPUT} ${TMP_HIERARCHY}
         COMMAND ${VTK_WRAP_XML_EXE}
@@ -123,12 +155,15 @@ MACRO(VTK_WRAP_XML TARGET XML_LIST_NAME OUTPUT_DIR SOURCES)
         "${quote}@${RESPONSE_FILE}${quote}"
         "-o" "${quote}${TMP_OUTPUT}${quote}"
         "${quote}${TMP_INPUT}${quote}"
+        COMMAND ${CMAKE_COMMAND}
+        "-E" "touch" "${quote}${TMP_STAMP}${quote}"
         COMMENT "XML Wrapping - generating ${TMP_CLASS}.xml"
         ${verbatim}
         )
 
-      # add the output to the list
-      SET(${XML_LIST_NAME} ${${XML_LIST_NAME}} ${TMP_OUTPUT})
+      # add the stamp to the list
+      SET(${XML_LIST_NAME} ${${XML_LIST_NAME}} ${TMP_STAMP})
+      ENDIF(WRAP_XML_BATCH)
 
     ENDIF(IGNORE_WRAP_EXCLUDE OR TMP_WRAP_SPECIAL OR NOT TMP_WRAP_EXCLUDE)
 
@@ -139,4 +174,45 @@ MACRO(VTK_WRAP_XML TARGET XML_LIST_NAME OUTPUT_DIR SOURCES)
 
   ENDFOREACH(INPUT_FILE ${SOURCES})
 
+  IF(WRAP_XML_BATCH AND TMP_BATCH_OUTPUTS)
+    # the number of threads to use for parsing
+    SET(TMP_THREADS)
+    IF(DEFINED WRAP_NUMBER_OF_THREADS)
+      SET(TMP_THREADS "-j" "${WRAP_NUMBER_OF_THREADS}")
+    ENDIF(DEFINED WRAP_NUMBER_OF_THREADS)
+
+    # write the per-header args to the batch file
+    SET(CMAKE_CONFIGURABLE_FILE_CONTENT "${TMP_BATCH_CONTENT}")
+    SET(BATCH_FILE ${OUTPUT_DIR}/${TARGET}.batch)
+    CONFIGURE_FILE(${CMAKE_ROOT}/Modules/CMakeConfigurableFile.in
+                   ${BATCH_FILE} @ONLY)
+
+    # add one custom command for all of the outputs
+    SET(TMP_STAMP "${OUTPUT_DIR}/${TARGET}.target")
+    SET(TMP_BYPRODUCTS)
+    IF(TMP_USE_BYPRODUCTS)
+      SET(TMP_BYPRODUCTS BYPRODUCTS ${TMP_BATCH_OUTPUTS})
+    ENDIF(TMP_USE_BYPRODUCTS)
+    ADD_CUSTOM_COMMAND(
+      OUTPUT ${TMP_STAMP}
+      ${TMP_BYPRODUCTS}
+      DEPENDS ${VTK_WRAP_XML_EXE} ${WrapVTK_HINTS}
+      ${TMP_BATCH_INPUTS} ${TMP_HIERARCHY} ${BATCH_FILE}
+      COMMAND ${VTK_WRAP_XML_EXE}
+      ARGS
+      ${TMP_HINTS}
+      "--types" "${quote}${TMP_HIERARCHY}${quote}"
+      "${quote}@${RESPONSE_FILE}${quote}"
+      "--batch" "${quote}${BATCH_FILE}${quote}"
+      ${TMP_THREADS}
+      COMMAND ${CMAKE_COMMAND}
+      "-E" "touch" "${quote}${TMP_STAMP}${quote}"
+      COMMENT "XML Wrapping - generating XML for ${KIT_NAME}"
+      ${verbatim}
+      )
+
+    # add the stamp to the list
+    SET(${XML_LIST_NAME} ${${XML_LIST_NAME}} ${TMP_STAMP})
+  ENDIF(WRAP_XML_BATCH AND TMP_BATCH_OUTPUTS)
+
 ENDMACRO(VTK_WRAP_XML)
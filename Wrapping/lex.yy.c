@@ -163,9 +163,9 @@ typedef struct yy_buffer_state *YY_BUFFER_STATE;
 typedef size_t yy_size_t;
 #endif
 
-extern yy_size_t yyleng;
+extern VTK_PARSE_TLS yy_size_t yyleng;
 
-extern FILE *yyin, *yyout;
+extern VTK_PARSE_TLS FILE *yyin, *yyout;
 
 #define EOB_ACT_CONTINUE_SCAN 0
 #define EOB_ACT_END_OF_FILE 1
@@ -268,9 +268,9 @@ struct yy_buffer_state
 #endif /* !YY_STRUCT_YY_BUFFER_STATE */
 
 /* Stack of input buffers. */
-static size_t yy_buffer_stack_top = 0; /**< index of top of stack. */
-static size_t yy_buffer_stack_max = 0; /**< capacity of stack. */
-static YY_BUFFER_STATE * yy_buffer_stack = 0; /**< Stack as an array. */
+static VTK_PARSE_TLS size_t yy_buffer_stack_top = 0; /**< index of top of stack. */
+static VTK_PARSE_TLS size_t yy_buffer_stack_max = 0; /**< capacity of stack. */
+static VTK_PARSE_TLS YY_BUFFER_STATE * yy_buffer_stack = 0; /**< Stack as an array. */
 
 /* We provide macros for accessing buffer states in case in the
  * future we want to put the buffer states in a more general
@@ -288,19 +288,19 @@ static YY_BUFFER_STATE * yy_buffer_stack = 0; /**< Stack as an array. */
 #define YY_CURRENT_BUFFER_LVALUE (yy_buffer_stack)[(yy_buffer_stack_top)]
 
 /* yy_hold_char holds the character lost when yytext is formed. */
-static char yy_hold_char;
-static yy_size_t yy_n_chars;                /* number of characters read into yy_ch_buf */
-yy_size_t yyleng;
+static VTK_PARSE_TLS char yy_hold_char;
+static VTK_PARSE_TLS yy_size_t yy_n_chars;                /* number of characters read into yy_ch_buf */
+VTK_PARSE_TLS yy_size_t yyleng;
 
 /* Points to current character in buffer. */
-static char *yy_c_buf_p = (char *) 0;
-static int yy_init = 0;                /* whether we need to initialize */
-static int yy_start = 0;        /* start state number */
+static VTK_PARSE_TLS char *yy_c_buf_p = (char *) 0;
+static VTK_PARSE_TLS int yy_init = 0;                /* whether we need to initialize */
+static VTK_PARSE_TLS int yy_start = 0;        /* start state number */
 
 /* Flag which is used to allow yywrap()'s to do buffer switches
  * instead of setting up a fresh yyin.  A bit of a hack ...
  */
-static int yy_did_buffer_switch_on_eof;
+static VTK_PARSE_TLS int yy_did_buffer_switch_on_eof;
 
 void yyrestart (FILE *input_file  );
 void yy_switch_to_buffer (YY_BUFFER_STATE new_buffer  );
@@ -352,15 +352,15 @@ void yyfree (void *  );
 
 typedef unsigned char YY_CHAR;
 
-FILE *yyin = (FILE *) 0, *yyout = (FILE *) 0;
+VTK_PARSE_TLS FILE *yyin = (FILE *) 0, *yyout = (FILE *) 0;
 
 typedef int yy_state_type;
 
-extern int yylineno;
+extern VTK_PARSE_TLS int yylineno;
 
-int yylineno = 1;
+VTK_PARSE_TLS int yylineno = 1;
 
-extern char *yytext;
+extern VTK_PARSE_TLS char *yytext;
 #define yytext_ptr yytext
 
 static yy_state_type yy_get_previous_state (void );
@@ -1930,11 +1930,11 @@ static yyconst flex_int32_t yy_rule_can_match_eol[208] =
     0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
     0, 0, 0, 0, 0, 0, 0, 0,     };
 
-static yy_state_type yy_last_accepting_state;
-static char *yy_last_accepting_cpos;
+static VTK_PARSE_TLS yy_state_type yy_last_accepting_state;
+static VTK_PARSE_TLS char *yy_last_accepting_cpos;
 
-extern int yy_flex_debug;
-int yy_flex_debug = 0;
+extern VTK_PARSE_TLS int yy_flex_debug;
+VTK_PARSE_TLS int yy_flex_debug = 0;
 
 /* The intent behind this definition is that it'll catch
  * any uses of REJECT which flex missed.
@@ -1943,7 +1943,7 @@ int yy_flex_debug = 0;
 #define yymore() yymore_used_but_not_detected
 #define YY_MORE_ADJ 0
 #define YY_RESTORE_YY_MORE_OFFSET
-char *yytext;
+VTK_PARSE_TLS char *yytext;
 #line 1 "vtkParse.l"
 #line 3 "vtkParse.l"
 
@@ -1960,6 +1960,8 @@ Modify lex.yy.c:
   - remove extra space from end of lines
   - remove blank lines from end of file
   - replace "int yyl;" with "yy_size_t yyl;"
+  - add VTK_PARSE_TLS to all of the global and static variables, and to
+    their "extern" declarations, so that each thread has its own lexer
   - compile with gcc and "-Wsign-compare", there should be no warnings
 
 */
@@ -4945,8 +4947,8 @@ int skip_to_next_directive()
  */
 int skip_conditional_block()
 {
-  static char *linebuf = NULL;
-  static size_t linemaxlen = 80;
+  static VTK_PARSE_TLS char *linebuf = NULL;
+  static VTK_PARSE_TLS size_t linemaxlen = 80;
   size_t i;
   int c;
   int result;
@@ -5410,8 +5412,8 @@ const char *raw_string(const char *begin)
 /*
  * buffer stack, used for macro expansion and include files
  */
-static size_t buffer_stack_size = 0;
-static YY_BUFFER_STATE *buffer_stack = NULL;
+static VTK_PARSE_TLS size_t buffer_stack_size = 0;
+static VTK_PARSE_TLS YY_BUFFER_STATE *buffer_stack = NULL;
 
 /*
  * push the current buffer onto the buffer stack.
@@ -5457,9 +5459,9 @@ int pop_buffer()
 /*
  * include stack, to tell what include is being evaluated
  */
-static size_t include_stack_size = 0;
-static FileInfo **include_stack = NULL;
-static int *lineno_stack = NULL;
+static VTK_PARSE_TLS size_t include_stack_size = 0;
+static VTK_PARSE_TLS FileInfo **include_stack = NULL;
+static VTK_PARSE_TLS int *lineno_stack = NULL;
 
 /*
  * push the current include onto the include stack.
@@ -5505,10 +5507,12 @@ void push_include(const char *filename)
     file_info = (FileInfo *)malloc(sizeof(FileInfo));
     vtkParse_InitFile(file_info);
     file_info->FileName = vtkstrdup(filename);
-    file_info->Contents = (NamespaceInfo *)malloc(sizeof(NamespaceInfo));
+    file_info->Contents =
+      (NamespaceInfo *)newStruct(sizeof(NamespaceInfo));
     vtkParse_InitNamespace(file_info->Contents);
     vtkParse_AddIncludeToFile(data, file_info);
     file_info->Strings = data->Strings;
+    file_info->Arena = data->Arena;
     data = file_info;
     currentNamespace = file_info->Contents;
     }
@@ -5536,8 +5540,8 @@ void pop_include()
 /*
  * macro stack, to tell what macro is being evaluated
  */
-static size_t macro_stack_size = 0;
-static MacroInfo **macro_stack = NULL;
+static VTK_PARSE_TLS size_t macro_stack_size = 0;
+static VTK_PARSE_TLS MacroInfo **macro_stack = NULL;
 
 /*
  * push the current macro onto the macro stack.
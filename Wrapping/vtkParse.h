@@ -25,6 +25,36 @@
 #include "vtkParseData.h"
 #include <stdio.h>
 
+/**
+ * Thread-local storage, for the state of the parser.  If the compiler
+ * does not support it, then VTK_PARSE_NO_THREADS will be defined and
+ * only one file can be parsed at a time.
+ */
+#if defined(_MSC_VER) || defined(__BORLANDC__)
+#define VTK_PARSE_TLS __declspec(thread)
+#elif defined(__GNUC__) || defined(__clang__) || defined(__INTEL_COMPILER)
+#define VTK_PARSE_TLS __thread
+#elif defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) && \
+      !defined(__STDC_NO_THREADS__)
+#define VTK_PARSE_TLS _Thread_local
+#else
+#define VTK_PARSE_TLS
+#define VTK_PARSE_NO_THREADS
+#endif
+
+/**
+ * A parser context holds the options for parsing: the include
+ * directories, the macro definitions, and the flags that are set by
+ * vtkParse_SetIgnoreBTX(), vtkParse_SetRecursive(), and
+ * vtkParse_SetMacroCacheFile().
+ */
+typedef struct _vtkParseContext vtkParseContext;
+
+/**
+ * A table of the hints that were read from a hints file.
+ */
+typedef struct _HintTable HintTable;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -64,17 +94,66 @@ void vtkParse_SetIgnoreBTX(int option);
  */
 void vtkParse_SetCommandName(const char *name);
 
+/**
+ * Set a file for saving the macros that are defined before the header
+ * is parsed, i.e. the standard macros and the macros from "-D" and "-U".
+ * If the file exists and was written with the same options, then the
+ * macros are read from the file instead of being defined one-by-one.
+ */
+void vtkParse_SetMacroCacheFile(const char *filename);
+
 /**
  * Parse a header file and return a FileInfo struct
  */
 FileInfo *vtkParse_ParseFile(
   const char *filename, FILE *ifile, FILE *errfile);
 
+/**
+ * Create a parser context that has a copy of the options that were
+ * set with the functions above.  Each thread that parses files must
+ * have its own context.
+ */
+vtkParseContext *vtkParse_NewContext();
+
+/**
+ * Free a parser context.
+ */
+void vtkParse_FreeContext(vtkParseContext *context);
+
+/**
+ * Parse a header file with the options from the given context.
+ * Different threads can parse files at the same time, as long as
+ * they use different contexts.
+ */
+FileInfo *vtkParse_ParseFileWithContext(
+  vtkParseContext *context, const char *filename, FILE *ifile,
+  FILE *errfile);
+
 /**
  * Read a hints file and update the FileInfo
  */
 int vtkParse_ReadHints(FileInfo *data, FILE *hfile, FILE *errfile);
 
+/**
+ * Read a hints file into a table, so that the hints can be applied to
+ * many files without reading the hints file again.  The table is hashed
+ * on the class and method names.  It will exit if there is an error in
+ * the hints file.
+ */
+HintTable *vtkParse_ReadHintTable(FILE *hfile, FILE *errfile);
+
+/**
+ * Apply the hints from the table to the FileInfo.  The table is not
+ * changed, so it can be used by several threads at once.
+ */
+void vtkParse_ApplyHintTable(
+  FileInfo *data, const HintTable *hints, FILE *errfile);
+
+/**
+ * Free a table of hints.
+ */
+void vtkParse_FreeHintTable(HintTable *hints);
+
 /**
  * Free the FileInfo struct returned by vtkParse_ParseFile()
  */
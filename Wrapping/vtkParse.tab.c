@@ -65,6 +65,8 @@ Modify vtkParse.tab.c:
   - convert TABs to spaces (eight per tab)
   - remove spaces from ends of lines, s/ *$//g
   - replace all instances of "static inline" with "static".
+  - add VTK_PARSE_TLS to the definitions of yylval, yychar, yynerrs,
+    and to the "extern YYSTYPE yylval" declaration.
 */
 
 /*
@@ -171,6 +173,7 @@ to the more usual form y x; without parentheses.
 
 #include "vtkParse.h"
 #include "vtkParsePreprocess.h"
+#include "vtkParseThreads.h"
 #include "vtkParseData.h"
 #include "vtkType.h"
 
@@ -232,35 +235,44 @@ enum
 /* the tokenizer */
 int yylex(void);
 
-/* global variables */
-FileInfo      *data = NULL;
-int            parseDebug;
+/* options that can be set by the programs that use the parser */
+struct _vtkParseContext
+{
+  unsigned long  NumberOfIncludeDirectories; /* from "-I" */
+  const char   **IncludeDirectories;
+  unsigned long  NumberOfDefinitions;        /* from "-D" and "-U" */
+  const char   **Definitions;
+  int            IgnoreBTX;
+  int            Recursive;
+  const char    *CommandName;
+  const char    *MacroCacheFile;             /* from "--macros" */
+};
 
-/* the "preprocessor" */
-PreprocessInfo *preprocessor = NULL;
+/* the context for vtkParse_ParseFile(), and for the option setters */
+static vtkParseContext defaultContext = { 0, NULL, 0, NULL, 0, 0, NULL, NULL };
 
-/* include dirs specified on the command line */
-unsigned long  NumberOfIncludeDirectories= 0;
-const char   **IncludeDirectories;
+/* The global variables hold the state of the parser.  They are
+   thread-local, so that each thread can parse its own file. */
+VTK_PARSE_TLS FileInfo      *data = NULL;
+VTK_PARSE_TLS int            parseDebug;
 
-/* macros specified on the command line */
-unsigned long  NumberOfDefinitions = 0;
-const char   **Definitions;
+/* the "preprocessor" */
+VTK_PARSE_TLS PreprocessInfo *preprocessor = NULL;
 
-/* options that can be set by the programs that use the parser */
-int            IgnoreBTX = 0;
-int            Recursive = 0;
-const char    *CommandName = NULL;
+/* options copied from the context at the start of the parse */
+VTK_PARSE_TLS int            IgnoreBTX = 0;
+VTK_PARSE_TLS int            Recursive = 0;
+VTK_PARSE_TLS const char    *CommandName = NULL;
 
 /* various state variables */
-NamespaceInfo *currentNamespace = NULL;
-ClassInfo     *currentClass = NULL;
-FunctionInfo  *currentFunction = NULL;
-TemplateInfo  *currentTemplate = NULL;
-const char    *currentEnumName = NULL;
-const char    *currentEnumValue = NULL;
-unsigned int   currentEnumType = 0;
-parse_access_t access_level = VTK_ACCESS_PUBLIC;
+VTK_PARSE_TLS NamespaceInfo *currentNamespace = NULL;
+VTK_PARSE_TLS ClassInfo     *currentClass = NULL;
+VTK_PARSE_TLS FunctionInfo  *currentFunction = NULL;
+VTK_PARSE_TLS TemplateInfo  *currentTemplate = NULL;
+VTK_PARSE_TLS const char    *currentEnumName = NULL;
+VTK_PARSE_TLS const char    *currentEnumValue = NULL;
+VTK_PARSE_TLS unsigned int   currentEnumType = 0;
+VTK_PARSE_TLS parse_access_t access_level = VTK_ACCESS_PUBLIC;
 
 /* functions from vtkParse.l */
 void print_parser_error(const char *text, const char *cp, size_t n);
@@ -298,7 +310,9 @@ void handle_complex_type(ValueInfo *val, unsigned int datatype,
 void handle_function_type(ValueInfo *param, const char *name,
                           const char *funcSig);
 void handle_attribute(const char *att, int pack);
+#ifndef VTK_PARSE_LEGACY_REMOVE
 void add_legacy_parameter(FunctionInfo *func, ValueInfo *param);
+#endif
 
 void outputSetVectorMacro(const char *var, unsigned int paramType,
                           const char *typeText, unsigned long n);
@@ -331,6 +345,12 @@ static const char *vtkstrdup(const char *in)
   return in;
 }
 
+/* allocate a struct, it will be freed along with the arena */
+static void *newStruct(size_t n)
+{
+  return vtkParse_NewStruct(data->Arena, n);
+}
+
 /* helper function for concatenating strings */
 static const char *vtkstrncat(size_t n, const char **str)
 {
@@ -446,14 +466,14 @@ enum comment_enum
 };
 
 /* "private" variables */
-char          *commentText = NULL;
-size_t         commentLength = 0;
-size_t         commentAllocatedLength = 0;
-int            commentState = 0;
-int            commentMemberGroup = 0;
-int            commentGroupDepth = 0;
-parse_dox_t    commentType = DOX_COMMAND_OTHER;
-const char    *commentTarget = NULL;
+VTK_PARSE_TLS char          *commentText = NULL;
+VTK_PARSE_TLS size_t         commentLength = 0;
+VTK_PARSE_TLS size_t         commentAllocatedLength = 0;
+VTK_PARSE_TLS int            commentState = 0;
+VTK_PARSE_TLS int            commentMemberGroup = 0;
+VTK_PARSE_TLS int            commentGroupDepth = 0;
+VTK_PARSE_TLS parse_dox_t    commentType = DOX_COMMAND_OTHER;
+VTK_PARSE_TLS const char    *commentTarget = NULL;
 
 /* Struct for recognizing certain doxygen commands */
 struct DoxygenCommandInfo
@@ -690,7 +710,7 @@ void addCommentLine(const char *line, size_t n, int type)
 /* Store a doxygen comment */
 void storeComment()
 {
-  CommentInfo *info = (CommentInfo *)malloc(sizeof(CommentInfo));
+  CommentInfo *info = (CommentInfo *)newStruct(sizeof(CommentInfo));
   vtkParse_InitComment(info);
   info->Type = commentType;
   info->Name = commentTarget;
@@ -981,9 +1001,9 @@ void assignComments(ClassInfo *cls)
  */
 
 /* "private" variables */
-const char *macroName = NULL;
-int macroUsed = 0;
-int macroEnded = 0;
+VTK_PARSE_TLS const char *macroName = NULL;
+VTK_PARSE_TLS int macroUsed = 0;
+VTK_PARSE_TLS int macroEnded = 0;
 
 const char *getMacro()
 {
@@ -1003,8 +1023,8 @@ const char *getMacro()
  */
 
 /* "private" variables */
-NamespaceInfo *namespaceStack[10];
-unsigned long namespaceDepth = 0;
+VTK_PARSE_TLS NamespaceInfo *namespaceStack[10];
+VTK_PARSE_TLS unsigned long namespaceDepth = 0;
 
 /* enter a namespace */
 void pushNamespace(const char *name)
@@ -1024,7 +1044,7 @@ void pushNamespace(const char *name)
   /* create a new namespace */
   if (i == oldNamespace->NumberOfNamespaces)
     {
-    currentNamespace = (NamespaceInfo *)malloc(sizeof(NamespaceInfo));
+    currentNamespace = (NamespaceInfo *)newStruct(sizeof(NamespaceInfo));
     vtkParse_InitNamespace(currentNamespace);
     currentNamespace->Name = name;
     vtkParse_AddNamespaceToNamespace(oldNamespace, currentNamespace);
@@ -1047,9 +1067,9 @@ void popNamespace()
  */
 
 /* "private" variables */
-ClassInfo *classStack[10];
-parse_access_t classAccessStack[10];
-unsigned long classDepth = 0;
+VTK_PARSE_TLS ClassInfo *classStack[10];
+VTK_PARSE_TLS parse_access_t classAccessStack[10];
+VTK_PARSE_TLS unsigned long classDepth = 0;
 
 /* start an internal class definition */
 void pushClass()
@@ -1073,23 +1093,20 @@ void popClass()
  */
 
 /* "private" variables */
-TemplateInfo *templateStack[10];
-unsigned long templateDepth = 0;
+VTK_PARSE_TLS TemplateInfo *templateStack[10];
+VTK_PARSE_TLS unsigned long templateDepth = 0;
 
 /* begin a template */
 void startTemplate()
 {
-  currentTemplate = (TemplateInfo *)malloc(sizeof(TemplateInfo));
+  currentTemplate = (TemplateInfo *)newStruct(sizeof(TemplateInfo));
   vtkParse_InitTemplate(currentTemplate);
 }
 
 /* clear a template, if set */
 void clearTemplate()
 {
-  if (currentTemplate)
-    {
-    free(currentTemplate);
-    }
+  /* the template belongs to the arena, so it is not freed */
   currentTemplate = NULL;
 }
 
@@ -1113,12 +1130,12 @@ void popTemplate()
  */
 
 /* "private" variables */
-int sigClosed = 0;
-size_t sigMark[10];
-size_t sigLength = 0;
-size_t sigAllocatedLength = 0;
-unsigned long sigMarkDepth = 0;
-char *signature = NULL;
+VTK_PARSE_TLS int sigClosed = 0;
+VTK_PARSE_TLS size_t sigMark[10];
+VTK_PARSE_TLS size_t sigLength = 0;
+VTK_PARSE_TLS size_t sigAllocatedLength = 0;
+VTK_PARSE_TLS unsigned long sigMarkDepth = 0;
+VTK_PARSE_TLS char *signature = NULL;
 
 /* start a new signature */
 void startSig()
@@ -1314,9 +1331,9 @@ void chopSig(void)
  */
 
 /* "private" variables */
-unsigned int storedType;
-unsigned int typeStack[10];
-unsigned long typeDepth = 0;
+VTK_PARSE_TLS unsigned int storedType;
+VTK_PARSE_TLS unsigned int typeStack[10];
+VTK_PARSE_TLS unsigned long typeDepth = 0;
 
 /* save the type on the stack */
 void pushType()
@@ -1449,8 +1466,8 @@ unsigned int buildTypeBase(unsigned int a, unsigned int b)
  */
 
 /* "private" variables */
-unsigned long numberOfDimensions = 0;
-const char **arrayDimensions = NULL;
+VTK_PARSE_TLS unsigned long numberOfDimensions = 0;
+VTK_PARSE_TLS const char **arrayDimensions = NULL;
 
 /* clear the array counter */
 void clearArray(void)
@@ -1502,9 +1519,9 @@ const char **getArray()
  */
 
 /* "private" variables */
-const char *currentVarName = 0;
-const char *currentVarValue = 0;
-const char *currentId = 0;
+VTK_PARSE_TLS const char *currentVarName = 0;
+VTK_PARSE_TLS const char *currentVarValue = 0;
+VTK_PARSE_TLS const char *currentId = 0;
 
 /* clear the var Id */
 void clearVarName(void)
@@ -1584,8 +1601,8 @@ const char *getTypeId()
  * the function is a method of.
  */
 
-const char *pointerScopeStack[10];
-unsigned long pointerScopeDepth = 0;
+VTK_PARSE_TLS const char *pointerScopeStack[10];
+VTK_PARSE_TLS unsigned long pointerScopeDepth = 0;
 
 /* save the scope for scoped method pointers */
 void scopeSig(const char *scope)
@@ -1614,15 +1631,15 @@ const char *getScope()
  */
 
 /* "private" variables */
-FunctionInfo *functionStack[10] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
-const char *functionVarNameStack[10];
-const char *functionTypeIdStack[10];
-unsigned long functionDepth = 0;
+VTK_PARSE_TLS FunctionInfo *functionStack[10] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+VTK_PARSE_TLS const char *functionVarNameStack[10];
+VTK_PARSE_TLS const char *functionTypeIdStack[10];
+VTK_PARSE_TLS unsigned long functionDepth = 0;
 
 void pushFunction()
 {
   functionStack[functionDepth] = currentFunction;
-  currentFunction = (FunctionInfo *)malloc(sizeof(FunctionInfo));
+  currentFunction = (FunctionInfo *)newStruct(sizeof(FunctionInfo));
   vtkParse_InitFunction(currentFunction);
   if (!functionStack[functionDepth])
     {
@@ -1668,7 +1685,7 @@ FunctionInfo *getFunction()
  * Attributes
  */
 
-int attributeRole = 0;
+VTK_PARSE_TLS int attributeRole = 0;
 
 /* Set kind of attributes to collect in attribute_specifier_seq */
 void setAttributeRole(int x)
@@ -1987,7 +2004,7 @@ union YYSTYPE
 #endif
 
 
-extern YYSTYPE yylval;
+extern VTK_PARSE_TLS YYSTYPE yylval;
 
 int yyparse (void);
 
@@ -5979,10 +5996,10 @@ static const short int yyconfl[] =
 
 
 
-YYSTYPE yylval;
+VTK_PARSE_TLS YYSTYPE yylval;
 
-int yynerrs;
-int yychar;
+VTK_PARSE_TLS int yynerrs;
+VTK_PARSE_TLS int yychar;
 
 static const int YYEOF = 0;
 static const int YYEMPTY = -2;
@@ -6711,7 +6728,7 @@ yyuserAction (yyRuleNum yyn, size_t yyrhslen, yyGLRStackItem* yyvsp,
   case 152:
 #line 2311 "vtkParse.y" /* glr.c:783  */
     {
-      ValueInfo *item = (ValueInfo *)malloc(sizeof(ValueInfo));
+      ValueInfo *item = (ValueInfo *)newStruct(sizeof(ValueInfo));
       vtkParse_InitValue(item);
       item->ItemType = VTK_TYPEDEF_INFO;
       item->Access = access_level;
@@ -6732,7 +6749,7 @@ yyuserAction (yyRuleNum yyn, size_t yyrhslen, yyGLRStackItem* yyvsp,
 
       if (item->TypeName == NULL)
         {
-        vtkParse_FreeValue(item);
+        vtkParse_FreeValueInArena(item, data->Arena);
         }
       else if (currentClass)
         {
@@ -6797,7 +6814,7 @@ yyuserAction (yyRuleNum yyn, size_t yyrhslen, yyGLRStackItem* yyvsp,
   case 162:
 #line 2371 "vtkParse.y" /* glr.c:783  */
     {
-      ValueInfo *item = (ValueInfo *)malloc(sizeof(ValueInfo));
+      ValueInfo *item = (ValueInfo *)newStruct(sizeof(ValueInfo));
       vtkParse_InitValue(item);
       item->ItemType = VTK_TYPEDEF_INFO;
       item->Access = access_level;
@@ -6809,7 +6826,7 @@ yyuserAction (yyRuleNum yyn, size_t yyrhslen, yyGLRStackItem* yyvsp,
 
       if (currentTemplate)
         {
-        vtkParse_FreeValue(item);
+        vtkParse_FreeValueInArena(item, data->Arena);
         }
       else if (currentClass)
         {
@@ -7228,11 +7245,13 @@ yyuserAction (yyRuleNum yyn, size_t yyrhslen, yyGLRStackItem* yyvsp,
   case 264:
 #line 2690 "vtkParse.y" /* glr.c:783  */
     {
-      ValueInfo *param = (ValueInfo *)malloc(sizeof(ValueInfo));
+      ValueInfo *param = (ValueInfo *)newStruct(sizeof(ValueInfo));
       vtkParse_InitValue(param);
 
       handle_complex_type(param, getType(), (((yyGLRStackItem const *)yyvsp)[YYFILL (0)].yystate.yysemantics.yysval.integer), copySig());
+#ifndef VTK_PARSE_LEGACY_REMOVE
       add_legacy_parameter(currentFunction, param);
+#endif
 
       if (getVarName())
         {
@@ -7314,7 +7333,7 @@ yyuserAction (yyRuleNum yyn, size_t yyrhslen, yyGLRStackItem* yyvsp,
 #line 2740 "vtkParse.y" /* glr.c:783  */
     {
       unsigned int type = getType();
-      ValueInfo *var = (ValueInfo *)malloc(sizeof(ValueInfo));
+      ValueInfo *var = (ValueInfo *)newStruct(sizeof(ValueInfo));
       vtkParse_InitValue(var);
       var->ItemType = VTK_VARIABLE_INFO;
       var->Access = access_level;
@@ -7341,7 +7360,7 @@ yyuserAction (yyRuleNum yyn, size_t yyrhslen, yyGLRStackItem* yyvsp,
         var->ItemType = VTK_TYPEDEF_INFO;
         if (var->TypeName == NULL)
           {
-          vtkParse_FreeValue(var);
+          vtkParse_FreeValueInArena(var, data->Arena);
           }
         else if (currentClass)
           {
@@ -11437,7 +11456,7 @@ void start_class(const char *classname, int is_struct_or_union)
 {
   ClassInfo *outerClass = currentClass;
   pushClass();
-  currentClass = (ClassInfo *)malloc(sizeof(ClassInfo));
+  currentClass = (ClassInfo *)newStruct(sizeof(ClassInfo));
   vtkParse_InitClass(currentClass);
   currentClass->Name = classname;
   if (is_struct_or_union == 1)
@@ -11511,7 +11530,7 @@ void add_using(const char *name, int is_namespace)
   size_t i;
   UsingInfo *item;
 
-  item = (UsingInfo *)malloc(sizeof(UsingInfo));
+  item = (UsingInfo *)newStruct(sizeof(UsingInfo));
   vtkParse_InitUsing(item);
   if (is_namespace)
     {
@@ -11555,7 +11574,7 @@ void start_enum(const char *name, int is_scoped,
   if (name)
     {
     currentEnumName = name;
-    item = (EnumInfo *)malloc(sizeof(EnumInfo));
+    item = (EnumInfo *)newStruct(sizeof(EnumInfo));
     vtkParse_InitEnum(item);
     item->Name = name;
     item->Comment = vtkstrdup(getComment());
@@ -11600,7 +11619,7 @@ void end_enum()
 /* add a constant to the enum */
 void add_enum(const char *name, const char *value)
 {
-  static char text[2048];
+  static VTK_PARSE_TLS char text[2048];
   unsigned long i;
   long j;
 
@@ -11838,7 +11857,7 @@ unsigned int guess_constant_type(const char *valstring)
 void add_constant(const char *name, const char *value,
                   unsigned int type, const char *typeclass, int flag)
 {
-  ValueInfo *con = (ValueInfo *)malloc(sizeof(ValueInfo));
+  ValueInfo *con = (ValueInfo *)newStruct(sizeof(ValueInfo));
   vtkParse_InitValue(con);
   con->ItemType = VTK_CONSTANT_INFO;
   con->Name = name;
@@ -11879,7 +11898,7 @@ void add_constant(const char *name, const char *value,
       }
     else
       {
-      vtkParse_FreeValue(con);
+      vtkParse_FreeValueInArena(con, data->Arena);
       }
     }
   else if (currentClass)
@@ -11897,7 +11916,7 @@ void add_constant(const char *name, const char *value,
 /* if the name is a const in this namespace, the scope it */
 const char *add_const_scope(const char *name)
 {
-  static char text[256];
+  static VTK_PARSE_TLS char text[256];
   NamespaceInfo *scope = currentNamespace;
   unsigned long i, j;
   int addscope = 0;
@@ -11989,7 +12008,7 @@ unsigned int guess_id_type(const char *cp)
 void add_template_parameter(
   unsigned int datatype, unsigned int extra, const char *funcSig)
 {
-  ValueInfo *param = (ValueInfo *)malloc(sizeof(ValueInfo));
+  ValueInfo *param = (ValueInfo *)newStruct(sizeof(ValueInfo));
   vtkParse_InitValue(param);
   handle_complex_type(param, datatype, extra, funcSig);
   param->Name = getVarName();
@@ -12001,7 +12020,7 @@ void add_parameter(FunctionInfo *func, unsigned int type,
                    const char *typeclass, unsigned long count)
 {
   char text[64];
-  ValueInfo *param = (ValueInfo *)malloc(sizeof(ValueInfo));
+  ValueInfo *param = (ValueInfo *)newStruct(sizeof(ValueInfo));
   vtkParse_InitValue(param);
 
   param->Type = type;
@@ -12015,7 +12034,9 @@ void add_parameter(FunctionInfo *func, unsigned int type,
                               vtkstrdup(text));
     }
 
+#ifndef VTK_PARSE_LEGACY_REMOVE
   add_legacy_parameter(func, param);
+#endif
 
   vtkParse_AddParameterToFunction(func, param);
 }
@@ -12025,7 +12046,7 @@ void set_return(FunctionInfo *func, unsigned int type,
                 const char *typeclass, unsigned long count)
 {
   char text[64];
-  ValueInfo *val = (ValueInfo *)malloc(sizeof(ValueInfo));
+  ValueInfo *val = (ValueInfo *)newStruct(sizeof(ValueInfo));
 
   vtkParse_InitValue(val);
   val->Type = type;
@@ -12102,7 +12123,7 @@ void handle_complex_type(
     {
     /* the current type becomes the function return type */
     func = getFunction();
-    func->ReturnValue = (ValueInfo *)malloc(sizeof(ValueInfo));
+    func->ReturnValue = (ValueInfo *)newStruct(sizeof(ValueInfo));
     vtkParse_InitValue(func->ReturnValue);
     func->ReturnValue->Type = datatype;
     func->ReturnValue->TypeName = type_class(datatype, getTypeId());
@@ -12235,10 +12256,10 @@ void handle_attribute(const char *att, int pack)
     }
 }
 
+#ifndef VTK_PARSE_LEGACY_REMOVE
 /* add a parameter to the legacy part of the FunctionInfo struct */
 void add_legacy_parameter(FunctionInfo *func, ValueInfo *param)
 {
-#ifndef VTK_PARSE_LEGACY_REMOVE
   unsigned long i = func->NumberOfArguments;
 
   if (i < MAX_ARGS)
@@ -12265,8 +12286,8 @@ void add_legacy_parameter(FunctionInfo *func, ValueInfo *param)
     {
     func->ArrayFailure = 1;
     }
-#endif
 }
+#endif
 
 
 /* reject the function, do not output it */
@@ -12311,7 +12332,7 @@ void output_function()
   if (currentFunction->ReturnValue &&
       currentFunction->ReturnValue->Type & VTK_PARSE_TYPEDEF)
     {
-    ValueInfo *item = (ValueInfo *)malloc(sizeof(ValueInfo));
+    ValueInfo *item = (ValueInfo *)newStruct(sizeof(ValueInfo));
     vtkParse_InitValue(item);
     item->ItemType = VTK_TYPEDEF_INFO;
     item->Access = access_level;
@@ -12332,7 +12353,7 @@ void output_function()
       vtkParse_AddTypedefToNamespace(currentNamespace, item);
       }
 
-    currentFunction = (FunctionInfo *)malloc(sizeof(FunctionInfo));
+    currentFunction = (FunctionInfo *)newStruct(sizeof(FunctionInfo));
     reject_function();
     return;
     }
@@ -12465,7 +12486,7 @@ void output_function()
     currentFunction->Class = currentClass->Name;
     vtkParse_AddFunctionToClass(currentClass, currentFunction);
 
-    currentFunction = (FunctionInfo *)malloc(sizeof(FunctionInfo));
+    currentFunction = (FunctionInfo *)newStruct(sizeof(FunctionInfo));
     }
   else
     {
@@ -12506,7 +12527,7 @@ void output_function()
       {
       vtkParse_AddFunctionToNamespace(currentNamespace, currentFunction);
 
-      currentFunction = (FunctionInfo *)malloc(sizeof(FunctionInfo));
+      currentFunction = (FunctionInfo *)newStruct(sizeof(FunctionInfo));
       }
     }
 
@@ -12594,11 +12615,11 @@ void vtkParse_SetIgnoreBTX(int option)
 {
   if (option)
     {
-    IgnoreBTX = 1;
+    defaultContext.IgnoreBTX = 1;
     }
   else
     {
-    IgnoreBTX = 0;
+    defaultContext.IgnoreBTX = 0;
     }
 }
 
@@ -12607,93 +12628,293 @@ void vtkParse_SetRecursive(int option)
 {
   if (option)
     {
-    Recursive = 1;
+    defaultContext.Recursive = 1;
     }
   else
     {
-    Recursive = 0;
+    defaultContext.Recursive = 0;
     }
 }
 
 /* Set the global variable that stores the current executable */
 void vtkParse_SetCommandName(const char *name)
 {
-  CommandName = name;
+  defaultContext.CommandName = name;
+}
+
+/* Set the file for saving the macros that are defined before parsing */
+void vtkParse_SetMacroCacheFile(const char *filename)
+{
+  defaultContext.MacroCacheFile = filename;
+}
+
+/* Make a key that describes the options that define the macros */
+static char *macroCacheKey(vtkParseContext *context)
+{
+  unsigned long i;
+  size_t n = 1;
+  char *key;
+
+  for (i = 0; i < context->NumberOfDefinitions; i++)
+    {
+    n += strlen(context->Definitions[i]) + 1;
+    }
+#ifdef VTK_USE_64BIT_IDS
+  n += 18;
+#endif
+
+  key = (char *)malloc(n);
+  key[0] = '\0';
+  for (i = 0; i < context->NumberOfDefinitions; i++)
+    {
+    strcat(key, context->Definitions[i]);
+    strcat(key, "\n");
+    }
+#ifdef VTK_USE_64BIT_IDS
+  strcat(key, "VTK_USE_64BIT_IDS\n");
+#endif
+
+  return key;
+}
+
+/* The macros for each set of options.  These are shared by all threads,
+   are guarded by the global mutex, and are kept until the process ends. */
+typedef struct _MacroSet
+{
+  char             *Key;
+  PreprocessInfo   *Macros;
+  struct _MacroSet *Next;
+} MacroSet;
+
+static MacroSet *macroSets = NULL;
+
+/* Read or define the macros for the options in the context */
+static PreprocessInfo *defineMacros(vtkParseContext *context, const char *key)
+{
+  PreprocessInfo *macros;
+  unsigned long i;
+
+  macros = (PreprocessInfo *)malloc(sizeof(PreprocessInfo));
+  vtkParsePreprocess_Init(macros, NULL);
+  macros->Strings = (StringCache *)malloc(sizeof(StringCache));
+  vtkParse_InitStringCache(macros->Strings);
+
+  /* read the macros from the cache, if it was made with the same options */
+  if (context->MacroCacheFile == NULL || vtkParsePreprocess_ReadMacros(
+        macros, context->MacroCacheFile, key) != VTK_PARSE_OK)
+    {
+    vtkParsePreprocess_AddStandardMacros(macros, VTK_PARSE_NATIVE);
+
+    /* add macros specified on the command line */
+    for (i = 0; i < context->NumberOfDefinitions; i++)
+      {
+      const char *cp = context->Definitions[i];
+
+      if (*cp == 'U')
+        {
+        vtkParsePreprocess_RemoveMacro(macros, &cp[1]);
+        }
+      else if (*cp == 'D')
+        {
+        const char *definition = &cp[1];
+        while (*definition != '=' && *definition != '\0')
+          {
+          definition++;
+          }
+        if (*definition == '=')
+          {
+          definition++;
+          }
+        else
+          {
+          definition = NULL;
+          }
+        vtkParsePreprocess_AddMacro(macros, &cp[1], definition);
+        }
+      }
+
+    /* should explicitly check for vtkConfigure.h, or even load it */
+#ifdef VTK_USE_64BIT_IDS
+    vtkParsePreprocess_AddMacro(macros, "VTK_USE_64BIT_IDS", NULL);
+#endif
+
+    /* save the macros so that the next process can read them */
+    if (context->MacroCacheFile)
+      {
+      vtkParsePreprocess_WriteMacros(
+        macros, context->MacroCacheFile, key);
+      }
+    }
+
+  return macros;
+}
+
+/* Get the macros for the context, they are only read or defined once */
+static PreprocessInfo *getMacros(vtkParseContext *context)
+{
+  MacroSet *entry;
+  MacroSet *other;
+  char *key;
+
+  key = macroCacheKey(context);
+
+  vtkParseThreads_LockGlobal();
+  for (entry = macroSets; entry != NULL; entry = entry->Next)
+    {
+    if (strcmp(entry->Key, key) == 0)
+      {
+      break;
+      }
+    }
+  vtkParseThreads_UnlockGlobal();
+
+  if (entry)
+    {
+    free(key);
+    return entry->Macros;
+    }
+
+  entry = (MacroSet *)malloc(sizeof(MacroSet));
+  entry->Key = key;
+  entry->Macros = defineMacros(context, key);
+
+  /* another thread might have defined the same macros in the meantime */
+  vtkParseThreads_LockGlobal();
+  for (other = macroSets; other != NULL; other = other->Next)
+    {
+    if (strcmp(other->Key, key) == 0)
+      {
+      break;
+      }
+    }
+  if (other == NULL)
+    {
+    entry->Next = macroSets;
+    macroSets = entry;
+    }
+  vtkParseThreads_UnlockGlobal();
+
+  if (other)
+    {
+    vtkParse_FreeStringCache(entry->Macros->Strings);
+    free(entry->Macros->Strings);
+    vtkParsePreprocess_Free(entry->Macros);
+    free(entry->Key);
+    free(entry);
+    entry = other;
+    }
+
+  return entry->Macros;
+}
+
+/* Create a context with a copy of the options */
+vtkParseContext *vtkParse_NewContext()
+{
+  vtkParseContext *context;
+  unsigned long i;
+
+  context = (vtkParseContext *)malloc(sizeof(vtkParseContext));
+  context->NumberOfIncludeDirectories = 0;
+  context->IncludeDirectories = NULL;
+  context->NumberOfDefinitions = 0;
+  context->Definitions = NULL;
+  context->IgnoreBTX = defaultContext.IgnoreBTX;
+  context->Recursive = defaultContext.Recursive;
+  context->CommandName = defaultContext.CommandName;
+  context->MacroCacheFile = defaultContext.MacroCacheFile;
+
+  /* the strings are shared, they are never freed */
+  for (i = 0; i < defaultContext.NumberOfIncludeDirectories; i++)
+    {
+    vtkParse_AddStringToArray(
+      &context->IncludeDirectories, &context->NumberOfIncludeDirectories,
+      defaultContext.IncludeDirectories[i]);
+    }
+  for (i = 0; i < defaultContext.NumberOfDefinitions; i++)
+    {
+    vtkParse_AddStringToArray(
+      &context->Definitions, &context->NumberOfDefinitions,
+      defaultContext.Definitions[i]);
+    }
+
+  return context;
+}
+
+/* Free a context that was created with vtkParse_NewContext() */
+void vtkParse_FreeContext(vtkParseContext *context)
+{
+  free((char **)context->IncludeDirectories);
+  free((char **)context->Definitions);
+  free(context);
 }
 
 /* Parse a header file and return a FileInfo struct */
 FileInfo *vtkParse_ParseFile(
   const char *filename, FILE *ifile, FILE *errfile)
+{
+  return vtkParse_ParseFileWithContext(
+    &defaultContext, filename, ifile, errfile);
+}
+
+/* Parse a header file with the options from the context */
+FileInfo *vtkParse_ParseFileWithContext(
+  vtkParseContext *context, const char *filename, FILE *ifile,
+  FILE *errfile)
 {
   unsigned long i, j;
   int ret;
   FileInfo *file_info;
   char *main_class;
+  FileBuffer contents;
+
+  /* read the whole file into a buffer for the lexer */
+  if (vtkParsePreprocess_LoadFile(&contents, ifile, 2) != VTK_PARSE_OK)
+    {
+    fprintf(errfile, "Error reading file %s\n", filename);
+    return NULL;
+    }
+
+  /* copy the options that are used by the lexer */
+  IgnoreBTX = context->IgnoreBTX;
+  Recursive = context->Recursive;
+  CommandName = context->CommandName;
 
   /* "data" is a global variable used by the parser */
   data = (FileInfo *)malloc(sizeof(FileInfo));
   vtkParse_InitFile(data);
   data->Strings = (StringCache *)malloc(sizeof(StringCache));
-  vtkParse_InitStringCache(data->Strings);
+  vtkParse_InitInternedStringCache(data->Strings);
+  data->Arena = (ParseArena *)malloc(sizeof(ParseArena));
+  vtkParse_InitArena(data->Arena);
 
   /* "preprocessor" is a global struct used by the parser */
   preprocessor = (PreprocessInfo *)malloc(sizeof(PreprocessInfo));
   vtkParsePreprocess_Init(preprocessor, filename);
   preprocessor->Strings = data->Strings;
-  vtkParsePreprocess_AddStandardMacros(preprocessor, VTK_PARSE_NATIVE);
 
   /* add include files specified on the command line */
-  for (i = 0; i < NumberOfIncludeDirectories; i++)
+  for (i = 0; i < context->NumberOfIncludeDirectories; i++)
     {
-    vtkParsePreprocess_IncludeDirectory(preprocessor, IncludeDirectories[i]);
+    vtkParsePreprocess_IncludeDirectory(
+      preprocessor, context->IncludeDirectories[i]);
     }
 
-  /* add macros specified on the command line */
-  for (i = 0; i < NumberOfDefinitions; i++)
-    {
-    const char *cp = Definitions[i];
-
-    if (*cp == 'U')
-      {
-      vtkParsePreprocess_RemoveMacro(preprocessor, &cp[1]);
-      }
-    else if (*cp == 'D')
-      {
-      const char *definition = &cp[1];
-      while (*definition != '=' && *definition != '\0')
-        {
-        definition++;
-        }
-      if (*definition == '=')
-        {
-        definition++;
-        }
-      else
-        {
-        definition = NULL;
-        }
-      vtkParsePreprocess_AddMacro(preprocessor, &cp[1], definition);
-      }
-    }
-
-  /* should explicitly check for vtkConfigure.h, or even explicitly load it */
-#ifdef VTK_USE_64BIT_IDS
-  vtkParsePreprocess_AddMacro(preprocessor, "VTK_USE_64BIT_IDS", NULL);
-#endif
+  /* copy the macros, which are defined once for each set of options */
+  vtkParsePreprocess_CopyMacros(preprocessor, getMacros(context));
 
   data->FileName = vtkstrdup(filename);
 
   clearComment();
 
   namespaceDepth = 0;
-  currentNamespace = (NamespaceInfo *)malloc(sizeof(NamespaceInfo));
+  currentNamespace = (NamespaceInfo *)newStruct(sizeof(NamespaceInfo));
   vtkParse_InitNamespace(currentNamespace);
   data->Contents = currentNamespace;
 
   templateDepth = 0;
   currentTemplate = NULL;
 
-  currentFunction = (FunctionInfo *)malloc(sizeof(FunctionInfo));
+  currentFunction = (FunctionInfo *)newStruct(sizeof(FunctionInfo));
   vtkParse_InitFunction(currentFunction);
   startSig();
 
@@ -12703,17 +12924,20 @@ FileInfo *vtkParse_ParseFile(
     parseDebug = 1;
     }
 
-  yyset_in(ifile);
+  /* the lexer scans the buffer in place, the last two bytes of the
+   * padding are the end-of-buffer marks that it requires */
+  yy_scan_buffer(contents.Data, contents.Size + 2);
   yyset_out(errfile);
   ret = yyparse();
 
+  yylex_destroy();
+  vtkParsePreprocess_UnloadFile(&contents);
+
   if (ret)
     {
     return NULL;
     }
 
-  free(currentFunction);
-  yylex_destroy();
 
   /* The main class name should match the file name */
   i = strlen(filename);
@@ -12759,25 +12983,96 @@ FileInfo *vtkParse_ParseFile(
   return file_info;
 }
 
-/* Read a hints file and update the FileInfo */
-int vtkParse_ReadHints(FileInfo *file_info, FILE *hfile, FILE *errfile)
+/* A hint from the hints file, for the return value of a method */
+typedef struct _HintInfo
+{
+  const char    *ClassName;
+  const char    *FunctionName;
+  unsigned int   Type;
+  unsigned long  Value;
+  unsigned long  Next;     /* next hint for the same method, plus one */
+} HintInfo;
+
+/* The hints from a hints file, with a hash table that is keyed on the
+ * class and method names.  Each slot holds the first hint for a method
+ * (plus one, so that zero is an empty slot), and the other hints for
+ * that method are chained through "Next" in the order they were read. */
+struct _HintTable
+{
+  unsigned long  NumberOfHints;
+  HintInfo      *Hints;
+  unsigned long  HashTableSize;  /* a power of two */
+  unsigned long *HashTable;
+  StringCache    Strings;
+};
+
+/* Hash the class and method names together */
+static unsigned int hint_hash(const char *classname, const char *funcname)
+{
+  unsigned int h = 5381;
+  const char *cp;
+
+  for (cp = classname; *cp != '\0'; cp++)
+    {
+    h = ((h << 5) + h) ^ (unsigned char)*cp;
+    }
+
+  /* hash a separator, so that "ab","c" differs from "a","bc" */
+  h = ((h << 5) + h) ^ ':';
+
+  for (cp = funcname; *cp != '\0'; cp++)
+    {
+    h = ((h << 5) + h) ^ (unsigned char)*cp;
+    }
+
+  return h;
+}
+
+/* Find the hash table slot for a method, the slot is empty if the
+ * method has no hints */
+static unsigned long *hint_slot(
+  const HintTable *hints, const char *classname, const char *funcname)
+{
+  unsigned long m = hints->HashTableSize - 1;
+  unsigned long i = hint_hash(classname, funcname) & m;
+  const HintInfo *hint;
+
+  while (hints->HashTable[i] != 0)
+    {
+    hint = &hints->Hints[hints->HashTable[i] - 1];
+    if (strcmp(hint->ClassName, classname) == 0 &&
+        strcmp(hint->FunctionName, funcname) == 0)
+      {
+      break;
+      }
+    i = (i + 1) & m;
+    }
+
+  return &hints->HashTable[i];
+}
+
+/* Read a hints file into a table */
+HintTable *vtkParse_ReadHintTable(FILE *hfile, FILE *errfile)
 {
   char h_cls[512];
   char h_func[512];
-  unsigned int h_type, type;
+  unsigned int h_type;
   unsigned long h_value;
-  FunctionInfo *func_info;
-  ClassInfo *class_info;
-  NamespaceInfo *contents;
-  unsigned long i, j;
+  HintTable *hints;
+  HintInfo *hint;
+  unsigned long *slot;
+  unsigned long m;
   int lineno = 0;
   int n;
 
-  contents = file_info->Contents;
+  hints = (HintTable *)malloc(sizeof(HintTable));
+  hints->NumberOfHints = 0;
+  hints->Hints = NULL;
+  vtkParse_InitStringCache(&hints->Strings);
 
   /* read each hint line in succession */
-  while ((n = fscanf(hfile,"%s %s %x %lu", h_cls, h_func, &h_type, &h_value))
-         != EOF)
+  while ((n = fscanf(hfile, "%511s %511s %x %lu",
+                     h_cls, h_func, &h_type, &h_value)) != EOF)
     {
     lineno++;
     if (n < 4)
@@ -12786,76 +13081,179 @@ int vtkParse_ReadHints(FileInfo *file_info, FILE *hfile, FILE *errfile)
       exit(1);
       }
 
-    /* erase "ref" and qualifiers from hint type */
-    type = ((h_type & VTK_PARSE_BASE_TYPE) |
-            (h_type & VTK_PARSE_POINTER_LOWMASK));
+    /* double the size whenever the count is a power of two */
+    m = hints->NumberOfHints;
+    if (m == 0 || (m & (m-1)) == 0)
+      {
+      hints->Hints = (HintInfo *)realloc(
+        hints->Hints, (m == 0 ? 1 : 2*m)*sizeof(HintInfo));
+      }
+
+    hint = &hints->Hints[m];
+    hint->ClassName =
+      vtkParse_CacheString(&hints->Strings, h_cls, strlen(h_cls));
+    hint->FunctionName =
+      vtkParse_CacheString(&hints->Strings, h_func, strlen(h_func));
+    hint->Type = h_type;
+    hint->Value = h_value;
+    hint->Next = 0;
+    hints->NumberOfHints = m + 1;
+    }
+
+  /* make the hash table at least twice as large as the number of hints */
+  m = 16;
+  while (m < 2*hints->NumberOfHints)
+    {
+    m *= 2;
+    }
+  hints->HashTableSize = m;
+  hints->HashTable = (unsigned long *)calloc(m, sizeof(unsigned long));
 
-    /* find the matching class */
-    for (i = 0; i < contents->NumberOfClasses; i++)
+  /* add each hint to the end of the chain for its method */
+  for (m = 0; m < hints->NumberOfHints; m++)
+    {
+    hint = &hints->Hints[m];
+    slot = hint_slot(hints, hint->ClassName, hint->FunctionName);
+    if (*slot == 0)
+      {
+      *slot = m + 1;
+      }
+    else
       {
-      class_info = contents->Classes[i];
+      hint = &hints->Hints[*slot - 1];
+      while (hint->Next != 0)
+        {
+        hint = &hints->Hints[hint->Next - 1];
+        }
+      hint->Next = m + 1;
+      }
+    }
+
+  return hints;
+}
+
+/* Apply one hint to a method, if the return type matches */
+static void apply_hint(
+  FileInfo *file_info, FunctionInfo *func_info, const HintInfo *hint,
+  FILE *errfile)
+{
+  unsigned int type;
+
+  /* erase "ref" and qualifiers from hint type */
+  type = ((hint->Type & VTK_PARSE_BASE_TYPE) |
+          (hint->Type & VTK_PARSE_POINTER_LOWMASK));
 
-      if (strcmp(h_cls, class_info->Name) == 0)
+  if (type == ((func_info->ReturnValue->Type & ~VTK_PARSE_REF) &
+               VTK_PARSE_UNQUALIFIED_TYPE))
+    {
+    /* types that hints are accepted for */
+    switch (func_info->ReturnValue->Type & VTK_PARSE_UNQUALIFIED_TYPE)
+      {
+      case VTK_PARSE_FLOAT_PTR:
+      case VTK_PARSE_VOID_PTR:
+      case VTK_PARSE_DOUBLE_PTR:
+      case VTK_PARSE_ID_TYPE_PTR:
+      case VTK_PARSE_LONG_LONG_PTR:
+      case VTK_PARSE_UNSIGNED_LONG_LONG_PTR:
+      case VTK_PARSE___INT64_PTR:
+      case VTK_PARSE_UNSIGNED___INT64_PTR:
+      case VTK_PARSE_INT_PTR:
+      case VTK_PARSE_UNSIGNED_INT_PTR:
+      case VTK_PARSE_SHORT_PTR:
+      case VTK_PARSE_UNSIGNED_SHORT_PTR:
+      case VTK_PARSE_LONG_PTR:
+      case VTK_PARSE_UNSIGNED_LONG_PTR:
+      case VTK_PARSE_SIGNED_CHAR_PTR:
+      case VTK_PARSE_UNSIGNED_CHAR_PTR:
+      case VTK_PARSE_CHAR_PTR:
         {
-        /* find the matching function */
-        for (j = 0; j < class_info->NumberOfFunctions; j++)
+        if (func_info->ReturnValue->NumberOfDimensions == 0)
           {
-          func_info = class_info->Functions[j];
-
-          if ((strcmp(h_func, func_info->Name) == 0) &&
-              func_info->ReturnValue &&
-              (type == ((func_info->ReturnValue->Type & ~VTK_PARSE_REF) &
-                        VTK_PARSE_UNQUALIFIED_TYPE)))
-            {
-            /* types that hints are accepted for */
-            switch (func_info->ReturnValue->Type & VTK_PARSE_UNQUALIFIED_TYPE)
-              {
-              case VTK_PARSE_FLOAT_PTR:
-              case VTK_PARSE_VOID_PTR:
-              case VTK_PARSE_DOUBLE_PTR:
-              case VTK_PARSE_ID_TYPE_PTR:
-              case VTK_PARSE_LONG_LONG_PTR:
-              case VTK_PARSE_UNSIGNED_LONG_LONG_PTR:
-              case VTK_PARSE___INT64_PTR:
-              case VTK_PARSE_UNSIGNED___INT64_PTR:
-              case VTK_PARSE_INT_PTR:
-              case VTK_PARSE_UNSIGNED_INT_PTR:
-              case VTK_PARSE_SHORT_PTR:
-              case VTK_PARSE_UNSIGNED_SHORT_PTR:
-              case VTK_PARSE_LONG_PTR:
-              case VTK_PARSE_UNSIGNED_LONG_PTR:
-              case VTK_PARSE_SIGNED_CHAR_PTR:
-              case VTK_PARSE_UNSIGNED_CHAR_PTR:
-              case VTK_PARSE_CHAR_PTR:
-                {
-                if (func_info->ReturnValue->NumberOfDimensions == 0)
-                  {
-                  char text[64];
-                  sprintf(text, "%lu", h_value);
-                  func_info->ReturnValue->Count = h_value;
-                  vtkParse_AddStringToArray(
-                    &func_info->ReturnValue->Dimensions,
-                    &func_info->ReturnValue->NumberOfDimensions,
-                    vtkParse_CacheString(
-                      file_info->Strings, text, strlen(text)));
+          char text[64];
+          sprintf(text, "%lu", hint->Value);
+          func_info->ReturnValue->Count = hint->Value;
+          vtkParse_AddStringToArray(
+            &func_info->ReturnValue->Dimensions,
+            &func_info->ReturnValue->NumberOfDimensions,
+            vtkParse_CacheString(
+              file_info->Strings, text, strlen(text)));
 #ifndef VTK_PARSE_LEGACY_REMOVE
-                  func_info->HaveHint = 1;
-                  func_info->HintSize = h_value;
+          func_info->HaveHint = 1;
+          func_info->HintSize = hint->Value;
 #endif
-                  }
-                break;
-                }
-              default:
-                {
-                fprintf(errfile,
-                        "Wrapping: unhandled hint type %#x\n", h_type);
-                }
-              }
-            }
           }
+        break;
+        }
+      default:
+        {
+        fprintf(errfile,
+                "Wrapping: unhandled hint type %#x\n", hint->Type);
+        }
+      }
+    }
+}
+
+/* Apply the hints in the table to the FileInfo, with one hash lookup
+ * for each method */
+void vtkParse_ApplyHintTable(
+  FileInfo *file_info, const HintTable *hints, FILE *errfile)
+{
+  ClassInfo *class_info;
+  FunctionInfo *func_info;
+  NamespaceInfo *contents;
+  unsigned long i, j, k;
+
+  if (hints->NumberOfHints == 0)
+    {
+    return;
+    }
+
+  contents = file_info->Contents;
+
+  for (i = 0; i < contents->NumberOfClasses; i++)
+    {
+    class_info = contents->Classes[i];
+    if (class_info->Name == NULL)
+      {
+      continue;
+      }
+
+    for (j = 0; j < class_info->NumberOfFunctions; j++)
+      {
+      func_info = class_info->Functions[j];
+      if (func_info->Name == NULL || func_info->ReturnValue == NULL)
+        {
+        continue;
+        }
+
+      /* apply the hints for the method in the order they were read */
+      k = *hint_slot(hints, class_info->Name, func_info->Name);
+      while (k != 0)
+        {
+        apply_hint(file_info, func_info, &hints->Hints[k - 1], errfile);
+        k = hints->Hints[k - 1].Next;
         }
       }
     }
+}
+
+/* Free a table of hints */
+void vtkParse_FreeHintTable(HintTable *hints)
+{
+  vtkParse_FreeStringCache(&hints->Strings);
+  free(hints->HashTable);
+  free(hints->Hints);
+  free(hints);
+}
+
+/* Read a hints file and update the FileInfo */
+int vtkParse_ReadHints(FileInfo *file_info, FILE *hfile, FILE *errfile)
+{
+  HintTable *hints;
+
+  hints = vtkParse_ReadHintTable(hfile, errfile);
+  vtkParse_ApplyHintTable(file_info, hints, errfile);
+  vtkParse_FreeHintTable(hints);
 
   return 1;
 }
@@ -12866,6 +13264,8 @@ void vtkParse_Free(FileInfo *file_info)
   vtkParse_FreeFile(file_info);
   vtkParse_FreeStringCache(file_info->Strings);
   free(file_info->Strings);
+  vtkParse_FreeArena(file_info->Arena);
+  free(file_info->Arena);
   free(file_info);
 }
 
@@ -12893,7 +13293,8 @@ void vtkParse_DefineMacro(const char *name, const char *definition)
     }
   cp[l] = '\0';
 
-  vtkParse_AddStringToArray(&Definitions, &NumberOfDefinitions, cp);
+  vtkParse_AddStringToArray(
+    &defaultContext.Definitions, &defaultContext.NumberOfDefinitions, cp);
 }
 
 /** Undefine a preprocessor macro.  */
@@ -12907,7 +13308,8 @@ void vtkParse_UndefineMacro(const char *name)
   strncpy(&cp[1], name, n);
   cp[n+1] = '\0';
 
-  vtkParse_AddStringToArray(&Definitions, &NumberOfDefinitions, cp);
+  vtkParse_AddStringToArray(
+    &defaultContext.Definitions, &defaultContext.NumberOfDefinitions, cp);
 }
 
 /** Add an include directory, for use with the "-I" option.  */
@@ -12917,10 +13319,10 @@ void vtkParse_IncludeDirectory(const char *dirname)
   char *cp;
   unsigned long i;
 
-  for (i = 0; i < NumberOfIncludeDirectories; i++)
+  for (i = 0; i < defaultContext.NumberOfIncludeDirectories; i++)
     {
-    if (strncmp(IncludeDirectories[i], dirname, n) == 0 &&
-        IncludeDirectories[i][n] == '\0')
+    if (strncmp(defaultContext.IncludeDirectories[i], dirname, n) == 0 &&
+        defaultContext.IncludeDirectories[i][n] == '\0')
       {
       return;
       }
@@ -12930,21 +13332,26 @@ void vtkParse_IncludeDirectory(const char *dirname)
   strcpy(cp, dirname);
 
   vtkParse_AddStringToArray(
-    &IncludeDirectories, &NumberOfIncludeDirectories, cp);
+    &defaultContext.IncludeDirectories,
+    &defaultContext.NumberOfIncludeDirectories, cp);
 }
 
 /** Return the full path to a header file.  */
 const char *vtkParse_FindIncludeFile(const char *filename)
 {
-  static StringCache cache = {0, 0, 0, 0};
-  static PreprocessInfo info = {0, 0, 0, 0, 0, 0, &cache, 0, 0, 0};
+  static VTK_PARSE_TLS StringCache cache = {0, 0, 0, 0, 0, 0, 0};
+  static VTK_PARSE_TLS PreprocessInfo info = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
   int val;
   unsigned long i;
 
+  /* a thread-local address cannot be used in the initializer */
+  info.Strings = &cache;
+
   /* add include files specified on the command line */
-  for (i = 0; i < NumberOfIncludeDirectories; i++)
+  for (i = 0; i < defaultContext.NumberOfIncludeDirectories; i++)
     {
-    vtkParsePreprocess_IncludeDirectory(&info, IncludeDirectories[i]);
+    vtkParsePreprocess_IncludeDirectory(
+      &info, defaultContext.IncludeDirectories[i]);
     }
 
   return vtkParsePreprocess_FindIncludeFile(&info, filename, 0, &val);
@@ -0,0 +1,1254 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkParseBinary.c
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#include "vtkParseBinary.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The magic and the byte order, a file from a machine with the wrong
+ * byte order will be rejected */
+#define BINARY_FILE_MAGIC "VTKFINFO"
+#define BINARY_FILE_BYTE_ORDER 0x01020304u
+
+/* The initial value for binary_hash() */
+#define BINARY_HASH_INIT 5381u
+
+/* The tables that are collected to write a binary file */
+typedef struct _BinaryFileWriter
+{
+  BinaryClass     *Classes;
+  unsigned int     NumberOfClasses;
+  BinaryFunction  *Functions;
+  unsigned int     NumberOfFunctions;
+  BinaryValue     *Values;
+  unsigned int     NumberOfValues;
+  BinaryUsing     *Usings;
+  unsigned int     NumberOfUsings;
+  BinaryComment   *Comments;
+  unsigned int     NumberOfComments;
+  unsigned int    *Lists;
+  size_t           ListSize;
+  size_t           MaxListSize;
+  unsigned int    *Pending;        /* indices for lists being built */
+  size_t           PendingSize;
+  size_t           MaxPendingSize;
+  char            *Strings;
+  size_t           StringSize;
+  size_t           MaxStringSize;
+  unsigned int    *StringTable;    /* string offsets, zero if empty */
+  size_t           StringTableSize; /* always a power of two */
+  size_t           NumberOfStrings;
+  const void     **PointerTable;   /* the structs that were written */
+  unsigned int    *PointerIndex;   /* the record index for each struct */
+  size_t           PointerTableSize; /* always a power of two */
+  size_t           NumberOfPointers;
+} BinaryFileWriter;
+
+/* Extend dynamic arrays in a progression of powers of two.
+ * Whenever "n" reaches a power of two, then the array size is
+ * doubled so that "n" can be safely incremented. */
+static void *binary_array_check(void *arraymem, size_t size, size_t n)
+{
+  /* if empty, alloc for the first time */
+  if (n == 0)
+    {
+    return malloc(size);
+    }
+  /* if count is power of two, reallocate with double size */
+  else if ((n & (n-1)) == 0)
+    {
+    return realloc(arraymem, (n << 1)*size);
+    }
+
+  /* no reallocation, just return the original array */
+  return arraymem;
+}
+
+/* Hash a string */
+static unsigned int binary_hash(const char *text, size_t n)
+{
+  unsigned int h = BINARY_HASH_INIT;
+  size_t i;
+
+  for (i = 0; i < n; i++)
+    {
+    h = ((h << 5) + h) ^ (unsigned char)text[i];
+    }
+
+  return h;
+}
+
+/* Hash a pointer */
+static size_t binary_pointer_hash(const void *ptr)
+{
+  size_t h = (size_t)ptr;
+  return (h >> 4) ^ (h >> 12);
+}
+
+/* Add a string to the file, it is only stored once */
+static unsigned int binary_write_string(
+  BinaryFileWriter *writer, const char *text)
+{
+  unsigned int *table;
+  unsigned int offset;
+  size_t i, j, m, n, oldsize;
+
+  if (text == NULL)
+    {
+    return 0;
+    }
+
+  n = strlen(text);
+
+  /* look for the string */
+  m = writer->StringTableSize - 1;
+  for (i = (binary_hash(text, n) & m); writer->StringTable[i] != 0;
+       i = ((i + 1) & m))
+    {
+    if (strcmp(&writer->Strings[writer->StringTable[i]], text) == 0)
+      {
+      return writer->StringTable[i];
+      }
+    }
+
+  /* add the string */
+  while (writer->StringSize + n + 1 > writer->MaxStringSize)
+    {
+    writer->MaxStringSize *= 2;
+    writer->Strings = (char *)realloc(
+      writer->Strings, writer->MaxStringSize);
+    }
+  offset = (unsigned int)writer->StringSize;
+  memcpy(&writer->Strings[offset], text, n + 1);
+  writer->StringSize += n + 1;
+  writer->StringTable[i] = offset;
+
+  /* keep the table at most half full */
+  if (++writer->NumberOfStrings > writer->StringTableSize/2)
+    {
+    table = writer->StringTable;
+    oldsize = writer->StringTableSize;
+    writer->StringTableSize *= 2;
+    writer->StringTable = (unsigned int *)calloc(
+      writer->StringTableSize, sizeof(unsigned int));
+    m = writer->StringTableSize - 1;
+    for (j = 0; j < oldsize; j++)
+      {
+      if (table[j] != 0)
+        {
+        const char *cp = &writer->Strings[table[j]];
+        for (i = (binary_hash(cp, strlen(cp)) & m);
+             writer->StringTable[i] != 0; i = ((i + 1) & m)) { ; }
+        writer->StringTable[i] = table[j];
+        }
+      }
+    free(table);
+    }
+
+  return offset;
+}
+
+/* Find the record for a struct that was already written, and return
+ * the index plus one, or return zero if it has not been written */
+static unsigned int binary_find_pointer(
+  BinaryFileWriter *writer, const void *ptr)
+{
+  size_t i;
+  size_t m = writer->PointerTableSize - 1;
+
+  for (i = (binary_pointer_hash(ptr) & m); writer->PointerTable[i] != NULL;
+       i = ((i + 1) & m))
+    {
+    if (writer->PointerTable[i] == ptr)
+      {
+      return writer->PointerIndex[i] + 1;
+      }
+    }
+
+  return 0;
+}
+
+/* Remember the record index for a struct */
+static void binary_add_pointer(
+  BinaryFileWriter *writer, const void *ptr, unsigned int idx)
+{
+  const void **table;
+  unsigned int *indices;
+  size_t i, j, m, n;
+
+  /* keep the table at most half full */
+  if (writer->NumberOfPointers + 1 > writer->PointerTableSize/2)
+    {
+    table = writer->PointerTable;
+    indices = writer->PointerIndex;
+    n = writer->PointerTableSize;
+    writer->PointerTableSize *= 2;
+    writer->PointerTable = (const void **)calloc(
+      writer->PointerTableSize, sizeof(const void *));
+    writer->PointerIndex = (unsigned int *)malloc(
+      writer->PointerTableSize*sizeof(unsigned int));
+    m = writer->PointerTableSize - 1;
+    for (j = 0; j < n; j++)
+      {
+      if (table[j] != NULL)
+        {
+        for (i = (binary_pointer_hash(table[j]) & m);
+             writer->PointerTable[i] != NULL; i = ((i + 1) & m)) { ; }
+        writer->PointerTable[i] = table[j];
+        writer->PointerIndex[i] = indices[j];
+        }
+      }
+    free((void *)table);
+    free(indices);
+    }
+
+  m = writer->PointerTableSize - 1;
+  for (i = (binary_pointer_hash(ptr) & m); writer->PointerTable[i] != NULL;
+       i = ((i + 1) & m)) { ; }
+  writer->PointerTable[i] = ptr;
+  writer->PointerIndex[i] = idx;
+  writer->NumberOfPointers++;
+}
+
+/* Add an int to the list table */
+static void binary_write_int(BinaryFileWriter *writer, unsigned int val)
+{
+  if (writer->ListSize == writer->MaxListSize)
+    {
+    writer->MaxListSize *= 2;
+    writer->Lists = (unsigned int *)realloc(
+      writer->Lists, writer->MaxListSize*sizeof(unsigned int));
+    }
+  writer->Lists[writer->ListSize++] = val;
+}
+
+/* Push an index for a list that is being built.  The structs that
+ * a list refers to must be written before the list itself, and they
+ * can have lists of their own, so the indices are kept on a stack. */
+static void binary_push(BinaryFileWriter *writer, unsigned int val)
+{
+  if (writer->PendingSize == writer->MaxPendingSize)
+    {
+    writer->MaxPendingSize *= 2;
+    writer->Pending = (unsigned int *)realloc(
+      writer->Pending, writer->MaxPendingSize*sizeof(unsigned int));
+    }
+  writer->Pending[writer->PendingSize++] = val;
+}
+
+/* Write the indices that were pushed since "start" as a list, and pop
+ * them.  An empty list is written as zero, unless "keep" is set. */
+static unsigned int binary_write_pending(
+  BinaryFileWriter *writer, size_t start, int keep)
+{
+  unsigned int offset;
+  size_t i;
+
+  if (writer->PendingSize == start && !keep)
+    {
+    return 0;
+    }
+
+  offset = (unsigned int)writer->ListSize;
+  binary_write_int(writer, (unsigned int)(writer->PendingSize - start));
+  for (i = start; i < writer->PendingSize; i++)
+    {
+    binary_write_int(writer, writer->Pending[i]);
+    }
+  writer->PendingSize = start;
+
+  return offset;
+}
+
+/* Write a list of strings */
+static unsigned int binary_write_strings(
+  BinaryFileWriter *writer, unsigned long n, const char **strings)
+{
+  size_t start = writer->PendingSize;
+  unsigned long i;
+
+  for (i = 0; i < n; i++)
+    {
+    binary_push(writer, binary_write_string(writer, strings[i]));
+    }
+
+  return binary_write_pending(writer, start, 0);
+}
+
+/* Write the items of a class, as (ItemType, Index) pairs */
+static unsigned int binary_write_items(
+  BinaryFileWriter *writer, unsigned long n, const ItemInfo *items)
+{
+  unsigned int offset;
+  unsigned long i;
+
+  if (n == 0)
+    {
+    return 0;
+    }
+
+  offset = (unsigned int)writer->ListSize;
+  binary_write_int(writer, (unsigned int)n);
+  for (i = 0; i < n; i++)
+    {
+    binary_write_int(writer, (unsigned int)items[i].Type);
+    binary_write_int(writer, (unsigned int)items[i].Index);
+    }
+
+  return offset;
+}
+
+/* needed for the templates and the function pointers */
+static unsigned int binary_write_value(
+  BinaryFileWriter *writer, const ValueInfo *val);
+static unsigned int binary_write_function(
+  BinaryFileWriter *writer, const FunctionInfo *func);
+
+/* Write a template, the list is kept even if there are no parameters */
+static unsigned int binary_write_template(
+  BinaryFileWriter *writer, const TemplateInfo *tmpl)
+{
+  size_t start = writer->PendingSize;
+  unsigned long i;
+
+  if (tmpl == NULL)
+    {
+    return 0;
+    }
+
+  for (i = 0; i < tmpl->NumberOfParameters; i++)
+    {
+    binary_push(writer, binary_write_value(writer, tmpl->Parameters[i]));
+    }
+
+  return binary_write_pending(writer, start, 1);
+}
+
+/* Write a value and return its index */
+static unsigned int binary_write_value(
+  BinaryFileWriter *writer, const ValueInfo *val)
+{
+  BinaryValue record;
+  unsigned int idx;
+
+  idx = binary_find_pointer(writer, val);
+  if (idx != 0)
+    {
+    return idx - 1;
+    }
+
+  idx = writer->NumberOfValues;
+  writer->Values = (BinaryValue *)binary_array_check(
+    writer->Values, sizeof(BinaryValue), writer->NumberOfValues);
+  writer->NumberOfValues++;
+  binary_add_pointer(writer, val, idx);
+
+  memset(&record, 0, sizeof(BinaryValue));
+  record.ItemType = (unsigned int)val->ItemType;
+  record.Access = (unsigned int)val->Access;
+  record.Name = binary_write_string(writer, val->Name);
+  record.Comment = binary_write_string(writer, val->Comment);
+  record.Value = binary_write_string(writer, val->Value);
+  record.Type = val->Type;
+  record.TypeName = binary_write_string(writer, val->TypeName);
+  record.Count = (unsigned int)val->Count;
+  record.CountHint = binary_write_string(writer, val->CountHint);
+  record.Dimensions = binary_write_strings(
+    writer, val->NumberOfDimensions, val->Dimensions);
+  if (val->Function)
+    {
+    record.Function = binary_write_function(writer, val->Function) + 1;
+    }
+  record.Template = binary_write_template(writer, val->Template);
+  record.Flags = ((val->IsStatic ? VTK_PARSE_BINARY_STATIC : 0) |
+                  (val->IsEnum ? VTK_PARSE_BINARY_ENUM : 0) |
+                  (val->IsPack ? VTK_PARSE_BINARY_PACK : 0));
+
+  /* the array might have moved while the children were written */
+  writer->Values[idx] = record;
+
+  return idx;
+}
+
+/* Write a function and return its index */
+static unsigned int binary_write_function(
+  BinaryFileWriter *writer, const FunctionInfo *func)
+{
+  BinaryFunction record;
+  size_t start;
+  unsigned int idx;
+  unsigned long i;
+
+  idx = binary_find_pointer(writer, func);
+  if (idx != 0)
+    {
+    return idx - 1;
+    }
+
+  idx = writer->NumberOfFunctions;
+  writer->Functions = (BinaryFunction *)binary_array_check(
+    writer->Functions, sizeof(BinaryFunction), writer->NumberOfFunctions);
+  writer->NumberOfFunctions++;
+  binary_add_pointer(writer, func, idx);
+
+  memset(&record, 0, sizeof(BinaryFunction));
+  record.ItemType = (unsigned int)func->ItemType;
+  record.Access = (unsigned int)func->Access;
+  record.Name = binary_write_string(writer, func->Name);
+  record.Comment = binary_write_string(writer, func->Comment);
+  record.Class = binary_write_string(writer, func->Class);
+  record.Signature = binary_write_string(writer, func->Signature);
+  record.Template = binary_write_template(writer, func->Template);
+
+  start = writer->PendingSize;
+  for (i = 0; i < func->NumberOfParameters; i++)
+    {
+    binary_push(writer, binary_write_value(writer, func->Parameters[i]));
+    }
+  record.Parameters = binary_write_pending(writer, start, 0);
+
+  if (func->ReturnValue)
+    {
+    record.ReturnValue = binary_write_value(writer, func->ReturnValue) + 1;
+    }
+  record.Macro = binary_write_string(writer, func->Macro);
+  record.SizeHint = binary_write_string(writer, func->SizeHint);
+  record.Flags =
+    ((func->IsOperator ? VTK_PARSE_BINARY_OPERATOR : 0) |
+     (func->IsVariadic ? VTK_PARSE_BINARY_VARIADIC : 0) |
+     (func->IsLegacy ? VTK_PARSE_BINARY_LEGACY : 0) |
+     (func->IsStatic ? VTK_PARSE_BINARY_STATIC : 0) |
+     (func->IsVirtual ? VTK_PARSE_BINARY_VIRTUAL : 0) |
+     (func->IsPureVirtual ? VTK_PARSE_BINARY_PURE_VIRTUAL : 0) |
+     (func->IsConst ? VTK_PARSE_BINARY_CONST : 0) |
+     (func->IsDeleted ? VTK_PARSE_BINARY_DELETED : 0) |
+     (func->IsFinal ? VTK_PARSE_BINARY_FINAL_METHOD : 0) |
+     (func->IsExplicit ? VTK_PARSE_BINARY_EXPLICIT : 0));
+
+  writer->Functions[idx] = record;
+
+  return idx;
+}
+
+/* Write a using declaration and return its index */
+static unsigned int binary_write_using(
+  BinaryFileWriter *writer, const UsingInfo *item)
+{
+  BinaryUsing record;
+  unsigned int idx;
+
+  idx = binary_find_pointer(writer, item);
+  if (idx != 0)
+    {
+    return idx - 1;
+    }
+
+  idx = writer->NumberOfUsings;
+  writer->Usings = (BinaryUsing *)binary_array_check(
+    writer->Usings, sizeof(BinaryUsing), writer->NumberOfUsings);
+  writer->NumberOfUsings++;
+  binary_add_pointer(writer, item, idx);
+
+  memset(&record, 0, sizeof(BinaryUsing));
+  record.ItemType = (unsigned int)item->ItemType;
+  record.Access = (unsigned int)item->Access;
+  record.Name = binary_write_string(writer, item->Name);
+  record.Comment = binary_write_string(writer, item->Comment);
+  record.Scope = binary_write_string(writer, item->Scope);
+
+  writer->Usings[idx] = record;
+
+  return idx;
+}
+
+/* Write a comment and return its index */
+static unsigned int binary_write_comment(
+  BinaryFileWriter *writer, const CommentInfo *item)
+{
+  BinaryComment record;
+  unsigned int idx;
+
+  idx = binary_find_pointer(writer, item);
+  if (idx != 0)
+    {
+    return idx - 1;
+    }
+
+  idx = writer->NumberOfComments;
+  writer->Comments = (BinaryComment *)binary_array_check(
+    writer->Comments, sizeof(BinaryComment), writer->NumberOfComments);
+  writer->NumberOfComments++;
+  binary_add_pointer(writer, item, idx);
+
+  memset(&record, 0, sizeof(BinaryComment));
+  record.Type = (unsigned int)item->Type;
+  record.Comment = binary_write_string(writer, item->Comment);
+  record.Name = binary_write_string(writer, item->Name);
+
+  writer->Comments[idx] = record;
+
+  return idx;
+}
+
+/* Write a class, namespace, or enum and return its index */
+static unsigned int binary_write_class(
+  BinaryFileWriter *writer, const ClassInfo *cls)
+{
+  BinaryClass record;
+  size_t start;
+  unsigned int idx;
+  unsigned long i;
+
+  idx = binary_find_pointer(writer, cls);
+  if (idx != 0)
+    {
+    return idx - 1;
+    }
+
+  idx = writer->NumberOfClasses;
+  writer->Classes = (BinaryClass *)binary_array_check(
+    writer->Classes, sizeof(BinaryClass), writer->NumberOfClasses);
+  writer->NumberOfClasses++;
+  binary_add_pointer(writer, cls, idx);
+
+  memset(&record, 0, sizeof(BinaryClass));
+  record.ItemType = (unsigned int)cls->ItemType;
+  record.Access = (unsigned int)cls->Access;
+  record.Name = binary_write_string(writer, cls->Name);
+  record.Comment = binary_write_string(writer, cls->Comment);
+  record.Template = binary_write_template(writer, cls->Template);
+  record.SuperClasses = binary_write_strings(
+    writer, cls->NumberOfSuperClasses, cls->SuperClasses);
+  record.Items = binary_write_items(
+    writer, cls->NumberOfItems, cls->Items);
+
+  start = writer->PendingSize;
+  for (i = 0; i < cls->NumberOfClasses; i++)
+    {
+    binary_push(writer, binary_write_class(writer, cls->Classes[i]));
+    }
+  record.Classes = binary_write_pending(writer, start, 0);
+
+  for (i = 0; i < cls->NumberOfFunctions; i++)
+    {
+    binary_push(writer, binary_write_function(writer, cls->Functions[i]));
+    }
+  record.Functions = binary_write_pending(writer, start, 0);
+
+  for (i = 0; i < cls->NumberOfConstants; i++)
+    {
+    binary_push(writer, binary_write_value(writer, cls->Constants[i]));
+    }
+  record.Constants = binary_write_pending(writer, start, 0);
+
+  for (i = 0; i < cls->NumberOfVariables; i++)
+    {
+    binary_push(writer, binary_write_value(writer, cls->Variables[i]));
+    }
+  record.Variables = binary_write_pending(writer, start, 0);
+
+  for (i = 0; i < cls->NumberOfEnums; i++)
+    {
+    binary_push(writer, binary_write_class(writer, cls->Enums[i]));
+    }
+  record.Enums = binary_write_pending(writer, start, 0);
+
+  for (i = 0; i < cls->NumberOfTypedefs; i++)
+    {
+    binary_push(writer, binary_write_value(writer, cls->Typedefs[i]));
+    }
+  record.Typedefs = binary_write_pending(writer, start, 0);
+
+  for (i = 0; i < cls->NumberOfUsings; i++)
+    {
+    binary_push(writer, binary_write_using(writer, cls->Usings[i]));
+    }
+  record.Usings = binary_write_pending(writer, start, 0);
+
+  for (i = 0; i < cls->NumberOfNamespaces; i++)
+    {
+    binary_push(writer, binary_write_class(writer, cls->Namespaces[i]));
+    }
+  record.Namespaces = binary_write_pending(writer, start, 0);
+
+  for (i = 0; i < cls->NumberOfComments; i++)
+    {
+    binary_push(writer, binary_write_comment(writer, cls->Comments[i]));
+    }
+  record.Comments = binary_write_pending(writer, start, 0);
+
+  record.Flags = ((cls->IsAbstract ? VTK_PARSE_BINARY_ABSTRACT : 0) |
+                  (cls->IsFinal ? VTK_PARSE_BINARY_FINAL : 0) |
+                  (cls->HasDelete ? VTK_PARSE_BINARY_HAS_DELETE : 0));
+
+  writer->Classes[idx] = record;
+
+  return idx;
+}
+
+/* Copy a table into the file, the table is NULL if it is empty */
+static void binary_copy_table(char *dest, const void *table, size_t n)
+{
+  if (n != 0)
+    {
+    memcpy(dest, table, n);
+    }
+}
+
+/* Pack a FileInfo into a binary file */
+char *vtkParseBinary_Pack(const FileInfo *data, size_t *size)
+{
+  BinaryFileWriter writer;
+  BinaryFileHeader header;
+  char *result;
+  size_t n;
+
+  memset(&writer, 0, sizeof(BinaryFileWriter));
+  writer.MaxListSize = 1024;
+  writer.Lists = (unsigned int *)malloc(
+    writer.MaxListSize*sizeof(unsigned int));
+  writer.Lists[writer.ListSize++] = 0; /* offset zero is an empty list */
+  writer.MaxPendingSize = 64;
+  writer.Pending = (unsigned int *)malloc(
+    writer.MaxPendingSize*sizeof(unsigned int));
+  writer.MaxStringSize = 4096;
+  writer.Strings = (char *)malloc(writer.MaxStringSize);
+  writer.Strings[writer.StringSize++] = '\0'; /* offset zero is NULL */
+  writer.StringTableSize = 1024;
+  writer.StringTable = (unsigned int *)calloc(
+    writer.StringTableSize, sizeof(unsigned int));
+  writer.PointerTableSize = 1024;
+  writer.PointerTable = (const void **)calloc(
+    writer.PointerTableSize, sizeof(const void *));
+  writer.PointerIndex = (unsigned int *)malloc(
+    writer.PointerTableSize*sizeof(unsigned int));
+
+  memset(&header, 0, sizeof(BinaryFileHeader));
+  memcpy(header.Magic, BINARY_FILE_MAGIC, 8);
+  header.ByteOrder = BINARY_FILE_BYTE_ORDER;
+  header.Version = VTK_PARSE_BINARY_VERSION;
+  header.FileName = binary_write_string(&writer, data->FileName);
+  header.NameComment = binary_write_string(&writer, data->NameComment);
+  header.Description = binary_write_string(&writer, data->Description);
+  header.Caveats = binary_write_string(&writer, data->Caveats);
+  header.SeeAlso = binary_write_string(&writer, data->SeeAlso);
+  if (data->Contents)
+    {
+    header.Contents = binary_write_class(&writer, data->Contents) + 1;
+    }
+  if (data->MainClass)
+    {
+    header.MainClass = binary_write_class(&writer, data->MainClass) + 1;
+    }
+
+  /* lay out the file */
+  n = sizeof(BinaryFileHeader);
+  header.NumberOfClasses = writer.NumberOfClasses;
+  header.ClassOffset = (unsigned int)n;
+  n += writer.NumberOfClasses*sizeof(BinaryClass);
+  header.NumberOfFunctions = writer.NumberOfFunctions;
+  header.FunctionOffset = (unsigned int)n;
+  n += writer.NumberOfFunctions*sizeof(BinaryFunction);
+  header.NumberOfValues = writer.NumberOfValues;
+  header.ValueOffset = (unsigned int)n;
+  n += writer.NumberOfValues*sizeof(BinaryValue);
+  header.NumberOfUsings = writer.NumberOfUsings;
+  header.UsingOffset = (unsigned int)n;
+  n += writer.NumberOfUsings*sizeof(BinaryUsing);
+  header.NumberOfComments = writer.NumberOfComments;
+  header.CommentOffset = (unsigned int)n;
+  n += writer.NumberOfComments*sizeof(BinaryComment);
+  header.ListOffset = (unsigned int)n;
+  header.ListSize = (unsigned int)writer.ListSize;
+  n += writer.ListSize*sizeof(unsigned int);
+  header.StringOffset = (unsigned int)n;
+  header.StringSize = (unsigned int)writer.StringSize;
+  n += writer.StringSize;
+  header.FileSize = (unsigned int)n;
+
+  result = NULL;
+  if (header.FileSize == n)
+    {
+    result = (char *)malloc(n);
+    memcpy(result, &header, sizeof(BinaryFileHeader));
+    binary_copy_table(&result[header.ClassOffset], writer.Classes,
+                      writer.NumberOfClasses*sizeof(BinaryClass));
+    binary_copy_table(&result[header.FunctionOffset], writer.Functions,
+                      writer.NumberOfFunctions*sizeof(BinaryFunction));
+    binary_copy_table(&result[header.ValueOffset], writer.Values,
+                      writer.NumberOfValues*sizeof(BinaryValue));
+    binary_copy_table(&result[header.UsingOffset], writer.Usings,
+                      writer.NumberOfUsings*sizeof(BinaryUsing));
+    binary_copy_table(&result[header.CommentOffset], writer.Comments,
+                      writer.NumberOfComments*sizeof(BinaryComment));
+    memcpy(&result[header.ListOffset], writer.Lists,
+           writer.ListSize*sizeof(unsigned int));
+    memcpy(&result[header.StringOffset], writer.Strings, writer.StringSize);
+    *size = n;
+    }
+
+  free(writer.Classes);
+  free(writer.Functions);
+  free(writer.Values);
+  free(writer.Usings);
+  free(writer.Comments);
+  free(writer.Lists);
+  free(writer.Pending);
+  free(writer.Strings);
+  free(writer.StringTable);
+  free((void *)writer.PointerTable);
+  free(writer.PointerIndex);
+
+  return result;
+}
+
+/* Check that a table is within the file and is aligned */
+static int binary_check_table(
+  const BinaryFileHeader *header, unsigned int offset, unsigned int count,
+  size_t recordsize)
+{
+  return (offset % sizeof(unsigned int) == 0 &&
+          offset >= sizeof(BinaryFileHeader) &&
+          offset <= header->FileSize &&
+          count <= (header->FileSize - offset)/recordsize);
+}
+
+/* Check that a string offset is valid */
+static int binary_check_string(
+  const BinaryFileInfo *info, unsigned int offset)
+{
+  return (offset < info->Header->StringSize);
+}
+
+/* Check a list, if "limit" is zero the items are strings, otherwise
+ * the items must be less than the limit */
+static int binary_check_list(
+  const BinaryFileInfo *info, unsigned int offset, unsigned int limit)
+{
+  unsigned int n, i;
+
+  if (offset >= info->Header->ListSize)
+    {
+    return 0;
+    }
+  n = info->Lists[offset];
+  if (n > info->Header->ListSize - offset - 1)
+    {
+    return 0;
+    }
+  for (i = 1; i <= n; i++)
+    {
+    if (limit == 0 ? !binary_check_string(info, info->Lists[offset + i])
+                   : info->Lists[offset + i] >= limit)
+      {
+      return 0;
+      }
+    }
+
+  return 1;
+}
+
+/* Check the item list of a class, which has a pair of ints for each
+ * item, after the other lists of the class have been checked */
+static int binary_check_items(
+  const BinaryFileInfo *info, const BinaryClass *record)
+{
+  const unsigned int *items;
+  unsigned int offset = record->Items;
+  unsigned int list;
+  unsigned int n, i;
+
+  if (offset >= info->Header->ListSize)
+    {
+    return 0;
+    }
+  n = info->Lists[offset];
+  if (n > (info->Header->ListSize - offset - 1)/2)
+    {
+    return 0;
+    }
+
+  /* each index must be within the list for the item type */
+  items = &info->Lists[offset + 1];
+  for (i = 0; i < n; i++)
+    {
+    switch (items[2*i])
+      {
+      case VTK_NAMESPACE_INFO:
+        list = record->Namespaces;
+        break;
+      case VTK_CLASS_INFO:
+      case VTK_STRUCT_INFO:
+      case VTK_UNION_INFO:
+        list = record->Classes;
+        break;
+      case VTK_ENUM_INFO:
+        list = record->Enums;
+        break;
+      case VTK_FUNCTION_INFO:
+        list = record->Functions;
+        break;
+      case VTK_VARIABLE_INFO:
+        list = record->Variables;
+        break;
+      case VTK_CONSTANT_INFO:
+        list = record->Constants;
+        break;
+      case VTK_TYPEDEF_INFO:
+        list = record->Typedefs;
+        break;
+      case VTK_USING_INFO:
+        list = record->Usings;
+        break;
+      default:
+        return 0;
+      }
+    if (items[2*i + 1] >= info->Lists[list])
+      {
+      return 0;
+      }
+    }
+
+  return 1;
+}
+
+/* Check all of the records in the file */
+static int binary_check_records(const BinaryFileInfo *info)
+{
+  const BinaryFileHeader *header = info->Header;
+  unsigned int nclasses = header->NumberOfClasses;
+  unsigned int nfunctions = header->NumberOfFunctions;
+  unsigned int nvalues = header->NumberOfValues;
+  unsigned int nusings = header->NumberOfUsings;
+  unsigned int ncomments = header->NumberOfComments;
+  unsigned int i;
+
+  if (!binary_check_string(info, header->FileName) ||
+      !binary_check_string(info, header->NameComment) ||
+      !binary_check_string(info, header->Description) ||
+      !binary_check_string(info, header->Caveats) ||
+      !binary_check_string(info, header->SeeAlso) ||
+      header->MainClass > nclasses ||
+      header->Contents > nclasses)
+    {
+    return 0;
+    }
+
+  for (i = 0; i < nclasses; i++)
+    {
+    const BinaryClass *record = &info->Classes[i];
+    if (!binary_check_string(info, record->Name) ||
+        !binary_check_string(info, record->Comment) ||
+        !binary_check_list(info, record->Template, nvalues) ||
+        !binary_check_list(info, record->SuperClasses, 0) ||
+        !binary_check_list(info, record->Classes, nclasses) ||
+        !binary_check_list(info, record->Functions, nfunctions) ||
+        !binary_check_list(info, record->Constants, nvalues) ||
+        !binary_check_list(info, record->Variables, nvalues) ||
+        !binary_check_list(info, record->Enums, nclasses) ||
+        !binary_check_list(info, record->Typedefs, nvalues) ||
+        !binary_check_list(info, record->Usings, nusings) ||
+        !binary_check_list(info, record->Namespaces, nclasses) ||
+        !binary_check_list(info, record->Comments, ncomments) ||
+        !binary_check_items(info, record))
+      {
+      return 0;
+      }
+    }
+
+  for (i = 0; i < nfunctions; i++)
+    {
+    const BinaryFunction *record = &info->Functions[i];
+    if (!binary_check_string(info, record->Name) ||
+        !binary_check_string(info, record->Comment) ||
+        !binary_check_string(info, record->Class) ||
+        !binary_check_string(info, record->Signature) ||
+        !binary_check_list(info, record->Template, nvalues) ||
+        !binary_check_list(info, record->Parameters, nvalues) ||
+        record->ReturnValue > nvalues ||
+        !binary_check_string(info, record->Macro) ||
+        !binary_check_string(info, record->SizeHint))
+      {
+      return 0;
+      }
+    }
+
+  for (i = 0; i < nvalues; i++)
+    {
+    const BinaryValue *record = &info->Values[i];
+    if (!binary_check_string(info, record->Name) ||
+        !binary_check_string(info, record->Comment) ||
+        !binary_check_string(info, record->Value) ||
+        !binary_check_string(info, record->TypeName) ||
+        !binary_check_string(info, record->CountHint) ||
+        !binary_check_list(info, record->Dimensions, 0) ||
+        record->Function > nfunctions ||
+        !binary_check_list(info, record->Template, nvalues))
+      {
+      return 0;
+      }
+    }
+
+  for (i = 0; i < nusings; i++)
+    {
+    const BinaryUsing *record = &info->Usings[i];
+    if (!binary_check_string(info, record->Name) ||
+        !binary_check_string(info, record->Comment) ||
+        !binary_check_string(info, record->Scope))
+      {
+      return 0;
+      }
+    }
+
+  for (i = 0; i < ncomments; i++)
+    {
+    const BinaryComment *record = &info->Comments[i];
+    if (!binary_check_string(info, record->Comment) ||
+        !binary_check_string(info, record->Name))
+      {
+      return 0;
+      }
+    }
+
+  return 1;
+}
+
+/* Map a binary file, or return NULL if it is not valid */
+BinaryFileInfo *vtkParseBinary_ReadFile(const char *filename)
+{
+  BinaryFileInfo *info;
+  BinaryFileHeader header;
+  FileBuffer contents;
+  const char *data;
+  size_t size;
+  FILE *fp;
+  int result;
+
+  fp = fopen(filename, "rb");
+  if (fp == NULL)
+    {
+    return NULL;
+    }
+
+  result = vtkParsePreprocess_LoadFile(&contents, fp, 0);
+  fclose(fp);
+
+  if (result != VTK_PARSE_OK)
+    {
+    return NULL;
+    }
+
+  /* check that every table is within bounds */
+  data = contents.Data;
+  size = contents.Size;
+  if (size < sizeof(BinaryFileHeader))
+    {
+    vtkParsePreprocess_UnloadFile(&contents);
+    return NULL;
+    }
+  memcpy(&header, data, sizeof(BinaryFileHeader));
+  if (memcmp(header.Magic, BINARY_FILE_MAGIC, 8) != 0 ||
+      header.ByteOrder != BINARY_FILE_BYTE_ORDER ||
+      header.Version != VTK_PARSE_BINARY_VERSION ||
+      header.FileSize != size ||
+      !binary_check_table(&header, header.ClassOffset,
+                          header.NumberOfClasses, sizeof(BinaryClass)) ||
+      !binary_check_table(&header, header.FunctionOffset,
+                          header.NumberOfFunctions, sizeof(BinaryFunction)) ||
+      !binary_check_table(&header, header.ValueOffset,
+                          header.NumberOfValues, sizeof(BinaryValue)) ||
+      !binary_check_table(&header, header.UsingOffset,
+                          header.NumberOfUsings, sizeof(BinaryUsing)) ||
+      !binary_check_table(&header, header.CommentOffset,
+                          header.NumberOfComments, sizeof(BinaryComment)) ||
+      !binary_check_table(&header, header.ListOffset,
+                          header.ListSize, sizeof(unsigned int)) ||
+      header.ListSize == 0 ||
+      header.StringOffset > size ||
+      header.StringSize == 0 ||
+      header.StringSize > size - header.StringOffset ||
+      data[header.StringOffset] != '\0' ||
+      data[header.StringOffset + header.StringSize - 1] != '\0')
+    {
+    vtkParsePreprocess_UnloadFile(&contents);
+    return NULL;
+    }
+
+  info = (BinaryFileInfo *)malloc(sizeof(BinaryFileInfo));
+  info->Contents = contents;
+  info->Header = (const BinaryFileHeader *)data;
+  info->Classes = (const BinaryClass *)(data + header.ClassOffset);
+  info->Functions = (const BinaryFunction *)(data + header.FunctionOffset);
+  info->Values = (const BinaryValue *)(data + header.ValueOffset);
+  info->Usings = (const BinaryUsing *)(data + header.UsingOffset);
+  info->Comments = (const BinaryComment *)(data + header.CommentOffset);
+  info->Lists = (const unsigned int *)(data + header.ListOffset);
+  info->Strings = data + header.StringOffset;
+
+  /* check all the records, so that they can be used without checks */
+  if (info->Lists[0] != 0 || !binary_check_records(info))
+    {
+    vtkParseBinary_Free(info);
+    return NULL;
+    }
+
+  return info;
+}
+
+/* Unmap the file */
+void vtkParseBinary_Free(BinaryFileInfo *info)
+{
+  vtkParsePreprocess_UnloadFile(&info->Contents);
+  free(info);
+}
+
+/* Get a string, or NULL */
+const char *vtkParseBinary_GetString(
+  const BinaryFileInfo *info, unsigned int offset)
+{
+  return (offset == 0 ? NULL : &info->Strings[offset]);
+}
+
+/* Get the number of items in a list */
+unsigned int vtkParseBinary_GetListSize(
+  const BinaryFileInfo *info, unsigned int offset)
+{
+  return info->Lists[offset];
+}
+
+/* Get the items in a list */
+const unsigned int *vtkParseBinary_GetList(
+  const BinaryFileInfo *info, unsigned int offset)
+{
+  return &info->Lists[offset + 1];
+}
+
+/* Print a string in quotes with C escapes, or "-" if it is NULL */
+static void binary_print_string(
+  FILE *fp, const BinaryFileInfo *info, unsigned int offset)
+{
+  const char *cp = vtkParseBinary_GetString(info, offset);
+
+  if (cp == NULL)
+    {
+    fputs("-", fp);
+    return;
+    }
+
+  fputc('\"', fp);
+  for (; *cp != '\0'; cp++)
+    {
+    switch (*cp)
+      {
+      case '\n': fputs("\\n", fp); break;
+      case '\t': fputs("\\t", fp); break;
+      case '\\': fputs("\\\\", fp); break;
+      case '\"': fputs("\\\"", fp); break;
+      default: fputc(*cp, fp);
+      }
+    }
+  fputc('\"', fp);
+}
+
+/* Print a list of indices, or of strings if "strings" is set */
+static void binary_print_list(
+  FILE *fp, const BinaryFileInfo *info, const char *label,
+  unsigned int offset, int strings)
+{
+  const unsigned int *items = vtkParseBinary_GetList(info, offset);
+  unsigned int n = vtkParseBinary_GetListSize(info, offset);
+  unsigned int i;
+
+  if (n == 0)
+    {
+    return;
+    }
+
+  fprintf(fp, "  %s:", label);
+  for (i = 0; i < n; i++)
+    {
+    fputc(' ', fp);
+    if (strings)
+      {
+      binary_print_string(fp, info, items[i]);
+      }
+    else
+      {
+      fprintf(fp, "%u", items[i]);
+      }
+    }
+  fputc('\n', fp);
+}
+
+/* Print a template, which is zero if there is no template */
+static void binary_print_template(
+  FILE *fp, const BinaryFileInfo *info, unsigned int offset)
+{
+  const unsigned int *items = vtkParseBinary_GetList(info, offset);
+  unsigned int n = vtkParseBinary_GetListSize(info, offset);
+  unsigned int i;
+
+  if (offset != 0)
+    {
+    fputs("  template:", fp);
+    for (i = 0; i < n; i++)
+      {
+      fprintf(fp, " %u", items[i]);
+      }
+    fputc('\n', fp);
+    }
+}
+
+/* Print all the records, with the links between them as indices */
+void vtkParseBinary_Print(FILE *fp, const BinaryFileInfo *info)
+{
+  const BinaryFileHeader *header = info->Header;
+  const unsigned int *items;
+  unsigned int i, j, n;
+
+  fprintf(fp, "version %u\n", header->Version);
+  fputs("file ", fp);
+  binary_print_string(fp, info, header->FileName);
+  fputs("\nname comment ", fp);
+  binary_print_string(fp, info, header->NameComment);
+  fputs("\ndescription ", fp);
+  binary_print_string(fp, info, header->Description);
+  fputs("\ncaveats ", fp);
+  binary_print_string(fp, info, header->Caveats);
+  fputs("\nsee also ", fp);
+  binary_print_string(fp, info, header->SeeAlso);
+  fputc('\n', fp);
+  if (header->MainClass)
+    {
+    fprintf(fp, "main class %u\n", header->MainClass - 1);
+    }
+  if (header->Contents)
+    {
+    fprintf(fp, "contents %u\n", header->Contents - 1);
+    }
+
+  for (i = 0; i < header->NumberOfClasses; i++)
+    {
+    const BinaryClass *record = &info->Classes[i];
+    fprintf(fp, "class %u: type %u access %u flags 0x%x name ",
+            i, record->ItemType, record->Access, record->Flags);
+    binary_print_string(fp, info, record->Name);
+    fputs(" comment ", fp);
+    binary_print_string(fp, info, record->Comment);
+    fputc('\n', fp);
+    binary_print_template(fp, info, record->Template);
+    binary_print_list(fp, info, "superclasses", record->SuperClasses, 1);
+    n = vtkParseBinary_GetListSize(info, record->Items);
+    items = vtkParseBinary_GetList(info, record->Items);
+    if (n > 0)
+      {
+      fputs("  items:", fp);
+      for (j = 0; j < n; j++)
+        {
+        fprintf(fp, " %u:%u", items[2*j], items[2*j + 1]);
+        }
+      fputc('\n', fp);
+      }
+    binary_print_list(fp, info, "classes", record->Classes, 0);
+    binary_print_list(fp, info, "functions", record->Functions, 0);
+    binary_print_list(fp, info, "constants", record->Constants, 0);
+    binary_print_list(fp, info, "variables", record->Variables, 0);
+    binary_print_list(fp, info, "enums", record->Enums, 0);
+    binary_print_list(fp, info, "typedefs", record->Typedefs, 0);
+    binary_print_list(fp, info, "usings", record->Usings, 0);
+    binary_print_list(fp, info, "namespaces", record->Namespaces, 0);
+    binary_print_list(fp, info, "comments", record->Comments, 0);
+    }
+
+  for (i = 0; i < header->NumberOfFunctions; i++)
+    {
+    const BinaryFunction *record = &info->Functions[i];
+    fprintf(fp, "function %u: type %u access %u flags 0x%x name ",
+            i, record->ItemType, record->Access, record->Flags);
+    binary_print_string(fp, info, record->Name);
+    fputs(" class ", fp);
+    binary_print_string(fp, info, record->Class);
+    fputs(" signature ", fp);
+    binary_print_string(fp, info, record->Signature);
+    fputc('\n', fp);
+    if (record->Comment || record->Macro || record->SizeHint)
+      {
+      fputs("  comment ", fp);
+      binary_print_string(fp, info, record->Comment);
+      fputs(" macro ", fp);
+      binary_print_string(fp, info, record->Macro);
+      fputs(" size hint ", fp);
+      binary_print_string(fp, info, record->SizeHint);
+      fputc('\n', fp);
+      }
+    binary_print_template(fp, info, record->Template);
+    binary_print_list(fp, info, "parameters", record->Parameters, 0);
+    if (record->ReturnValue)
+      {
+      fprintf(fp, "  return value: %u\n", record->ReturnValue - 1);
+      }
+    }
+
+  for (i = 0; i < header->NumberOfValues; i++)
+    {
+    const BinaryValue *record = &info->Values[i];
+    fprintf(fp, "value %u: type %u access %u flags 0x%x name ",
+            i, record->ItemType, record->Access, record->Flags);
+    binary_print_string(fp, info, record->Name);
+    fprintf(fp, " type 0x%x ", record->Type);
+    binary_print_string(fp, info, record->TypeName);
+    fputs(" value ", fp);
+    binary_print_string(fp, info, record->Value);
+    fputc('\n', fp);
+    if (record->Comment || record->Count || record->CountHint)
+      {
+      fputs("  comment ", fp);
+      binary_print_string(fp, info, record->Comment);
+      fprintf(fp, " count %u count hint ", record->Count);
+      binary_print_string(fp, info, record->CountHint);
+      fputc('\n', fp);
+      }
+    binary_print_list(fp, info, "dimensions", record->Dimensions, 1);
+    if (record->Function)
+      {
+      fprintf(fp, "  function: %u\n", record->Function - 1);
+      }
+    binary_print_template(fp, info, record->Template);
+    }
+
+  for (i = 0; i < header->NumberOfUsings; i++)
+    {
+    const BinaryUsing *record = &info->Usings[i];
+    fprintf(fp, "using %u: type %u access %u name ",
+            i, record->ItemType, record->Access);
+    binary_print_string(fp, info, record->Name);
+    fputs(" scope ", fp);
+    binary_print_string(fp, info, record->Scope);
+    fputs(" comment ", fp);
+    binary_print_string(fp, info, record->Comment);
+    fputc('\n', fp);
+    }
+
+  for (i = 0; i < header->NumberOfComments; i++)
+    {
+    const BinaryComment *record = &info->Comments[i];
+    fprintf(fp, "comment %u: type %u name ", i, record->Type);
+    binary_print_string(fp, info, record->Name);
+    fputc(' ', fp);
+    binary_print_string(fp, info, record->Comment);
+    fputc('\n', fp);
+    }
+}
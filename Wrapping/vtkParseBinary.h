@@ -0,0 +1,273 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkParseBinary.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+/**
+ This file provides a compact binary form of the FileInfo that is
+ produced by the parser, so that tools can read the interface of a
+ header without parsing XML.  The file starts with "VTKFINFO" and a
+ header that gives the version, the FileInfo strings, and the position
+ of each table.  The header is followed by fixed-size records for the
+ classes (which include the namespaces and enums), the functions, the
+ values, the usings, and the comments, and then by a table of lists
+ and a table of strings.
+
+ Records refer to other records by index rather than by pointer, and
+ refer to strings by offset into the string table, where offset zero
+ is NULL.  A single record is written for each struct, so a ValueInfo
+ that appears in more than one array will have a single index.
+
+ Lists, such as the parameters of a function, are stored in the list
+ table as a count followed by the items, and a record refers to a list
+ by its offset in the list table.  Offset zero is an empty list, or a
+ NULL template.  An item list holds a count followed by a pair of
+ (ItemType, Index) for each item, where the Index is the position of
+ the item within the corresponding list of the same class.
+
+ The reader maps the file into memory and checks every index and
+ offset once, so that the records can then be used in place.  The
+ included files of a FileInfo are not stored.
+*/
+
+#ifndef VTK_PARSE_BINARY_H
+#define VTK_PARSE_BINARY_H
+
+#include "vtkParseData.h"
+#include "vtkParsePreprocess.h"
+#include <stddef.h>
+#include <stdio.h>
+
+/**
+ * The version of the file format, which is checked by the reader.
+ */
+#define VTK_PARSE_BINARY_VERSION 1
+
+/**
+ * Flags for the classes.
+ */
+#define VTK_PARSE_BINARY_ABSTRACT     0x0001u
+#define VTK_PARSE_BINARY_FINAL        0x0002u
+#define VTK_PARSE_BINARY_HAS_DELETE   0x0004u
+
+/**
+ * Flags for the functions.
+ */
+#define VTK_PARSE_BINARY_OPERATOR     0x0001u
+#define VTK_PARSE_BINARY_VARIADIC     0x0002u
+#define VTK_PARSE_BINARY_LEGACY       0x0004u
+#define VTK_PARSE_BINARY_STATIC       0x0008u
+#define VTK_PARSE_BINARY_VIRTUAL      0x0010u
+#define VTK_PARSE_BINARY_PURE_VIRTUAL 0x0020u
+#define VTK_PARSE_BINARY_CONST        0x0040u
+#define VTK_PARSE_BINARY_DELETED      0x0080u
+#define VTK_PARSE_BINARY_FINAL_METHOD 0x0100u
+#define VTK_PARSE_BINARY_EXPLICIT     0x0200u
+
+/**
+ * Flags for the values, which also use VTK_PARSE_BINARY_STATIC.
+ */
+#define VTK_PARSE_BINARY_ENUM         0x0001u
+#define VTK_PARSE_BINARY_PACK         0x0002u
+
+/**
+ * The header, which also holds the FileInfo.  The offsets of the
+ * tables are from the start of the file.
+ */
+typedef struct _BinaryFileHeader
+{
+  char          Magic[8];
+  unsigned int  ByteOrder;
+  unsigned int  Version;
+  unsigned int  FileSize;
+  unsigned int  FileName;          /* string */
+  unsigned int  NameComment;       /* string */
+  unsigned int  Description;       /* string */
+  unsigned int  Caveats;           /* string */
+  unsigned int  SeeAlso;           /* string */
+  unsigned int  MainClass;         /* class index plus one, or zero */
+  unsigned int  Contents;          /* class index plus one, or zero */
+  unsigned int  NumberOfClasses;
+  unsigned int  ClassOffset;
+  unsigned int  NumberOfFunctions;
+  unsigned int  FunctionOffset;
+  unsigned int  NumberOfValues;
+  unsigned int  ValueOffset;
+  unsigned int  NumberOfUsings;
+  unsigned int  UsingOffset;
+  unsigned int  NumberOfComments;
+  unsigned int  CommentOffset;
+  unsigned int  ListOffset;
+  unsigned int  ListSize;          /* the number of ints in the lists */
+  unsigned int  StringOffset;
+  unsigned int  StringSize;
+  unsigned int  Reserved;
+} BinaryFileHeader;
+
+/**
+ * A ClassInfo, which can also be a namespace or an enum.
+ */
+typedef struct _BinaryClass
+{
+  unsigned int  ItemType;
+  unsigned int  Access;
+  unsigned int  Name;              /* string */
+  unsigned int  Comment;           /* string */
+  unsigned int  Template;          /* list of values, or zero */
+  unsigned int  SuperClasses;      /* list of strings */
+  unsigned int  Items;             /* list of (ItemType, Index) */
+  unsigned int  Classes;           /* list of classes */
+  unsigned int  Functions;         /* list of functions */
+  unsigned int  Constants;         /* list of values */
+  unsigned int  Variables;         /* list of values */
+  unsigned int  Enums;             /* list of classes */
+  unsigned int  Typedefs;          /* list of values */
+  unsigned int  Usings;            /* list of usings */
+  unsigned int  Namespaces;        /* list of classes */
+  unsigned int  Comments;          /* list of comments */
+  unsigned int  Flags;
+  unsigned int  Reserved;
+} BinaryClass;
+
+/**
+ * A FunctionInfo, without the legacy information.
+ */
+typedef struct _BinaryFunction
+{
+  unsigned int  ItemType;
+  unsigned int  Access;
+  unsigned int  Name;              /* string */
+  unsigned int  Comment;           /* string */
+  unsigned int  Class;             /* string */
+  unsigned int  Signature;         /* string */
+  unsigned int  Template;          /* list of values, or zero */
+  unsigned int  Parameters;        /* list of values */
+  unsigned int  ReturnValue;       /* value index plus one, or zero */
+  unsigned int  Macro;             /* string */
+  unsigned int  SizeHint;          /* string */
+  unsigned int  Flags;
+} BinaryFunction;
+
+/**
+ * A ValueInfo.
+ */
+typedef struct _BinaryValue
+{
+  unsigned int  ItemType;
+  unsigned int  Access;
+  unsigned int  Name;              /* string */
+  unsigned int  Comment;           /* string */
+  unsigned int  Value;             /* string */
+  unsigned int  Type;
+  unsigned int  TypeName;          /* string */
+  unsigned int  Count;
+  unsigned int  CountHint;         /* string */
+  unsigned int  Dimensions;        /* list of strings */
+  unsigned int  Function;          /* function index plus one, or zero */
+  unsigned int  Template;          /* list of values, or zero */
+  unsigned int  Flags;
+  unsigned int  Reserved;
+} BinaryValue;
+
+/**
+ * A UsingInfo.
+ */
+typedef struct _BinaryUsing
+{
+  unsigned int  ItemType;
+  unsigned int  Access;
+  unsigned int  Name;              /* string */
+  unsigned int  Comment;           /* string */
+  unsigned int  Scope;             /* string */
+  unsigned int  Reserved;
+} BinaryUsing;
+
+/**
+ * A CommentInfo.
+ */
+typedef struct _BinaryComment
+{
+  unsigned int  Type;
+  unsigned int  Comment;           /* string */
+  unsigned int  Name;              /* string */
+  unsigned int  Reserved;
+} BinaryComment;
+
+/**
+ * A binary file that has been loaded, the tables point into the file.
+ */
+typedef struct _BinaryFileInfo
+{
+  const BinaryFileHeader *Header;
+  const BinaryClass      *Classes;
+  const BinaryFunction   *Functions;
+  const BinaryValue      *Values;
+  const BinaryUsing      *Usings;
+  const BinaryComment    *Comments;
+  const unsigned int     *Lists;
+  const char             *Strings;
+  FileBuffer              Contents;  /* for internal use only */
+} BinaryFileInfo;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Pack a FileInfo into the binary form, and return the data and its
+ * size.  The data must be freed with free().  Returns NULL if the
+ * data would be larger than the 32-bit offsets allow.
+ */
+char *vtkParseBinary_Pack(const FileInfo *data, size_t *size);
+
+/**
+ * Map a binary file into memory, or return NULL if the file cannot
+ * be read or if it is not valid.
+ */
+BinaryFileInfo *vtkParseBinary_ReadFile(const char *filename);
+
+/**
+ * Unmap the file and free the BinaryFileInfo.
+ */
+void vtkParseBinary_Free(BinaryFileInfo *info);
+
+/**
+ * Get a string from its offset, or NULL if the offset is zero.
+ */
+const char *vtkParseBinary_GetString(
+  const BinaryFileInfo *info, unsigned int offset);
+
+/**
+ * Get the number of items in a list.  For an item list, this is the
+ * number of (ItemType, Index) pairs.
+ */
+unsigned int vtkParseBinary_GetListSize(
+  const BinaryFileInfo *info, unsigned int offset);
+
+/**
+ * Get the items in a list.
+ */
+const unsigned int *vtkParseBinary_GetList(
+  const BinaryFileInfo *info, unsigned int offset);
+
+/**
+ * Print all of the records in a human-readable form, for debugging.
+ * References between records are printed as indices.
+ */
+void vtkParseBinary_Print(FILE *fp, const BinaryFileInfo *info);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif
@@ -23,6 +23,129 @@
 #include <stdlib.h>
 #include <string.h>
 
+/* The size of the first arena chunk, and the largest size that the
+ * chunks will grow to as more chunks are added */
+#define PARSE_ARENA_CHUNK_SIZE 16384
+#define PARSE_ARENA_MAX_CHUNK_SIZE 1048576
+
+/* The free methods take the arena that the structs might belong to */
+static void parse_free_template(TemplateInfo *, const ParseArena *);
+static void parse_free_function(FunctionInfo *, const ParseArena *);
+static void parse_free_value(ValueInfo *, const ParseArena *);
+static void parse_free_class(ClassInfo *, const ParseArena *);
+
+/* Initialize an arena */
+void vtkParse_InitArena(ParseArena *arena)
+{
+  arena->NumberOfChunks = 0;
+  arena->Chunks = NULL;
+  arena->ChunkSizes = NULL;
+  arena->Position = 0;
+}
+
+/* Allocate a struct from an arena, or with malloc if arena is NULL */
+void *vtkParse_NewStruct(ParseArena *arena, size_t size)
+{
+  unsigned long n;
+  size_t chunksize;
+  char *cp;
+
+  if (arena == NULL)
+    {
+    return malloc(size);
+    }
+
+  /* keep everything aligned on an 8-byte boundary */
+  size = ((size + 7) | 7) - 7;
+
+  n = arena->NumberOfChunks;
+  if (n == 0 || arena->Position + size > arena->ChunkSizes[n-1])
+    {
+    /* each chunk is twice as large as the previous one */
+    chunksize = PARSE_ARENA_CHUNK_SIZE;
+    if (n > 0)
+      {
+      chunksize = arena->ChunkSizes[n-1];
+      if (chunksize < PARSE_ARENA_MAX_CHUNK_SIZE)
+        {
+        chunksize *= 2;
+        }
+      }
+    if (size > chunksize)
+      {
+      chunksize = size;
+      }
+
+    /* if empty, alloc for the first time */
+    if (n == 0)
+      {
+      arena->Chunks = (char **)malloc(sizeof(char *));
+      arena->ChunkSizes = (size_t *)malloc(sizeof(size_t));
+      }
+    /* if count is power of two, reallocate with double size */
+    else if ((n & (n-1)) == 0)
+      {
+      arena->Chunks = (char **)realloc(arena->Chunks, 2*n*sizeof(char *));
+      arena->ChunkSizes = (size_t *)realloc(
+        arena->ChunkSizes, 2*n*sizeof(size_t));
+      }
+
+    arena->Chunks[n] = (char *)malloc(chunksize);
+    arena->ChunkSizes[n] = chunksize;
+    arena->NumberOfChunks = ++n;
+    arena->Position = 0;
+    }
+
+  cp = &arena->Chunks[n-1][arena->Position];
+  arena->Position += size;
+
+  return cp;
+}
+
+/* Check whether a struct was allocated from the arena */
+int vtkParse_ArenaOwns(const ParseArena *arena, const void *ptr)
+{
+  unsigned long i;
+
+  if (arena)
+    {
+    /* search backwards, since the later chunks are the largest */
+    for (i = arena->NumberOfChunks; i > 0; i--)
+      {
+      if ((size_t)ptr - (size_t)arena->Chunks[i-1] < arena->ChunkSizes[i-1])
+        {
+        return 1;
+        }
+      }
+    }
+
+  return 0;
+}
+
+/* Free all the structs in the arena */
+void vtkParse_FreeArena(ParseArena *arena)
+{
+  unsigned long i;
+
+  for (i = 0; i < arena->NumberOfChunks; i++)
+    {
+    free(arena->Chunks[i]);
+    }
+  free(arena->Chunks);
+  free(arena->ChunkSizes);
+
+  vtkParse_InitArena(arena);
+}
+
+/* Free a struct unless it belongs to the arena */
+static void parse_free_struct(void *ptr, const ParseArena *arena)
+{
+  if (!vtkParse_ArenaOwns(arena, ptr))
+    {
+    free(ptr);
+    }
+}
+
 /* Initialize the FileInfo struct */
 void vtkParse_InitFile(FileInfo *file_info)
 {
@@ -39,6 +162,7 @@ void vtkParse_InitFile(FileInfo *file_info)
   file_info->Contents = NULL;
 
   file_info->Strings = NULL;
+  file_info->Arena = NULL;
 }
 
 /* Free the FileInfo struct */
@@ -57,7 +181,7 @@ void vtkParse_FreeFile(FileInfo *file_info)
     free(file_info->Includes);
     }
 
-  vtkParse_FreeNamespace(file_info->Contents);
+  parse_free_class(file_info->Contents, file_info->Arena);
   file_info->Contents = NULL;
 }
 
@@ -83,6 +207,22 @@ void vtkParse_FreeComment(CommentInfo *info)
   free(info);
 }
 
+/* Free a TemplateInfo struct */
+static void parse_free_template(
+  TemplateInfo *template_info, const ParseArena *arena)
+{
+  unsigned long j, m;
+
+  m = template_info->NumberOfParameters;
+  for (j = 0; j < m; j++)
+    {
+    parse_free_value(template_info->Parameters[j], arena);
+    }
+  if (m > 0) { free(template_info->Parameters); }
+
+  parse_free_struct(template_info, arena);
+}
+
 /* Initialize a TemplateInfo struct */
 void vtkParse_InitTemplate(TemplateInfo *info)
 {
@@ -109,15 +249,7 @@ void vtkParse_CopyTemplate(TemplateInfo *info, const TemplateInfo *orig)
 /* Free a TemplateInfo struct */
 void vtkParse_FreeTemplate(TemplateInfo *template_info)
 {
-  unsigned long j, m;
-
-  m = template_info->NumberOfParameters;
-  for (j = 0; j < m; j++)
-    {
-    vtkParse_FreeValue(template_info->Parameters[j]);
-    }
-
-  free(template_info);
+  parse_free_template(template_info, NULL);
 }
 
 
@@ -245,25 +377,137 @@ void vtkParse_CopyFunction(FunctionInfo *func, const FunctionInfo *orig)
 }
 
 /* Free a Function struct */
-void vtkParse_FreeFunction(FunctionInfo *function_info)
+static void parse_free_function(
+  FunctionInfo *function_info, const ParseArena *arena)
 {
   unsigned long j, m;
 
   if (function_info->Template)
     {
-    vtkParse_FreeTemplate(function_info->Template);
+    parse_free_template(function_info->Template, arena);
     }
 
   m = function_info->NumberOfParameters;
-  for (j = 0; j < m; j++) { vtkParse_FreeValue(function_info->Parameters[j]); }
+  for (j = 0; j < m; j++)
+    {
+    parse_free_value(function_info->Parameters[j], arena);
+    }
   if (m > 0) { free(function_info->Parameters); }
 
   if (function_info->ReturnValue)
     {
-    vtkParse_FreeValue(function_info->ReturnValue);
+    parse_free_value(function_info->ReturnValue, arena);
+    }
+
+  parse_free_struct(function_info, arena);
+}
+
+/* Free a Function struct */
+void vtkParse_FreeFunction(FunctionInfo *function_info)
+{
+  parse_free_function(function_info, NULL);
+}
+
+/* Check for the legacy callback signature "void (*func)(void *)" */
+static int parse_legacy_callback(const FunctionInfo *func)
+{
+  return (func && func->NumberOfParameters == 1 &&
+          func->Parameters[0]->Type == VTK_PARSE_VOID_PTR &&
+          func->Parameters[0]->NumberOfDimensions == 0 &&
+          func->ReturnValue &&
+          func->ReturnValue->Type == VTK_PARSE_VOID);
+}
+
+/* Compute the legacy information for a function */
+void vtkParse_GetLegacyInfo(
+  const FunctionInfo *func, FunctionLegacyInfo *info)
+{
+  const ValueInfo *param;
+  unsigned long i, n;
+
+  n = func->NumberOfParameters;
+  info->NumberOfArguments = (n < MAX_ARGS ? n : MAX_ARGS);
+  info->ArrayFailure = (n > MAX_ARGS);
+
+  for (i = 0; i < MAX_ARGS; i++)
+    {
+    info->ArgTypes[i] = 0;
+    info->ArgClasses[i] = NULL;
+    info->ArgCounts[i] = 0;
     }
 
-  free(function_info);
+  for (i = 0; i < info->NumberOfArguments; i++)
+    {
+    param = func->Parameters[i];
+    info->ArgTypes[i] = param->Type;
+    info->ArgClasses[i] = param->TypeName;
+    info->ArgCounts[i] = param->Count;
+
+    /* legacy wrappers need VTK_PARSE_FUNCTION without POINTER */
+    if (param->Type == VTK_PARSE_FUNCTION_PTR &&
+        parse_legacy_callback(param->Function))
+      {
+      info->ArgTypes[i] = VTK_PARSE_FUNCTION;
+      }
+    }
+
+  /* a void argument is the same as no parameters */
+  if (info->NumberOfArguments == 1 &&
+      (info->ArgTypes[0] & VTK_PARSE_UNQUALIFIED_TYPE) == VTK_PARSE_VOID)
+    {
+    info->NumberOfArguments = 0;
+    }
+
+  info->ReturnType = VTK_PARSE_VOID;
+  info->ReturnClass = NULL;
+  info->HaveHint = 0;
+  info->HintSize = 0;
+  if (func->ReturnValue)
+    {
+    info->ReturnType = func->ReturnValue->Type;
+    info->ReturnClass = func->ReturnValue->TypeName;
+    if (func->ReturnValue->Count > 0)
+      {
+      info->HaveHint = 1;
+      info->HintSize = func->ReturnValue->Count;
+      }
+    }
+
+  /* if return type is void, set return class to void */
+  if (info->ReturnClass == NULL &&
+      (info->ReturnType & VTK_PARSE_UNQUALIFIED_TYPE) == VTK_PARSE_VOID)
+    {
+    info->ReturnClass = "void";
+    }
+
+  info->IsPublic = (func->Access == VTK_ACCESS_PUBLIC);
+  info->IsProtected = (func->Access == VTK_ACCESS_PROTECTED);
+
+  /* tell old wrappers that multi-dimensional arrays are bad */
+  for (i = 0; i < n; i++)
+    {
+    param = func->Parameters[i];
+    if ((param->Type & VTK_PARSE_POINTER_MASK) != 0)
+      {
+      if (((param->Type & VTK_PARSE_BASE_TYPE) == VTK_PARSE_FUNCTION) ||
+          ((param->Type & VTK_PARSE_INDIRECT) == VTK_PARSE_BAD_INDIRECT) ||
+          ((param->Type & VTK_PARSE_POINTER_LOWMASK) != VTK_PARSE_POINTER))
+        {
+        info->ArrayFailure = 1;
+        }
+      }
+
+    /* allow only "void (*func)(void *)" as a valid function pointer */
+    if ((param->Type & VTK_PARSE_BASE_TYPE) == VTK_PARSE_FUNCTION)
+      {
+      if (i != 0 || param->Type != VTK_PARSE_FUNCTION_PTR || n != 2 ||
+          func->Parameters[1]->Type != VTK_PARSE_VOID_PTR ||
+          !parse_legacy_callback(param->Function))
+        {
+        info->ArrayFailure = 1;
+        }
+      }
+    }
 }
 
 
@@ -334,7 +578,7 @@ void vtkParse_CopyValue(ValueInfo *val, const ValueInfo *orig)
 }
 
 /* Free a Value struct */
-void vtkParse_FreeValue(ValueInfo *value_info)
+static void parse_free_value(ValueInfo *value_info, const ParseArena *arena)
 {
   if (value_info->NumberOfDimensions)
     {
@@ -342,14 +586,26 @@ void vtkParse_FreeValue(ValueInfo *value_info)
     }
   if (value_info->Function)
     {
-    vtkParse_FreeFunction(value_info->Function);
+    parse_free_function(value_info->Function, arena);
     }
   if (value_info->Template)
     {
-    vtkParse_FreeTemplate(value_info->Template);
+    parse_free_template(value_info->Template, arena);
     }
 
-  free(value_info);
+  parse_free_struct(value_info, arena);
+}
+
+/* Free a Value struct */
+void vtkParse_FreeValue(ValueInfo *value_info)
+{
+  parse_free_value(value_info, NULL);
+}
+
+/* Free a Value struct that might be in an arena */
+void vtkParse_FreeValueInArena(ValueInfo *value_info, const ParseArena *arena)
+{
+  parse_free_value(value_info, arena);
 }
 
 
@@ -589,54 +845,78 @@ void vtkParse_CopyClass(ClassInfo *cls, const ClassInfo *orig)
 }
 
 /* Free a Class struct */
-void vtkParse_FreeClass(ClassInfo *class_info)
+static void parse_free_class(ClassInfo *class_info, const ParseArena *arena)
 {
   unsigned long j, m;
 
-  if (class_info->Template) { vtkParse_FreeTemplate(class_info->Template); }
+  if (class_info->Template)
+    {
+    parse_free_template(class_info->Template, arena);
+    }
 
   m = class_info->NumberOfSuperClasses;
   if (m > 0) { free((char **)class_info->SuperClasses); }
 
   m = class_info->NumberOfClasses;
-  for (j = 0; j < m; j++) { vtkParse_FreeClass(class_info->Classes[j]); }
+  for (j = 0; j < m; j++) { parse_free_class(class_info->Classes[j], arena); }
   if (m > 0) { free(class_info->Classes); }
 
   m = class_info->NumberOfFunctions;
-  for (j = 0; j < m; j++) { vtkParse_FreeFunction(class_info->Functions[j]); }
+  for (j = 0; j < m; j++)
+    {
+    parse_free_function(class_info->Functions[j], arena);
+    }
   if (m > 0) { free(class_info->Functions); }
 
   m = class_info->NumberOfConstants;
-  for (j = 0; j < m; j++) { vtkParse_FreeValue(class_info->Constants[j]); }
+  for (j = 0; j < m; j++)
+    {
+    parse_free_value(class_info->Constants[j], arena);
+    }
   if (m > 0) { free(class_info->Constants); }
 
   m = class_info->NumberOfVariables;
-  for (j = 0; j < m; j++) { vtkParse_FreeValue(class_info->Variables[j]); }
+  for (j = 0; j < m; j++)
+    {
+    parse_free_value(class_info->Variables[j], arena);
+    }
   if (m > 0) { free(class_info->Variables); }
 
   m = class_info->NumberOfEnums;
-  for (j = 0; j < m; j++) { vtkParse_FreeEnum(class_info->Enums[j]); }
+  for (j = 0; j < m; j++) { parse_free_struct(class_info->Enums[j], arena); }
   if (m > 0) { free(class_info->Enums); }
 
   m = class_info->NumberOfTypedefs;
-  for (j = 0; j < m; j++) { vtkParse_FreeValue(class_info->Typedefs[j]); }
+  for (j = 0; j < m; j++) { parse_free_value(class_info->Typedefs[j], arena); }
   if (m > 0) { free(class_info->Typedefs); }
 
   m = class_info->NumberOfUsings;
-  for (j = 0; j < m; j++) { vtkParse_FreeUsing(class_info->Usings[j]); }
+  for (j = 0; j < m; j++) { parse_free_struct(class_info->Usings[j], arena); }
   if (m > 0) { free(class_info->Usings); }
 
   m = class_info->NumberOfNamespaces;
-  for (j = 0; j < m; j++) { vtkParse_FreeNamespace(class_info->Namespaces[j]); }
+  for (j = 0; j < m; j++)
+    {
+    parse_free_class(class_info->Namespaces[j], arena);
+    }
   if (m > 0) { free(class_info->Namespaces); }
 
   if (class_info->NumberOfItems > 0) { free(class_info->Items); }
 
   m = class_info->NumberOfComments;
-  for (j = 0; j < m; j++) { vtkParse_FreeComment(class_info->Comments[j]); }
+  for (j = 0; j < m; j++)
+    {
+    parse_free_struct(class_info->Comments[j], arena);
+    }
   if (m > 0) { free(class_info->Comments); }
 
-  free(class_info);
+  parse_free_struct(class_info, arena);
+}
+
+/* Free a Class struct */
+void vtkParse_FreeClass(ClassInfo *class_info)
+{
+  parse_free_class(class_info, NULL);
 }
 
 
@@ -30,9 +30,7 @@
 #include "vtkParseString.h"
 
 /* legacy */
-#ifndef VTK_PARSE_LEGACY_REMOVE
 #define MAX_ARGS 20
-#endif
 
 /**
  * Access flags
@@ -181,16 +179,16 @@ struct _FunctionInfo
   ValueInfo     *ReturnValue; /* NULL for constructors and destructors */
   const char    *Macro;       /* the macro that defined this function */
   const char    *SizeHint;    /* hint the size e.g. for operator[] */
-  int            IsOperator;
-  int            IsVariadic;
-  int            IsLegacy;    /* marked as a legacy method or function */
-  int            IsStatic;    /* methods only */
-  int            IsVirtual;   /* methods only */
-  int            IsPureVirtual; /* methods only */
-  int            IsConst;     /* methods only */
-  int            IsDeleted;   /* methods only */
-  int            IsFinal;     /* methods only */
-  int            IsExplicit;  /* constructors only */
+  unsigned int   IsOperator : 1;
+  unsigned int   IsVariadic : 1;
+  unsigned int   IsLegacy : 1;    /* marked as legacy method or function */
+  unsigned int   IsStatic : 1;    /* methods only */
+  unsigned int   IsVirtual : 1;   /* methods only */
+  unsigned int   IsPureVirtual : 1; /* methods only */
+  unsigned int   IsConst : 1;     /* methods only */
+  unsigned int   IsDeleted : 1;   /* methods only */
+  unsigned int   IsFinal : 1;     /* methods only */
+  unsigned int   IsExplicit : 1;  /* constructors only */
 #ifndef VTK_PARSE_LEGACY_REMOVE
   unsigned long  NumberOfArguments;   /* legacy */
   unsigned int   ArgTypes[MAX_ARGS];  /* legacy */
@@ -206,6 +204,27 @@ struct _FunctionInfo
 #endif
 };
 
+/**
+ * FunctionLegacyInfo holds the information that old wrappers used for
+ * each function.  When VTK_PARSE_LEGACY_REMOVE is defined, FunctionInfo
+ * no longer stores this information, and vtkParse_GetLegacyInfo() must
+ * be used to compute it from the Parameters and the ReturnValue.
+ */
+typedef struct _FunctionLegacyInfo
+{
+  unsigned long  NumberOfArguments;
+  unsigned int   ArgTypes[MAX_ARGS];
+  const char    *ArgClasses[MAX_ARGS];
+  unsigned long  ArgCounts[MAX_ARGS];
+  unsigned int   ReturnType;
+  const char    *ReturnClass;
+  int            HaveHint;
+  unsigned long  HintSize;
+  int            ArrayFailure;
+  int            IsPublic;
+  int            IsProtected;
+} FunctionLegacyInfo;
+
 /**
  * UsingInfo is for using directives
  */
@@ -267,6 +286,21 @@ typedef struct _ClassInfo EnumInfo;
  */
 typedef struct _ClassInfo NamespaceInfo;
 
+/**
+ * ParseArena provides the memory for the structs of a FileInfo.  The
+ * structs are allocated from large chunks, and rather than being freed
+ * one at a time, they are all freed together with the arena.  The
+ * arrays within the structs are not allocated from the arena, since
+ * they can grow after the parse is done.
+ */
+typedef struct _ParseArena
+{
+  unsigned long  NumberOfChunks;
+  char         **Chunks;
+  size_t        *ChunkSizes;
+  size_t         Position;  /* position within the last chunk */
+} ParseArena;
+
 /**
  * FileInfo is for header files
  */
@@ -283,6 +317,7 @@ struct _FileInfo
   ClassInfo *MainClass;
   NamespaceInfo *Contents;
   StringCache *Strings;
+  ParseArena *Arena;  /* owns the structs, or NULL if they were malloc'd */
 };
 
 
@@ -339,6 +374,32 @@ void vtkParse_FreeComment(CommentInfo *arg);
 /*@}*/
 
 
+/**
+ * Free a ValueInfo that was allocated with vtkParse_NewStruct().  Any
+ * structs that belong to the arena are left for vtkParse_FreeArena().
+ */
+void vtkParse_FreeValueInArena(ValueInfo *val, const ParseArena *arena);
+
+/**
+ * Arena methods
+ *
+ * The vtkParse_NewStruct() method allocates memory from the arena, or
+ * allocates it with malloc() if the arena is NULL.  The free methods
+ * for FileInfo will not free any structs that belong to the arena.
+ */
+/*@{*/
+void vtkParse_InitArena(ParseArena *arena);
+void *vtkParse_NewStruct(ParseArena *arena, size_t size);
+int vtkParse_ArenaOwns(const ParseArena *arena, const void *ptr);
+void vtkParse_FreeArena(ParseArena *arena);
+/*@}*/
+
+/**
+ * Compute the legacy information for a function.
+ */
+void vtkParse_GetLegacyInfo(
+  const FunctionInfo *func, FunctionLegacyInfo *info);
+
 /**
  * Add a string to an array of strings, grow array as necessary.
  */
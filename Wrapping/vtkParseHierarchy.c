@@ -21,11 +21,129 @@
 
 #include "vtkParseHierarchy.h"
 #include "vtkParseExtras.h"
+#include "vtkParsePreprocess.h"
+#include "vtkParseThreads.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <ctype.h>
 #include <assert.h>
+#if defined(_WIN32)
+# include <process.h>
+# define getpid _getpid
+#else
+# include <unistd.h>
+#endif
+
+/* The binary file has a header, then the entries sorted by name, then
+ * the hash table for finding entries by name, then the lists of
+ * strings that the entries use, and then the strings.
+ * The lists hold offsets into the strings, and zero is used for NULL.
+ * The byte order is checked so that a file from a machine with the
+ * wrong byte order will be rejected. */
+#define HIERARCHY_FILE_MAGIC "VTKHIER2"
+#define HIERARCHY_FILE_BYTE_ORDER 0x01020304u
+
+/* The initial value for hierarchy_hash() */
+#define HIERARCHY_HASH_INIT 5381u
+
+/* Flags for the entries in the binary file */
+#define HIERARCHY_FILE_ENUM    0x01u
+#define HIERARCHY_FILE_TYPEDEF 0x02u
+
+/* The header of the binary file, the offsets are from start of file */
+typedef struct _HierarchyFileHeader
+{
+  char          Magic[8];
+  unsigned int  ByteOrder;
+  unsigned int  NumberOfEntries;
+  unsigned int  EntryOffset;
+  unsigned int  HashOffset;
+  unsigned int  HashTableSize;   /* the number of slots, a power of two */
+  unsigned int  ListOffset;
+  unsigned int  ListSize;        /* the number of items in the lists */
+  unsigned int  StringOffset;
+  unsigned int  StringSize;
+  unsigned int  FileSize;
+  unsigned int  Reserved;
+} HierarchyFileHeader;
+
+/* An entry in the binary file, with typedefs already decoded */
+typedef struct _HierarchyFileEntry
+{
+  unsigned int  Name;
+  unsigned int  HeaderFile;
+  unsigned int  Module;
+  unsigned int  Flags;
+  unsigned int  NumberOfTemplateParameters;
+  unsigned int  TemplateParameters; /* the parameters, then defaults */
+  unsigned int  NumberOfSuperClasses;
+  unsigned int  SuperClasses;
+  unsigned int  NumberOfProperties;
+  unsigned int  Properties;
+  unsigned int  TypedefType;
+  unsigned int  TypedefCount;
+  unsigned int  TypedefTypeName;
+  unsigned int  NumberOfDimensions;
+  unsigned int  Dimensions;
+  unsigned int  Reserved;
+} HierarchyFileEntry;
+
+/* A binary hierarchy file that has been loaded into memory */
+struct _HierarchyFile
+{
+  FileBuffer                Contents;
+  const HierarchyFileEntry *Entries;
+  const unsigned int       *Lists;
+  const char               *Strings;
+  unsigned int              ListSize;
+  unsigned int              StringSize;
+  vtkParseMutex            *Mutex;    /* guards the unpacking of entries */
+};
+
+/* A baseclass name with template args that was found by IsTypeOf */
+typedef struct _HierarchySubstitution
+{
+  unsigned int  Hash;
+  int           Entry;
+  const char   *ClassName;   /* all three strings are in one block */
+  const char   *BaseClass;
+  const char   *Result;
+} HierarchySubstitution;
+
+/* The results that are cached by IsTypeOf.  For each entry, the list
+ * of ancestors holds the count followed by the sorted indices of the
+ * entry and all its superclasses, where each index is the index of
+ * the first entry with that name.  The lists are built as needed.
+ * The mutex guards the cache and the SuperClassIndex of the entries,
+ * so that several threads can share the same HierarchyInfo. */
+struct _HierarchyCache
+{
+  int                  **Ancestors;
+  HierarchySubstitution *Substitutions;
+  size_t                 SubstitutionTableSize;
+  size_t                 NumberOfSubstitutions;
+  vtkParseMutex         *Mutex;
+};
+
+/* Markers for ancestor lists that are being built, or that cannot be
+ * built because a superclass lookup depends on the template args */
+static int hierarchy_ancestors_pending[1] = { 0 };
+static int hierarchy_ancestors_unknown[1] = { 0 };
+
+/* The strings and lists that are collected to write a binary file */
+typedef struct _HierarchyFileWriter
+{
+  char          *Strings;
+  size_t         StringSize;
+  size_t         MaxStringSize;
+  unsigned int  *HashTable;     /* string offsets, zero if empty */
+  size_t         HashTableSize; /* always a power of two */
+  size_t         NumberOfStrings;
+  unsigned int  *Lists;
+  size_t         ListSize;
+  size_t         MaxListSize;
+} HierarchyFileWriter;
 
 static size_t skip_space(const char *text)
 {
@@ -102,60 +220,433 @@ static void sort_hierarchy_entries(HierarchyInfo *info)
         &compare_hierarchy_entries);
 }
 
-/* Find an entry with a binary search */
-HierarchyEntry *vtkParseHierarchy_FindEntry(
-  const HierarchyInfo *info, const char *classname)
+/* Get a string from a binary file, offsets past the end give NULL */
+static const char *hierarchy_file_string(
+  const HierarchyFile *file, unsigned int offset)
 {
-  HierarchyEntry key;
-  HierarchyEntry *entry;
-  size_t i, n;
-  char name[32];
-  char *cp;
+  if (offset == 0 || offset >= file->StringSize)
+    {
+    return NULL;
+    }
 
-  /* use classname as-is for the search if possible */
-  cp = (char *)classname;
+  return &file->Strings[offset];
+}
 
-  /* get portion of name before final template parameters */
-  n = vtkParse_UnscopedNameLength(classname);
-  i = 0;
-  while (classname[i+n] == ':' && classname[i+n+1] == ':')
+/* Get a list of strings from a binary file, or NULL if empty.  If
+ * "nullable" is not set, then empty strings are used instead of NULL */
+static const char **hierarchy_file_list(
+  const HierarchyFile *file, unsigned int start, unsigned int n,
+  int nullable)
+{
+  const char **list;
+  unsigned int i;
+
+  if (n == 0 || start > file->ListSize || n > file->ListSize - start)
     {
-    i += n + 2;
-    n = vtkParse_UnscopedNameLength(&classname[i]);
+    return NULL;
     }
-  i += vtkParse_IdentifierLength(&classname[i]);
 
-  /* create a new (shorter) search string if necessary */
-  if (classname[i] != '\0')
+  list = (const char **)malloc(n*sizeof(char *));
+  for (i = 0; i < n; i++)
     {
-    /* use stack space if possible */
-    cp = name;
-    /* otherwise, use malloc */
-    if (i > 31)
+    list[i] = hierarchy_file_string(file, file->Lists[start + i]);
+    if (list[i] == NULL && !nullable)
       {
-      cp = (char *)malloc(i+1);
+      list[i] = "";
       }
-    strncpy(cp, classname, i);
-    cp[i] = '\0';
     }
 
-  key.Name = cp;
+  return list;
+}
 
-  entry = (HierarchyEntry *)bsearch(&key, info->Entries,
-    info->NumberOfEntries, sizeof(HierarchyEntry),
-    &compare_hierarchy_entries);
+/* Unpack a record from a binary file into an entry */
+static void hierarchy_file_unpack_record(
+  const HierarchyFile *file, const HierarchyFileEntry *record,
+  HierarchyEntry *entry)
+{
+  unsigned int j, n;
 
-  if (cp != classname && cp != name)
+  entry->Name = hierarchy_file_string(file, record->Name);
+  if (entry->Name == NULL)
+    {
+    entry->Name = "";
+    }
+  entry->HeaderFile = hierarchy_file_string(file, record->HeaderFile);
+  entry->Module = hierarchy_file_string(file, record->Module);
+  entry->IsEnum = ((record->Flags & HIERARCHY_FILE_ENUM) != 0);
+  entry->IsTypedef = ((record->Flags & HIERARCHY_FILE_TYPEDEF) != 0);
+
+  n = record->NumberOfTemplateParameters;
+  entry->TemplateParameters = hierarchy_file_list(
+    file, record->TemplateParameters, n, 0);
+  entry->TemplateDefaults = hierarchy_file_list(
+    file, record->TemplateParameters + n, n, 1);
+  if (entry->TemplateParameters && entry->TemplateDefaults)
     {
-    free(cp);
+    entry->NumberOfTemplateParameters = (int)n;
     }
+  else
+    {
+    free((char **)entry->TemplateParameters);
+    free((char **)entry->TemplateDefaults);
+    entry->TemplateParameters = NULL;
+    entry->TemplateDefaults = NULL;
+    }
+
+  n = record->NumberOfSuperClasses;
+  entry->SuperClasses = hierarchy_file_list(
+    file, record->SuperClasses, n, 0);
+  if (entry->SuperClasses)
+    {
+    entry->NumberOfSuperClasses = (int)n;
+    entry->SuperClassIndex = (int *)malloc(n*sizeof(int));
+    for (j = 0; j < n; j++)
+      {
+      entry->SuperClassIndex[j] = -1;
+      }
+    }
+
+  n = record->NumberOfProperties;
+  entry->Properties = hierarchy_file_list(
+    file, record->Properties, n, 0);
+  if (entry->Properties)
+    {
+    entry->NumberOfProperties = (int)n;
+    }
+
+  if (entry->IsTypedef)
+    {
+    entry->Typedef = (ValueInfo *)malloc(sizeof(ValueInfo));
+    vtkParse_InitValue(entry->Typedef);
+    entry->Typedef->Type = record->TypedefType;
+    entry->Typedef->Count = (int)record->TypedefCount;
+    entry->Typedef->TypeName =
+      hierarchy_file_string(file, record->TypedefTypeName);
+    n = record->NumberOfDimensions;
+    entry->Typedef->Dimensions =
+      hierarchy_file_list(file, record->Dimensions, n, 0);
+    if (entry->Typedef->Dimensions)
+      {
+      entry->Typedef->NumberOfDimensions = (int)n;
+      }
+    }
+}
+
+/* Unpack an entry from a binary file, unless already unpacked.  The
+ * mutex allows several threads to share the same HierarchyInfo. */
+static HierarchyEntry *hierarchy_file_unpack_entry(
+  const HierarchyInfo *info, int i)
+{
+  const HierarchyFile *file = info->File;
+  HierarchyEntry *entry = &info->Entries[i];
+
+  /* the name is only NULL if the entry has not been unpacked */
+  vtkParseThreads_Lock(file->Mutex);
+  if (entry->Name == NULL)
+    {
+    hierarchy_file_unpack_record(file, &file->Entries[i], entry);
+    }
+  vtkParseThreads_Unlock(file->Mutex);
 
   return entry;
 }
 
+/* Add "n" chars to a hash, so that a name can be hashed in pieces */
+static unsigned int hierarchy_hash(
+  unsigned int h, const char *text, size_t n)
+{
+  size_t i;
 
-/* read a hierarchy file into a HeirarchyInfo struct, or return NULL */
-HierarchyInfo *vtkParseHierarchy_ReadFile(const char *filename)
+  for (i = 0; i < n; i++)
+    {
+    h = ((h << 5) + h) ^ (unsigned char)text[i];
+    }
+
+  return h;
+}
+
+/* Get the name of an entry without unpacking it.  For binary files,
+ * the name is always read from the file, since another thread might
+ * be unpacking the entry. */
+static const char *hierarchy_entry_name(const HierarchyInfo *info, int i)
+{
+  const char *name;
+
+  if (info->File == NULL)
+    {
+    return info->Entries[i].Name;
+    }
+
+  name = hierarchy_file_string(info->File, info->File->Entries[i].Name);
+  if (name == NULL)
+    {
+    name = "";
+    }
+
+  return name;
+}
+
+/* Do a binary search of the sorted entries, in the same way as bsearch(),
+ * to decide which entry is found if several entries have the same name */
+static int hierarchy_search(const HierarchyInfo *info, const char *name)
+{
+  size_t l = 0;
+  size_t u = (size_t)info->NumberOfEntries;
+  size_t i;
+  int r;
+
+  while (l < u)
+    {
+    i = (l + u)/2;
+    r = strcmp(name, hierarchy_entry_name(info, (int)i));
+    if (r < 0)
+      {
+      u = i;
+      }
+    else if (r > 0)
+      {
+      l = i + 1;
+      }
+    else
+      {
+      return (int)i;
+      }
+    }
+
+  return -1;
+}
+
+/* Build the hash table for the sorted entries, each slot in the table
+ * holds the hash of a name and the entry index plus one (or zero) */
+static unsigned int *hierarchy_build_hash_table(
+  const HierarchyInfo *info, unsigned long *sizep)
+{
+  unsigned int *table;
+  const char *name;
+  unsigned long size = 1;
+  unsigned long i, m;
+  unsigned int h;
+  int j, k;
+
+  while (size < 2*(unsigned long)info->NumberOfEntries)
+    {
+    size *= 2;
+    }
+  table = (unsigned int *)calloc(2*size, sizeof(unsigned int));
+
+  m = size - 1;
+  for (j = 0; j < info->NumberOfEntries; j++)
+    {
+    /* entries with the same name are next to each other */
+    name = hierarchy_entry_name(info, j);
+    if (j > 0 && strcmp(name, hierarchy_entry_name(info, j-1)) == 0)
+      {
+      continue;
+      }
+    k = j;
+    if (j+1 < info->NumberOfEntries &&
+        strcmp(name, hierarchy_entry_name(info, j+1)) == 0)
+      {
+      k = hierarchy_search(info, name);
+      }
+
+    h = hierarchy_hash(HIERARCHY_HASH_INIT, name, strlen(name));
+    i = (h & m);
+    while (table[2*i+1] != 0)
+      {
+      i = ((i + 1) & m);
+      }
+    table[2*i] = h;
+    table[2*i+1] = (unsigned int)(k + 1);
+    }
+
+  *sizep = size;
+  return table;
+}
+
+/* Check whether "cp" is "scope::name", or just "name" if no scope */
+static int hierarchy_name_matches(
+  const char *cp, const char *scope, size_t m, const char *name, size_t n)
+{
+  if (scope)
+    {
+    if (strncmp(cp, scope, m) != 0 || cp[m] != ':' || cp[m+1] != ':')
+      {
+      return 0;
+      }
+    cp += m + 2;
+    }
+
+  return (strncmp(cp, name, n) == 0 && cp[n] == '\0');
+}
+
+/* Find the entry for "scope::name", or for "name" if scope is NULL,
+ * where "m" and "n" are the lengths of the scope and the name */
+static HierarchyEntry *hierarchy_find_entry(
+  const HierarchyInfo *info, const char *scope, size_t m,
+  const char *name, size_t n)
+{
+  const unsigned int *table = info->HashTable;
+  unsigned long i, j, mask;
+  unsigned int h = HIERARCHY_HASH_INIT;
+  unsigned int k;
+
+  if (scope)
+    {
+    h = hierarchy_hash(h, scope, m);
+    h = hierarchy_hash(h, "::", 2);
+    }
+  h = hierarchy_hash(h, name, n);
+
+  /* the probes are limited in case the table is from a bad file */
+  mask = info->HashTableSize - 1;
+  i = (h & mask);
+  for (j = 0; j < info->HashTableSize && table[2*i+1] != 0; j++)
+    {
+    k = table[2*i+1] - 1;
+    if (table[2*i] == h && k < (unsigned int)info->NumberOfEntries &&
+        hierarchy_name_matches(
+          hierarchy_entry_name(info, (int)k), scope, m, name, n))
+      {
+      if (info->File)
+        {
+        return hierarchy_file_unpack_entry(info, (int)k);
+        }
+      return &info->Entries[k];
+      }
+    i = ((i + 1) & mask);
+    }
+
+  return NULL;
+}
+
+/* Get the length of a name without the final template args */
+static size_t hierarchy_name_length(const char *classname)
+{
+  size_t i, n;
+
+  n = vtkParse_UnscopedNameLength(classname);
+  i = 0;
+  while (classname[i+n] == ':' && classname[i+n+1] == ':')
+    {
+    i += n + 2;
+    n = vtkParse_UnscopedNameLength(&classname[i]);
+    }
+  i += vtkParse_IdentifierLength(&classname[i]);
+
+  return i;
+}
+
+/* Find an entry with a hash table lookup */
+HierarchyEntry *vtkParseHierarchy_FindEntry(
+  const HierarchyInfo *info, const char *classname)
+{
+  /* use the portion of name before final template parameters */
+  return hierarchy_find_entry(
+    info, NULL, 0, classname, hierarchy_name_length(classname));
+}
+
+/* Find an entry by its exact name */
+HierarchyEntry *vtkParseHierarchy_FindEntryByName(
+  const HierarchyInfo *info, const char *name, size_t n)
+{
+  return hierarchy_find_entry(info, NULL, 0, name, n);
+}
+
+
+/* Create the cache for IsTypeOf.  This is done when the file is read,
+ * before the HierarchyInfo can be shared by other threads. */
+static void hierarchy_new_cache(HierarchyInfo *info)
+{
+  HierarchyCache *cache;
+
+  cache = (HierarchyCache *)malloc(sizeof(HierarchyCache));
+  cache->Ancestors = (int **)calloc(
+    info->NumberOfEntries + 1, sizeof(int *));
+  cache->Substitutions = NULL;
+  cache->SubstitutionTableSize = 0;
+  cache->NumberOfSubstitutions = 0;
+  cache->Mutex = vtkParseThreads_NewMutex();
+  info->Cache = cache;
+}
+
+/* read a binary hierarchy file, or return NULL if it is not valid */
+static HierarchyInfo *hierarchy_read_binary_file(FILE *fp)
+{
+  HierarchyInfo *info;
+  HierarchyFile *file;
+  HierarchyFileHeader header;
+  FileBuffer contents;
+  size_t size;
+
+  if (vtkParsePreprocess_LoadFile(&contents, fp, 0) != VTK_PARSE_OK)
+    {
+    return NULL;
+    }
+
+  /* check that every part of the file is within bounds */
+  size = contents.Size;
+  if (size < sizeof(HierarchyFileHeader))
+    {
+    vtkParsePreprocess_UnloadFile(&contents);
+    return NULL;
+    }
+  memcpy(&header, contents.Data, sizeof(HierarchyFileHeader));
+  if (memcmp(header.Magic, HIERARCHY_FILE_MAGIC, 8) != 0 ||
+      header.ByteOrder != HIERARCHY_FILE_BYTE_ORDER ||
+      header.FileSize != size ||
+      header.EntryOffset % sizeof(unsigned int) != 0 ||
+      header.EntryOffset > size ||
+      header.NumberOfEntries > (size - header.EntryOffset)/
+                               sizeof(HierarchyFileEntry) ||
+      header.NumberOfEntries > 0x7fffffffu ||
+      header.HashOffset % sizeof(unsigned int) != 0 ||
+      header.HashOffset > size ||
+      header.HashTableSize == 0 ||
+      (header.HashTableSize & (header.HashTableSize - 1)) != 0 ||
+      header.HashTableSize > (size - header.HashOffset)/
+                             (2*sizeof(unsigned int)) ||
+      header.ListOffset % sizeof(unsigned int) != 0 ||
+      header.ListOffset > size ||
+      header.ListSize > (size - header.ListOffset)/sizeof(unsigned int) ||
+      header.StringOffset > size ||
+      header.StringSize == 0 ||
+      header.StringSize > size - header.StringOffset ||
+      contents.Data[header.StringOffset + header.StringSize - 1] != '\0')
+    {
+    vtkParsePreprocess_UnloadFile(&contents);
+    return NULL;
+    }
+
+  file = (HierarchyFile *)malloc(sizeof(HierarchyFile));
+  file->Contents = contents;
+  file->Entries =
+    (const HierarchyFileEntry *)(contents.Data + header.EntryOffset);
+  file->Lists = (const unsigned int *)(contents.Data + header.ListOffset);
+  file->Strings = contents.Data + header.StringOffset;
+  file->ListSize = header.ListSize;
+  file->StringSize = header.StringSize;
+  file->Mutex = vtkParseThreads_NewMutex();
+
+  /* the entries are unpacked from the file as they are needed */
+  info = (HierarchyInfo *)malloc(sizeof(HierarchyInfo));
+  info->NumberOfEntries = (int)header.NumberOfEntries;
+  info->Entries = (HierarchyEntry *)calloc(
+    header.NumberOfEntries + 1, sizeof(HierarchyEntry));
+  info->Strings = (StringCache *)malloc(sizeof(StringCache));
+  vtkParse_InitInternedStringCache(info->Strings);
+  info->HashTable =
+    (const unsigned int *)(contents.Data + header.HashOffset);
+  info->HashTableSize = header.HashTableSize;
+  info->File = file;
+  info->Cache = NULL;
+  hierarchy_new_cache(info);
+
+  return info;
+}
+
+/* read a text hierarchy file, or return NULL */
+static HierarchyInfo *hierarchy_read_text_file(const char *filename)
 {
   HierarchyInfo *info;
   HierarchyEntry *entry;
@@ -169,8 +660,6 @@ HierarchyInfo *vtkParseHierarchy_ReadFile(const char *filename)
   unsigned int bits, pointers;
   static const char *delims = ">,=";
 
-  line = (char *)malloc(maxlen);
-
   fp = fopen(filename, "r");
 
   if (fp == NULL)
@@ -178,11 +667,17 @@ HierarchyInfo *vtkParseHierarchy_ReadFile(const char *filename)
     return NULL;
     }
 
+  line = (char *)malloc(maxlen);
+
   info = (HierarchyInfo *)malloc(sizeof(HierarchyInfo));
   info->NumberOfEntries = 0;
   info->Entries = (HierarchyEntry *)malloc(maxClasses*sizeof(HierarchyEntry));
   info->Strings = (StringCache *)malloc(sizeof(StringCache));
-  vtkParse_InitStringCache(info->Strings);
+  vtkParse_InitInternedStringCache(info->Strings);
+  info->HashTable = NULL;
+  info->HashTableSize = 0;
+  info->File = NULL;
+  info->Cache = NULL;
 
   while (fgets(line, (int)maxlen, fp))
     {
@@ -496,16 +991,9 @@ HierarchyInfo *vtkParseHierarchy_ReadFile(const char *filename)
         {
         i++;
         i += skip_space(&line[i]);
-        if (entry->NumberOfProperties == 0)
-          {
-          entry->Properties = (const char **)malloc(sizeof(char **));
-          }
-        else
-          {
-          entry->Properties = (const char **)realloc(
-            (char **)entry->Properties,
-            (entry->NumberOfProperties+1)*sizeof(char **));
-          }
+        entry->Properties = (const char **)realloc(
+          (char **)entry->Properties,
+          (entry->NumberOfProperties+1)*sizeof(char **));
         n = 0;
         while (line[i+n] != '\0' && line[i+n] != '\n' && line[i+n] != ';')
           { n++; }
@@ -526,16 +1014,328 @@ HierarchyInfo *vtkParseHierarchy_ReadFile(const char *filename)
     }
 
   free(line);
+  fclose(fp);
 
-  sort_hierarchy_entries(info);
+  if (info)
+    {
+    sort_hierarchy_entries(info);
+    info->HashTable =
+      hierarchy_build_hash_table(info, &info->HashTableSize);
+    hierarchy_new_cache(info);
+    }
 
   return info;
 }
 
+/* read a hierarchy file into a HeirarchyInfo struct, or return NULL */
+HierarchyInfo *vtkParseHierarchy_ReadFile(const char *filename)
+{
+  HierarchyInfo *info;
+  FILE *fp;
+  char magic[8];
+
+  fp = fopen(filename, "rb");
+
+  if (fp == NULL)
+    {
+    return NULL;
+    }
+
+  /* check for the binary file magic */
+  if (fread(magic, 1, 8, fp) == 8 &&
+      memcmp(magic, HIERARCHY_FILE_MAGIC, 8) == 0)
+    {
+    rewind(fp);
+    info = hierarchy_read_binary_file(fp);
+    fclose(fp);
+    return info;
+    }
+
+  fclose(fp);
+
+  return hierarchy_read_text_file(filename);
+}
+
+/* add a string to a binary file that is being written */
+static unsigned int hierarchy_write_string(
+  HierarchyFileWriter *writer, const char *text)
+{
+  unsigned int *table;
+  unsigned int offset;
+  unsigned int h;
+  size_t i, j, m, n;
+
+  if (text == NULL)
+    {
+    return 0;
+    }
+
+  n = strlen(text);
+  h = hierarchy_hash(HIERARCHY_HASH_INIT, text, n);
+
+  /* look for the string, it is only stored once */
+  m = writer->HashTableSize - 1;
+  for (i = (h & m); writer->HashTable[i] != 0; i = ((i + 1) & m))
+    {
+    if (strcmp(&writer->Strings[writer->HashTable[i]], text) == 0)
+      {
+      return writer->HashTable[i];
+      }
+    }
+
+  while (writer->StringSize + n + 1 > writer->MaxStringSize)
+    {
+    writer->MaxStringSize *= 2;
+    writer->Strings = (char *)realloc(
+      writer->Strings, writer->MaxStringSize);
+    }
+  offset = (unsigned int)writer->StringSize;
+  memcpy(&writer->Strings[offset], text, n + 1);
+  writer->StringSize += n + 1;
+  writer->HashTable[i] = offset;
+  writer->NumberOfStrings++;
+
+  /* grow the hash table when it is half full */
+  if (2*writer->NumberOfStrings > writer->HashTableSize)
+    {
+    table = writer->HashTable;
+    n = writer->HashTableSize;
+    writer->HashTableSize = 2*n;
+    writer->HashTable = (unsigned int *)calloc(
+      writer->HashTableSize, sizeof(unsigned int));
+    m = writer->HashTableSize - 1;
+    for (j = 0; j < n; j++)
+      {
+      if (table[j] != 0)
+        {
+        text = &writer->Strings[table[j]];
+        h = hierarchy_hash(HIERARCHY_HASH_INIT, text, strlen(text));
+        i = (h & m);
+        while (writer->HashTable[i] != 0)
+          {
+          i = ((i + 1) & m);
+          }
+        writer->HashTable[i] = table[j];
+        }
+      }
+    free(table);
+    }
+
+  return offset;
+}
+
+/* add a list of strings to a binary file that is being written */
+static unsigned int hierarchy_write_list(
+  HierarchyFileWriter *writer, int n, const char **strings)
+{
+  unsigned int start = (unsigned int)writer->ListSize;
+  unsigned int offset;
+  int i;
+
+  for (i = 0; i < n; i++)
+    {
+    offset = hierarchy_write_string(writer, strings[i]);
+    if (writer->ListSize == writer->MaxListSize)
+      {
+      writer->MaxListSize *= 2;
+      writer->Lists = (unsigned int *)realloc(
+        writer->Lists, writer->MaxListSize*sizeof(unsigned int));
+      }
+    writer->Lists[writer->ListSize++] = offset;
+    }
+
+  return start;
+}
+
+/* check whether a file already has the given contents */
+static int hierarchy_file_matches(
+  const char *filename, const char *data, size_t size)
+{
+  FileBuffer contents;
+  FILE *fp;
+  int matched = 0;
+
+  fp = fopen(filename, "rb");
+  if (fp)
+    {
+    if (vtkParsePreprocess_LoadFile(&contents, fp, 0) == VTK_PARSE_OK)
+      {
+      matched = (contents.Size == size &&
+                 memcmp(contents.Data, data, size) == 0);
+      vtkParsePreprocess_UnloadFile(&contents);
+      }
+    fclose(fp);
+    }
+
+  return matched;
+}
+
+/* write a binary hierarchy file, if it has changed */
+int vtkParseHierarchy_WriteBinaryFile(
+  const HierarchyInfo *info, const char *filename)
+{
+  HierarchyFileWriter writer;
+  HierarchyFileHeader header;
+  HierarchyFileEntry *records;
+  HierarchyFileEntry *record;
+  const HierarchyEntry *entry;
+  unsigned int *table;
+  unsigned long tablesize;
+  char *tmpname;
+  char *data;
+  size_t size;
+  FILE *fp;
+  int i, n;
+  int result = 1;
+
+  writer.MaxStringSize = 4096;
+  writer.Strings = (char *)malloc(writer.MaxStringSize);
+  writer.Strings[0] = '\0';
+  writer.StringSize = 1;
+  writer.HashTableSize = 1024;
+  writer.HashTable = (unsigned int *)calloc(
+    writer.HashTableSize, sizeof(unsigned int));
+  writer.NumberOfStrings = 0;
+  writer.MaxListSize = 1024;
+  writer.Lists = (unsigned int *)malloc(
+    writer.MaxListSize*sizeof(unsigned int));
+  writer.ListSize = 0;
+
+  /* the entries are written in the same order, which is sorted */
+  n = info->NumberOfEntries;
+  records = (HierarchyFileEntry *)calloc(n + 1, sizeof(HierarchyFileEntry));
+  for (i = 0; i < n; i++)
+    {
+    entry = &info->Entries[i];
+    if (info->File)
+      {
+      entry = hierarchy_file_unpack_entry(info, i);
+      }
+    record = &records[i];
+    record->Name = hierarchy_write_string(&writer, entry->Name);
+    record->HeaderFile = hierarchy_write_string(&writer, entry->HeaderFile);
+    record->Module = hierarchy_write_string(&writer, entry->Module);
+    record->Flags = ((entry->IsEnum ? HIERARCHY_FILE_ENUM : 0) |
+                     (entry->IsTypedef ? HIERARCHY_FILE_TYPEDEF : 0));
+    record->NumberOfTemplateParameters =
+      (unsigned int)entry->NumberOfTemplateParameters;
+    record->TemplateParameters = hierarchy_write_list(&writer,
+      entry->NumberOfTemplateParameters, entry->TemplateParameters);
+    hierarchy_write_list(&writer,
+      entry->NumberOfTemplateParameters, entry->TemplateDefaults);
+    record->NumberOfSuperClasses =
+      (unsigned int)entry->NumberOfSuperClasses;
+    record->SuperClasses = hierarchy_write_list(&writer,
+      entry->NumberOfSuperClasses, entry->SuperClasses);
+    record->NumberOfProperties = (unsigned int)entry->NumberOfProperties;
+    record->Properties = hierarchy_write_list(&writer,
+      entry->NumberOfProperties, entry->Properties);
+    if (entry->IsTypedef && entry->Typedef)
+      {
+      record->TypedefType = entry->Typedef->Type;
+      record->TypedefCount = (unsigned int)entry->Typedef->Count;
+      record->TypedefTypeName =
+        hierarchy_write_string(&writer, entry->Typedef->TypeName);
+      record->NumberOfDimensions =
+        (unsigned int)entry->Typedef->NumberOfDimensions;
+      record->Dimensions = hierarchy_write_list(&writer,
+        entry->Typedef->NumberOfDimensions, entry->Typedef->Dimensions);
+      }
+    }
+
+  table = hierarchy_build_hash_table(info, &tablesize);
+
+  /* lay out the file */
+  memset(&header, 0, sizeof(HierarchyFileHeader));
+  memcpy(header.Magic, HIERARCHY_FILE_MAGIC, 8);
+  header.ByteOrder = HIERARCHY_FILE_BYTE_ORDER;
+  header.NumberOfEntries = (unsigned int)n;
+  size = sizeof(HierarchyFileHeader);
+  header.EntryOffset = (unsigned int)size;
+  size += n*sizeof(HierarchyFileEntry);
+  header.HashOffset = (unsigned int)size;
+  header.HashTableSize = (unsigned int)tablesize;
+  size += 2*tablesize*sizeof(unsigned int);
+  header.ListOffset = (unsigned int)size;
+  header.ListSize = (unsigned int)writer.ListSize;
+  size += writer.ListSize*sizeof(unsigned int);
+  header.StringOffset = (unsigned int)size;
+  header.StringSize = (unsigned int)writer.StringSize;
+  size += writer.StringSize;
+  header.FileSize = (unsigned int)size;
+
+  data = NULL;
+  if (header.FileSize != size)
+    {
+    /* the offsets cannot be larger than 32 bits */
+    result = 0;
+    }
+  else
+    {
+    data = (char *)malloc(size);
+    memcpy(data, &header, sizeof(HierarchyFileHeader));
+    memcpy(&data[header.EntryOffset], records,
+           n*sizeof(HierarchyFileEntry));
+    memcpy(&data[header.HashOffset], table,
+           2*tablesize*sizeof(unsigned int));
+    memcpy(&data[header.ListOffset], writer.Lists,
+           writer.ListSize*sizeof(unsigned int));
+    memcpy(&data[header.StringOffset], writer.Strings, writer.StringSize);
+    }
+
+  /* write to a temporary file and then rename it, so that the file is
+   * never seen in an incomplete state by a process that maps it */
+  if (result && !hierarchy_file_matches(filename, data, size))
+    {
+    tmpname = (char *)malloc(strlen(filename) + 32);
+    sprintf(tmpname, "%s.%lu.tmp", filename, (unsigned long)getpid());
+
+    fp = fopen(tmpname, "wb");
+    if (fp == NULL)
+      {
+      result = 0;
+      }
+    else
+      {
+      if (fwrite(data, 1, size, fp) != size)
+        {
+        result = 0;
+        }
+      if (fclose(fp) != 0 || result == 0)
+        {
+        remove(tmpname);
+        result = 0;
+        }
+      else if (rename(tmpname, filename) != 0)
+        {
+        /* on Windows, rename() will not replace an existing file */
+        remove(filename);
+        if (rename(tmpname, filename) != 0)
+          {
+          remove(tmpname);
+          result = 0;
+          }
+        }
+      }
+
+    free(tmpname);
+    }
+
+  free(data);
+  free(table);
+  free(records);
+  free(writer.Strings);
+  free(writer.HashTable);
+  free(writer.Lists);
+
+  return result;
+}
+
 /* free a HierarchyInfo struct */
 void vtkParseHierarchy_Free(HierarchyInfo *info)
 {
   HierarchyEntry *entry;
+  size_t j;
   int i;
 
   for (i = 0; i < info->NumberOfEntries; i++)
@@ -551,30 +1351,244 @@ void vtkParseHierarchy_Free(HierarchyInfo *info)
       free((char **)entry->SuperClasses);
       free(entry->SuperClassIndex);
       }
-    if (entry->NumberOfProperties)
+    free((char **)entry->Properties);
+    if (entry->Typedef)
       {
-      free((char **)entry->Properties);
+      vtkParse_FreeValue(entry->Typedef);
       }
     }
 
+  if (info->Cache)
+    {
+    for (i = 0; i < info->NumberOfEntries; i++)
+      {
+      if (info->Cache->Ancestors[i] != hierarchy_ancestors_pending &&
+          info->Cache->Ancestors[i] != hierarchy_ancestors_unknown)
+        {
+        free(info->Cache->Ancestors[i]);
+        }
+      }
+    free(info->Cache->Ancestors);
+    for (j = 0; j < info->Cache->SubstitutionTableSize; j++)
+      {
+      free((char *)info->Cache->Substitutions[j].ClassName);
+      }
+    free(info->Cache->Substitutions);
+    vtkParseThreads_FreeMutex(info->Cache->Mutex);
+    free(info->Cache);
+    }
+
+  if (info->File)
+    {
+    vtkParsePreprocess_UnloadFile(&info->File->Contents);
+    vtkParseThreads_FreeMutex(info->File->Mutex);
+    free(info->File);
+    }
+  else
+    {
+    free((unsigned int *)info->HashTable);
+    }
+
   free(info->Entries);
   free(info);
 }
 
 
-/* Check whether class is derived from baseclass.  You must supply
- * the entry for the class (returned by FindEntry) as well as the
- * classname.  If the class is templated, the classname can include
- * template args in angle brackets.  If you provide a pointer for
- * baseclass_with_args, then it will be used to return the name of
- * name of the baseclass with template args in angle brackets. */
+/* Find the entry for a superclass, following typedefs, and return its
+ * index or -1 if not found */
+static int hierarchy_superclass_search(
+  const HierarchyInfo *info, const char *supername)
+{
+  HierarchyEntry *tmph;
 
-int vtkParseHierarchy_IsTypeOfTemplated(
+  tmph = vtkParseHierarchy_FindEntry(info, supername);
+  while (tmph && tmph->IsTypedef)
+    {
+    if (tmph->Typedef->TypeName)
+      {
+      tmph = vtkParseHierarchy_FindEntry(info, tmph->Typedef->TypeName);
+      continue;
+      }
+    break;
+    }
+
+  if (tmph)
+    {
+    return (int)(tmph - info->Entries);
+    }
+
+  /* entry not found, don't try again */
+  /* i = -2; messes things up for templates */
+  return -1;
+}
+
+/* Get the index of the first entry that has the same name */
+static int hierarchy_first_index(const HierarchyInfo *info, int i)
+{
+  const char *name = hierarchy_entry_name(info, i);
+
+  while (i > 0 && strcmp(hierarchy_entry_name(info, i-1), name) == 0)
+    {
+    i--;
+    }
+
+  return i;
+}
+
+/* Check whether the entry for a superclass depends on the template
+ * args, i.e. whether a template parameter is used in the part of the
+ * superclass name that FindEntry() uses */
+static int hierarchy_superclass_is_dependent(
+  const HierarchyEntry *entry, const char *supername)
+{
+  size_t n = hierarchy_name_length(supername);
+  size_t i = 0;
+  size_t l;
+  int k;
+
+  while (i < n)
+    {
+    l = vtkParse_IdentifierLength(&supername[i]);
+    if (l == 0)
+      {
+      i++;
+      continue;
+      }
+    for (k = 0; k < entry->NumberOfTemplateParameters; k++)
+      {
+      if (strncmp(entry->TemplateParameters[k], &supername[i], l) == 0 &&
+          entry->TemplateParameters[k][l] == '\0')
+        {
+        return 1;
+        }
+      }
+    i += l;
+    }
+
+  return 0;
+}
+
+/* helper: comparison of ints */
+static int compare_ints(const void *vp1, const void *vp2)
+{
+  int i1 = *((const int *)vp1);
+  int i2 = *((const int *)vp2);
+
+  return (i1 < i2 ? -1 : (i1 > i2 ? 1 : 0));
+}
+
+/* Get the ancestors of entry "i", the entry must already be unpacked
+ * and the cache must be locked */
+static const int *hierarchy_ancestors(
+  const HierarchyInfo *info, HierarchyCache *cache, int i)
+{
+  HierarchyEntry *entry = &info->Entries[i];
+  const int *list;
+  int *ancestors;
+  int j, k, l, n;
+
+  if (cache->Ancestors[i])
+    {
+    return cache->Ancestors[i];
+    }
+
+  /* mark the entry, in case the superclasses are cyclic */
+  cache->Ancestors[i] = hierarchy_ancestors_pending;
+
+  n = 1;
+  for (j = 0; j < entry->NumberOfSuperClasses; j++)
+    {
+    if (hierarchy_superclass_is_dependent(entry, entry->SuperClasses[j]))
+      {
+      cache->Ancestors[i] = hierarchy_ancestors_unknown;
+      return hierarchy_ancestors_unknown;
+      }
+    k = entry->SuperClassIndex[j];
+    if (k == -1)
+      {
+      k = hierarchy_superclass_search(info, entry->SuperClasses[j]);
+      entry->SuperClassIndex[j] = k;
+      }
+    if (k >= 0)
+      {
+      list = hierarchy_ancestors(info, cache, k);
+      if (list == hierarchy_ancestors_pending ||
+          list == hierarchy_ancestors_unknown)
+        {
+        cache->Ancestors[i] = hierarchy_ancestors_unknown;
+        return hierarchy_ancestors_unknown;
+        }
+      n += list[0];
+      }
+    }
+
+  /* collect the ancestors of all the superclasses */
+  ancestors = (int *)malloc((n + 1)*sizeof(int));
+  ancestors[1] = hierarchy_first_index(info, i);
+  n = 1;
+  for (j = 0; j < entry->NumberOfSuperClasses; j++)
+    {
+    k = entry->SuperClassIndex[j];
+    if (k >= 0)
+      {
+      list = cache->Ancestors[k];
+      for (l = 1; l <= list[0]; l++)
+        {
+        ancestors[++n] = list[l];
+        }
+      }
+    }
+
+  /* sort and remove duplicates */
+  qsort(&ancestors[1], n, sizeof(int), &compare_ints);
+  k = 1;
+  for (l = 2; l <= n; l++)
+    {
+    if (ancestors[l] != ancestors[k])
+      {
+      ancestors[++k] = ancestors[l];
+      }
+    }
+  ancestors[0] = k;
+
+  cache->Ancestors[i] = ancestors;
+  return ancestors;
+}
+
+/* Check whether the index "k" is in a list of ancestors */
+static int hierarchy_has_ancestor(const int *ancestors, int k)
+{
+  int l = 1;
+  int u = ancestors[0] + 1;
+  int i;
+
+  while (l < u)
+    {
+    i = (l + u)/2;
+    if (k < ancestors[i])
+      {
+      u = i;
+      }
+    else if (k > ancestors[i])
+      {
+      l = i + 1;
+      }
+    else
+      {
+      return 1;
+      }
+    }
+
+  return 0;
+}
+
+/* Check whether class is derived from baseclass by walking through the
+ * superclasses, this is used when the ancestors cannot be cached. */
+static int hierarchy_is_type_of_templated(
   const HierarchyInfo *info,
   const HierarchyEntry *entry, const char *classname,
   const char *baseclass, const char **baseclass_with_args)
 {
-  HierarchyEntry *tmph;
   const char *name;
   const char *supername;
   char *tmp;
@@ -636,7 +1650,8 @@ int vtkParseHierarchy_IsTypeOfTemplated(
       }
 
     /* check all baseclasses */
-    for (j = 0; j < entry->NumberOfSuperClasses && rval == 0; j++)
+    for (j = 0; j < entry->NumberOfSuperClasses && rval == 0 && !iterating;
+         j++)
       {
       supername = entry->SuperClasses[j];
 
@@ -664,31 +1679,12 @@ int vtkParseHierarchy_IsTypeOfTemplated(
         }
 
       /* check the cached index for the baseclass entry */
+      vtkParseThreads_Lock(info->Cache->Mutex);
       i = entry->SuperClassIndex[j];
       if (i == -1)
         {
         /* index was not set yet, so search for the entry */
-        tmph = vtkParseHierarchy_FindEntry(info, supername);
-        while (tmph && tmph->IsTypedef)
-          {
-          if (tmph->Typedef->TypeName)
-            {
-            tmph = vtkParseHierarchy_FindEntry(info, tmph->Typedef->TypeName);
-            continue;
-            }
-          break;
-          }
-
-        if (tmph)
-          {
-          i = (int)(tmph - info->Entries);
-          }
-        else
-          {
-          /* entry not found, don't try again */
-          /* i = -2; messes things up for templates */
-          /* fprintf(stderr, "not found \"%s\"\n", entry->SuperClasses[j]); */
-          }
+        i = hierarchy_superclass_search(info, supername);
 
         /* if baseclass is a template parameter, its entry cannot be cached */
         if (!baseclass_is_template_parameter)
@@ -697,6 +1693,7 @@ int vtkParseHierarchy_IsTypeOfTemplated(
           ((HierarchyEntry *)entry)->SuperClassIndex[j] = i;
           }
         }
+      vtkParseThreads_Unlock(info->Cache->Mutex);
 
       /* if entry was found, continue down the chain */
       if (i >= 0)
@@ -753,6 +1750,188 @@ int vtkParseHierarchy_IsTypeOfTemplated(
   return rval;
 }
 
+/* Find a substitution in the cache, the cache must be locked */
+static const HierarchySubstitution *hierarchy_find_substitution(
+  const HierarchyCache *cache, unsigned int h, int i,
+  const char *classname, const char *baseclass)
+{
+  const HierarchySubstitution *table = cache->Substitutions;
+  const HierarchySubstitution *item;
+  size_t j, mask;
+
+  mask = cache->SubstitutionTableSize - 1;
+  for (j = (h & mask); table && table[j].ClassName; j = ((j + 1) & mask))
+    {
+    item = &table[j];
+    if (item->Hash == h && item->Entry == i &&
+        strcmp(item->ClassName, classname) == 0 &&
+        strcmp(item->BaseClass, baseclass) == 0)
+      {
+      return item;
+      }
+    }
+
+  return NULL;
+}
+
+/* Get the baseclass name with template args for a class that is known
+ * to be derived from baseclass, the result must be freed by the caller */
+static const char *hierarchy_substitute_baseclass(
+  const HierarchyInfo *info, HierarchyCache *cache, int i,
+  const char *classname, const char *baseclass)
+{
+  HierarchySubstitution *table;
+  HierarchySubstitution *item;
+  const HierarchySubstitution *found;
+  const char *result = NULL;
+  char *cp;
+  size_t j, n, m, mask;
+  unsigned int h;
+
+  h = hierarchy_hash(HIERARCHY_HASH_INIT, classname, strlen(classname) + 1);
+  h = hierarchy_hash(h, baseclass, strlen(baseclass));
+  h ^= (unsigned int)i*2654435761u;
+
+  /* look for the result in the cache */
+  vtkParseThreads_Lock(cache->Mutex);
+  found = hierarchy_find_substitution(cache, h, i, classname, baseclass);
+  if (found)
+    {
+    cp = (char *)malloc(strlen(found->Result) + 1);
+    strcpy(cp, found->Result);
+    result = cp;
+    }
+  vtkParseThreads_Unlock(cache->Mutex);
+
+  if (result)
+    {
+    return result;
+    }
+
+  /* the lock is not held here, because this can recurse into IsTypeOf */
+  hierarchy_is_type_of_templated(
+    info, &info->Entries[i], classname, baseclass, &result);
+  if (result == NULL)
+    {
+    return NULL;
+    }
+
+  /* another thread might have added the same result in the meantime */
+  vtkParseThreads_Lock(cache->Mutex);
+  if (hierarchy_find_substitution(cache, h, i, classname, baseclass))
+    {
+    vtkParseThreads_Unlock(cache->Mutex);
+    return result;
+    }
+
+  /* grow the table when it becomes half full */
+  table = cache->Substitutions;
+  mask = cache->SubstitutionTableSize - 1;
+  if (2*(cache->NumberOfSubstitutions + 1) > cache->SubstitutionTableSize)
+    {
+    n = cache->SubstitutionTableSize;
+    m = (n == 0 ? 64 : 2*n);
+    table = (HierarchySubstitution *)calloc(m, sizeof(HierarchySubstitution));
+    mask = m - 1;
+    for (j = 0; j < n; j++)
+      {
+      item = &cache->Substitutions[j];
+      if (item->ClassName)
+        {
+        size_t k = (item->Hash & mask);
+        while (table[k].ClassName)
+          {
+          k = ((k + 1) & mask);
+          }
+        table[k] = *item;
+        }
+      }
+    free(cache->Substitutions);
+    cache->Substitutions = table;
+    cache->SubstitutionTableSize = m;
+    }
+
+  /* add the result to the cache */
+  j = (h & mask);
+  while (table[j].ClassName)
+    {
+    j = ((j + 1) & mask);
+    }
+  n = strlen(classname) + 1;
+  m = strlen(baseclass) + 1;
+  cp = (char *)malloc(n + m + strlen(result) + 1);
+  strcpy(cp, classname);
+  strcpy(&cp[n], baseclass);
+  strcpy(&cp[n + m], result);
+  table[j].Hash = h;
+  table[j].Entry = i;
+  table[j].ClassName = cp;
+  table[j].BaseClass = &cp[n];
+  table[j].Result = &cp[n + m];
+  cache->NumberOfSubstitutions++;
+  vtkParseThreads_Unlock(cache->Mutex);
+
+  return result;
+}
+
+/* Check whether class is derived from baseclass.  You must supply
+ * the entry for the class (returned by FindEntry) as well as the
+ * classname.  If the class is templated, the classname can include
+ * template args in angle brackets.  If you provide a pointer for
+ * baseclass_with_args, then it will be used to return the name of
+ * name of the baseclass with template args in angle brackets. */
+
+int vtkParseHierarchy_IsTypeOfTemplated(
+  const HierarchyInfo *info,
+  const HierarchyEntry *entry, const char *classname,
+  const char *baseclass, const char **baseclass_with_args)
+{
+  HierarchyCache *cache;
+  HierarchyEntry *base;
+  const int *ancestors;
+  int rval = 0;
+  int i;
+
+  /* the ancestors can only be cached for entries from "info" */
+  if (entry < info->Entries || entry >= info->Entries + info->NumberOfEntries)
+    {
+    return hierarchy_is_type_of_templated(
+      info, entry, classname, baseclass, baseclass_with_args);
+    }
+
+  /* a list of ancestors never changes after it has been built */
+  i = (int)(entry - info->Entries);
+  cache = info->Cache;
+  vtkParseThreads_Lock(cache->Mutex);
+  ancestors = hierarchy_ancestors(info, cache, i);
+  vtkParseThreads_Unlock(cache->Mutex);
+  if (ancestors == hierarchy_ancestors_pending ||
+      ancestors == hierarchy_ancestors_unknown)
+    {
+    return hierarchy_is_type_of_templated(
+      info, entry, classname, baseclass, baseclass_with_args);
+    }
+
+  base = vtkParseHierarchy_FindEntryByName(info, baseclass, strlen(baseclass));
+  if (base)
+    {
+    rval = hierarchy_has_ancestor(
+      ancestors, hierarchy_first_index(info, (int)(base - info->Entries)));
+    }
+
+  if (baseclass_with_args)
+    {
+    *baseclass_with_args = NULL;
+    if (rval)
+      {
+      *baseclass_with_args = hierarchy_substitute_baseclass(
+        info, cache, i, classname, baseclass);
+      }
+    }
+
+  return rval;
+}
+
 int vtkParseHierarchy_IsTypeOf(
   const HierarchyInfo *info, const HierarchyEntry *entry,
   const char *baseclass)
@@ -845,10 +2024,7 @@ int vtkParseHierarchy_ExpandTypedefsInValue(
   const HierarchyInfo *info, ValueInfo *val, StringCache *cache,
   const char *scope)
 {
-  char text[128];
-  char *cp;
   const char *newclass;
-  size_t n, m;
   int i;
   HierarchyEntry *entry;
   int scope_needs_free = 0;
@@ -863,25 +2039,9 @@ int vtkParseHierarchy_ExpandTypedefsInValue(
     /* search for the type in the provided scope */
     while (entry == 0 && scope != 0)
       {
-      cp = text;
-      n = strlen(scope);
-      m = strlen(val->TypeName);
-      /* only malloc if more than 128 chars needed */
-      if (n + m + 2 >= 128)
-        {
-        cp = (char *)malloc(n+m+3);
-        }
-
-      /* scope the name */
-      strncpy(cp, scope, n);
-      cp[n++] = ':';
-      cp[n++] = ':';
-      strncpy(&cp[n], val->TypeName, m);
-      cp[n+m] = '\0';
-
-      entry = vtkParseHierarchy_FindEntry(info, cp);
-
-      if (cp != text) { free(cp); }
+      /* the scoped name is hashed in pieces, to avoid a copy */
+      entry = hierarchy_find_entry(info, scope, strlen(scope),
+        val->TypeName, hierarchy_name_length(val->TypeName));
 
       /* if not found, try inherited scopes */
       if (entry == 0)
@@ -954,9 +2114,8 @@ int vtkParseHierarchy_ExpandTypedefsInValue(
 const char *vtkParseHierarchy_ExpandTypedefsInName(
   const HierarchyInfo *info, const char *name, const char *scope)
 {
-  char text[128];
   char *cp;
-  size_t n, m;
+  size_t m;
   const char *newname = name;
   HierarchyEntry *entry = NULL;
 
@@ -972,25 +2131,7 @@ const char *vtkParseHierarchy_ExpandTypedefsInName(
 
   if (scope)
     {
-    cp = text;
-    n = strlen(scope);
-    m = strlen(name);
-    /* only malloc if more than 128 chars needed */
-    if (n + m + 2 >= 128)
-      {
-      cp = (char *)malloc(n+m+3);
-      }
-
-    /* scope the name */
-    strncpy(cp, scope, n);
-    cp[n++] = ':';
-    cp[n++] = ':';
-    strncpy(&cp[n], name, m);
-    cp[n+m] = '\0';
-
-    entry = vtkParseHierarchy_FindEntry(info, cp);
-
-    if (cp != text) { free(cp); }
+    entry = hierarchy_find_entry(info, scope, strlen(scope), name, m);
     }
 
   if (!entry)
@@ -34,6 +34,12 @@
 
  enumname : enum ; header.h ; vtkKit [; flags]
 
+ The same information can also be written to a binary file that
+ starts with "VTKHIER2".  The binary file holds the entries sorted
+ by name, the hash table for finding entries, a table of all the
+ strings, and the decoded typedef types, so it can be memory-mapped
+ instead of being parsed.  The entries
+ from a binary file are unpacked when they are first looked up.
 */
 
 #ifndef VTK_PARSE_HIERARCHY_H
@@ -64,6 +70,16 @@ typedef struct _HierarchyEntry
   int         IsTypedef;        /* this entry is for a typedef */
 } HierarchyEntry;
 
+/**
+ * The contents of a binary hierarchy file, which is opaque.
+ */
+typedef struct _HierarchyFile HierarchyFile;
+
+/**
+ * The results that are cached by IsTypeOf(), which are opaque.
+ */
+typedef struct _HierarchyCache HierarchyCache;
+
 /**
  * All the entries from a hierarchy file.
  */
@@ -72,6 +88,10 @@ typedef struct _HierarchyInfo
   int             NumberOfEntries;
   HierarchyEntry *Entries;
   StringCache    *Strings;
+  const unsigned int *HashTable;  /* for internal use only */
+  unsigned long   HashTableSize;
+  HierarchyFile  *File;         /* for binary files */
+  HierarchyCache *Cache;        /* for internal use only */
 } HierarchyInfo;
 
 #ifdef __cplusplus
@@ -79,21 +99,39 @@ extern "C" {
 #endif
 
 /**
- * Read a hierarchy file into a HeirarchyInfo struct, or return NULL
+ * Read a hierarchy file into a HeirarchyInfo struct, or return NULL.
+ * The file can be either a text file or a binary file.
  */
 HierarchyInfo *vtkParseHierarchy_ReadFile(const char *filename);
 
+/**
+ * Write a binary hierarchy file, but only if the file does not exist
+ * or if its contents would change.  Returns zero on failure.
+ */
+int vtkParseHierarchy_WriteBinaryFile(
+  const HierarchyInfo *info, const char *filename);
+
 /**
  * Free a HierarchyInfo struct
  */
 void vtkParseHierarchy_Free(HierarchyInfo *info);
 
 /**
- * Return the entry for a class or type, or null if not found
+ * Return the entry for a class or type, or null if not found.
+ * Any template args at the end of the classname are ignored.
+ * Several threads can find entries in the same HierarchyInfo.
  */
 HierarchyEntry *vtkParseHierarchy_FindEntry(
   const HierarchyInfo *info, const char *classname);
 
+/**
+ * Return the entry with the given name, or null if not found.  The
+ * name is given by a pointer and a length, so it does not have to be
+ * null-terminated.  Unlike FindEntry(), no template args are removed.
+ */
+HierarchyEntry *vtkParseHierarchy_FindEntryByName(
+  const HierarchyInfo *info, const char *name, size_t n);
+
 /**
  * Get properties for the class.  Returns NULL if the property
  * is not set, and returns either an empty string or a value string
@@ -104,7 +142,11 @@ const char *vtkParseHierarchy_GetProperty(
   const HierarchyEntry *entry, const char *property);
 
 /**
- * Check whether class is derived from baseclass.
+ * Check whether class is derived from baseclass.  The ancestors of
+ * each class are computed the first time that the class is checked,
+ * so later checks do not have to walk the superclasses.  The cache
+ * is locked while it is updated, so a HierarchyInfo can be shared by
+ * several threads.
  */
 int vtkParseHierarchy_IsTypeOf(const HierarchyInfo *info,
   const HierarchyEntry *entry, const char *baseclass);
@@ -34,6 +34,13 @@ This file provides a unified front-end for the wrapper generators.
 /* This is the struct that contains the options */
 OptionInfo options;
 
+/* The per-header options, for batch mode */
+static int batch_count = 0;
+static OptionInfo *batch_entries = NULL;
+
+/* The hints, which are read just once and shared by all threads */
+static HintTable *hint_table = NULL;
+
 /* Get the base filename */
 static const char *parse_exename(const char *cmd)
 {
@@ -63,6 +70,8 @@ static void parse_print_help(FILE *fp, const char *cmd, int multi)
     "  -I <dir>          add an include directory\n"
     "  -D <macro[=def]>  define a preprocessor macro\n"
     "  -U <macro>        undefine a preprocessor macro\n"
+    "  -j <n>            the number of threads to use\n"
+    "  --macros <file>   the file for caching macro definitions\n"
     "  @<file>           read arguments from a file\n",
     parse_exename(cmd));
 
@@ -73,7 +82,20 @@ static void parse_print_help(FILE *fp, const char *cmd, int multi)
     "  --hints <file>    the hints file to use\n"
     "  --types <file>    the type hierarchy file to use\n"
     "  --vtkobject       vtkObjectBase-derived class\n"
-    "  --special         non-vtkObjectBase class\n");
+    "  --special         non-vtkObjectBase class\n"
+    "  --batch <file>    wrap the headers listed in the file\n"
+    "  --manifest <file> write the hashes of the output files\n"
+    "  --kit <file>      write the XML for all headers to one file\n"
+    "  --index <file>    write the offset of each class in the kit\n"
+    "  --fileinfo        write binary data instead of XML\n"
+    "  --dump            print the records of --fileinfo files\n");
+    }
+
+  /* args for the tools that take many header files */
+  if (multi)
+    {
+    fprintf(fp,
+    "  --binary <file>   also write a binary hierarchy file\n");
     }
 }
 
@@ -90,128 +112,162 @@ static void parse_append_arg(int *argn, char ***args, char *arg)
   (*argn)++;
 }
 
-/* read options from a file, return zero on error */
+/* the stack of option files, for detecting recursion */
+static int option_file_stack_max = 10;
+static int option_file_stack_size = 0;
+static const char *option_file_stack[10];
+
 static int read_option_file(
-  StringCache *strings, const char *filename, int *argn, char ***args)
+  StringCache *strings, const char *filename, int *argn, char ***args);
+
+/* break a line into args, "filename" is the file that the line is from */
+static void parse_line_args(
+  StringCache *strings, const char *filename, const char *line, size_t n,
+  int *argn, char ***args)
 {
-  static int option_file_stack_max = 10;
-  static int option_file_stack_size = 0;
-  static const char *option_file_stack[10];
-  FILE *fp;
-  char *line;
   const char *ccp;
   char *argstring;
   char *arg;
-  size_t maxlen = 15;
-  size_t i, n;
+  size_t i;
   int j;
   int in_string;
 
-  line = (char *)malloc(maxlen);
-
-  fp = fopen(filename, "r");
+  /* allocate a string to hold the parsed arguments */
+  argstring = vtkParse_NewString(strings, n);
+  arg = argstring;
+  i = 0;
 
-  if (fp == NULL)
+  /* break the line into individual options */
+  ccp = line;
+  in_string = 0;
+  while (*ccp != '\0')
     {
-    return 0;
-    }
-
-  /* read the file line by line */
-  while (fgets(line, (int)maxlen, fp))
-    {
-    n = strlen(line);
-
-    /* if buffer not long enough, increase it */
-    while (n == maxlen-1 && line[n-1] != '\n' && !feof(fp))
-      {
-      maxlen *= 2;
-      line = (char *)realloc(line, maxlen);
-      if (!fgets(&line[n], (int)(maxlen-n), fp)) { break; }
-      n += strlen(&line[n]);
-      }
-
-    /* allocate a string to hold the parsed arguments */
-    argstring = vtkParse_NewString(strings, n);
-    arg = argstring;
-    i = 0;
-
-    /* break the line into individual options */
-    ccp = line;
-    in_string = 0;
-    while (*ccp != '\0')
+    for (;;)
       {
-      for (;;)
+      if (*ccp == '\\')
         {
-        if (*ccp == '\\')
-          {
-          ccp++;
-          }
-        else if (*ccp == '\"' || *ccp == '\'')
+        ccp++;
+        }
+      else if (*ccp == '\"' || *ccp == '\'')
+        {
+        if (!in_string)
           {
-          if (!in_string)
-            {
-            in_string = *ccp++;
-            continue;
-            }
-          else if (*ccp == in_string)
-            {
-            in_string = 0;
-            ccp++;
-            continue;
-            }
+          in_string = *ccp++;
+          continue;
           }
-        else if (!in_string && isspace(*ccp))
+        else if (*ccp == in_string)
           {
-          do { ccp++; } while (isspace(*ccp));
-          break;
-          }
-        if (*ccp == '\0')
-          {
-          break;
+          in_string = 0;
+          ccp++;
+          continue;
           }
-        /* append character to argument */
-        arg[i++] = *ccp++;
         }
-      arg[i++] = '\0';
+      else if (!in_string && isspace(*ccp))
+        {
+        do { ccp++; } while (isspace(*ccp));
+        break;
+        }
+      if (*ccp == '\0')
+        {
+        break;
+        }
+      /* append character to argument */
+      arg[i++] = *ccp++;
+      }
+    arg[i++] = '\0';
 
-      if (arg[0] == '@')
+    if (arg[0] == '@')
+      {
+      /* recursively expand '@file' option */
+      if (option_file_stack_size == option_file_stack_max)
         {
-        /* recursively expand '@file' option */
-        if (option_file_stack_size == option_file_stack_max)
-          {
-          fprintf(stderr, "%s: @file recursion is too deep.\n",
-                  (*args)[0]);
-          exit(1);
-          }
-        /* avoid reading the same file recursively */
-        option_file_stack[option_file_stack_size++] = filename;
-        for (j = 0; j < option_file_stack_size; j++)
-          {
-          if (strcmp(&arg[1], option_file_stack[j]) == 0)
-            {
-            break;
-            }
-          }
-        if (j < option_file_stack_size)
-          {
-          parse_append_arg(argn, args, arg);
-          }
-        else if (read_option_file(strings, &arg[1], argn, args) == 0)
+        fprintf(stderr, "%s: @file recursion is too deep.\n",
+                (*args)[0]);
+        exit(1);
+        }
+      /* avoid reading the same file recursively */
+      option_file_stack[option_file_stack_size++] = filename;
+      for (j = 0; j < option_file_stack_size; j++)
+        {
+        if (strcmp(&arg[1], option_file_stack[j]) == 0)
           {
-          parse_append_arg(argn, args, arg);
+          break;
           }
-        option_file_stack_size--;
         }
-      else if (arg[0] != '\0')
+      if (j < option_file_stack_size)
+        {
+        parse_append_arg(argn, args, arg);
+        }
+      else if (read_option_file(strings, &arg[1], argn, args) == 0)
         {
         parse_append_arg(argn, args, arg);
         }
-      /* prepare for next arg */
-      arg += i;
-      i = 0;
+      option_file_stack_size--;
       }
+    else if (arg[0] != '\0')
+      {
+      parse_append_arg(argn, args, arg);
+      }
+    /* prepare for next arg */
+    arg += i;
+    i = 0;
+    }
+}
+
+/* read one line from a file, return zero at end of file */
+static int read_file_line(FILE *fp, char **linep, size_t *maxlenp)
+{
+  char *line = *linep;
+  size_t maxlen = *maxlenp;
+  size_t n;
+
+  if (!fgets(line, (int)maxlen, fp))
+    {
+    return 0;
+    }
+
+  n = strlen(line);
+
+  /* if buffer not long enough, increase it */
+  while (n == maxlen-1 && line[n-1] != '\n' && !feof(fp))
+    {
+    maxlen *= 2;
+    line = (char *)realloc(line, maxlen);
+    if (!fgets(&line[n], (int)(maxlen-n), fp)) { break; }
+    n += strlen(&line[n]);
+    }
+
+  *linep = line;
+  *maxlenp = maxlen;
+  return 1;
+}
+
+/* read options from a file, return zero on error */
+static int read_option_file(
+  StringCache *strings, const char *filename, int *argn, char ***args)
+{
+  FILE *fp;
+  char *line;
+  size_t maxlen = 15;
+
+  fp = fopen(filename, "r");
+
+  if (fp == NULL)
+    {
+    return 0;
+    }
+
+  line = (char *)malloc(maxlen);
+
+  /* read the file line by line */
+  while (read_file_line(fp, &line, &maxlen))
+    {
+    parse_line_args(strings, filename, line, strlen(line), argn, args);
     }
 
+  free(line);
+  fclose(fp);
+
   return 1;
 }
 
@@ -265,7 +321,15 @@ static int parse_check_options(int argc, char *argv[], int multi)
   options.IsVTKObject = 0;
   options.IsSpecialObject = 0;
   options.HierarchyFileName = 0;
+  options.BinaryFileName = 0;
+  options.ManifestFileName = 0;
+  options.KitFileName = 0;
+  options.IndexFileName = 0;
+  options.IsFileInfo = 0;
+  options.IsDump = 0;
   options.HintFileName = 0;
+  options.BatchFileName = 0;
+  options.NumberOfThreads = 1;
 
   for (i = 1; i < argc; i++)
     {
@@ -326,6 +390,19 @@ static int parse_check_options(int argc, char *argv[], int multi)
         {
         vtkParse_UndefineMacro(cp);
         }
+      else if (c == 'j')
+        {
+        options.NumberOfThreads = atoi(cp);
+        }
+      }
+    else if (strcmp(argv[i], "--macros") == 0)
+      {
+      i++;
+      if (i >= argc || argv[i][0] == '-')
+        {
+        return -1;
+        }
+      vtkParse_SetMacroCacheFile(argv[i]);
       }
     else if (!multi && strcmp(argv[i], "--hints") == 0)
       {
@@ -345,6 +422,59 @@ static int parse_check_options(int argc, char *argv[], int multi)
         }
       options.HierarchyFileName = argv[i];
       }
+    else if (multi && strcmp(argv[i], "--binary") == 0)
+      {
+      i++;
+      if (i >= argc || argv[i][0] == '-')
+        {
+        return -1;
+        }
+      options.BinaryFileName = argv[i];
+      }
+    else if (!multi && strcmp(argv[i], "--batch") == 0)
+      {
+      i++;
+      if (i >= argc || argv[i][0] == '-')
+        {
+        return -1;
+        }
+      options.BatchFileName = argv[i];
+      }
+    else if (!multi && strcmp(argv[i], "--manifest") == 0)
+      {
+      i++;
+      if (i >= argc || argv[i][0] == '-')
+        {
+        return -1;
+        }
+      options.ManifestFileName = argv[i];
+      }
+    else if (!multi && strcmp(argv[i], "--kit") == 0)
+      {
+      i++;
+      if (i >= argc || argv[i][0] == '-')
+        {
+        return -1;
+        }
+      options.KitFileName = argv[i];
+      }
+    else if (!multi && strcmp(argv[i], "--index") == 0)
+      {
+      i++;
+      if (i >= argc || argv[i][0] == '-')
+        {
+        return -1;
+        }
+      options.IndexFileName = argv[i];
+      }
+    else if (!multi && strcmp(argv[i], "--fileinfo") == 0)
+      {
+      options.IsFileInfo = 1;
+      }
+    else if (!multi && strcmp(argv[i], "--dump") == 0)
+      {
+      options.IsDump = 1;
+      }
     else if (!multi && strcmp(argv[i], "--vtkobject") == 0)
       {
       options.IsVTKObject = 1;
@@ -364,15 +494,136 @@ OptionInfo *vtkParse_GetCommandLineOptions()
   return &options;
 }
 
-/* Command-line argument handler for wrapper tools */
-FileInfo *vtkParse_Main(int argc, char *argv[])
+/* Read the batch file, which gives the options for one header per line.
+ * The shared options are copied from the static OptionInfo struct.
+ * Returns zero if the file could not be read, or -1 if a line was
+ * not valid, or the number of headers otherwise. */
+static int read_batch_file(StringCache *strings, const char *filename)
+{
+  FILE *fp;
+  char *line;
+  size_t maxlen = 15;
+  OptionInfo *entry;
+  int argn;
+  char **args;
+  int i;
+  int lineno = 0;
+
+  fp = fopen(filename, "r");
+
+  if (fp == NULL)
+    {
+    return 0;
+    }
+
+  line = (char *)malloc(maxlen);
+
+  while (read_file_line(fp, &line, &maxlen))
+    {
+    lineno++;
+
+    argn = 0;
+    args = (char **)malloc(sizeof(char *));
+    parse_line_args(strings, filename, line, strlen(line), &argn, &args);
+
+    /* skip blank lines */
+    if (argn == 0)
+      {
+      free(args);
+      continue;
+      }
+
+    /* if count is a power of two, allocate more space */
+    if (batch_count == 0)
+      {
+      batch_entries = (OptionInfo *)malloc(sizeof(OptionInfo));
+      }
+    else if ((batch_count & (batch_count - 1)) == 0)
+      {
+      batch_entries = (OptionInfo *)realloc(
+        batch_entries, 2*batch_count*sizeof(OptionInfo));
+      }
+
+    /* start with the shared options */
+    entry = &batch_entries[batch_count++];
+    *entry = options;
+    entry->NumberOfFiles = 0;
+    entry->Files = NULL;
+    entry->InputFileName = NULL;
+    entry->OutputFileName = NULL;
+
+    /* only the per-header options are allowed */
+    for (i = 0; i < argn; i++)
+      {
+      if (strcmp(args[i], "--concrete") == 0)
+        {
+        entry->IsConcrete = 1;
+        }
+      else if (strcmp(args[i], "--abstract") == 0)
+        {
+        entry->IsAbstract = 1;
+        }
+      else if (strcmp(args[i], "--vtkobject") == 0)
+        {
+        entry->IsVTKObject = 1;
+        }
+      else if (strcmp(args[i], "--special") == 0)
+        {
+        entry->IsSpecialObject = 1;
+        }
+      else if (strcmp(args[i], "-o") == 0 && i+1 < argn &&
+               args[i+1][0] != '-')
+        {
+        entry->OutputFileName = args[++i];
+        }
+      else if (args[i][0] != '-' && entry->InputFileName == NULL)
+        {
+        entry->NumberOfFiles = 1;
+        entry->Files = &entry->InputFileName;
+        entry->InputFileName = args[i];
+        }
+      else
+        {
+        entry = NULL;
+        break;
+        }
+      }
+
+    free(args);
+
+    /* with "--kit", the output can go to the kit file only */
+    if (entry == NULL ||
+        entry->InputFileName == NULL ||
+        (entry->OutputFileName == NULL && options.KitFileName == NULL))
+      {
+      fprintf(stderr, "%s:%d: each line must give \"-o <file>\" and "
+              "an input file.\n", filename, lineno);
+      free(line);
+      fclose(fp);
+      return -1;
+      }
+    }
+
+  free(line);
+  fclose(fp);
+
+  /* the Files pointers must be set after the final realloc */
+  for (i = 0; i < batch_count; i++)
+    {
+    batch_entries[i].Files = &batch_entries[i].InputFileName;
+    }
+
+  return batch_count;
+}
+
+/* Check the args for a wrapper tool that takes one header, or a batch
+ * file if "batch" is set, and return the number of headers.  It will
+ * exit if an error occurs. */
+static int parse_main_options(int argc, char *argv[], int batch)
 {
   int argi;
   int expected_files;
-  FILE *ifile;
-  FILE *hfile = 0;
-  FileInfo *data;
-  StringCache strings;
+  StringCache *strings;
   int argn;
   char **args;
 
@@ -382,9 +633,10 @@ FileInfo *vtkParse_Main(int argc, char *argv[])
   /* pre-define the __VTK_WRAP__ macro */
   vtkParse_DefineMacro("__VTK_WRAP__", 0);
 
-  /* expand any "@file" args */
-  vtkParse_InitStringCache(&strings);
-  parse_expand_args(&strings, argc, argv, &argn, &args);
+  /* expand any "@file" args, the strings must persist */
+  strings = (StringCache *)malloc(sizeof(StringCache));
+  vtkParse_InitStringCache(strings);
+  parse_expand_args(strings, argc, argv, &argn, &args);
 
   /* read the args into the static OptionInfo struct */
   argi = parse_check_options(argn, args, 0);
@@ -392,27 +644,49 @@ FileInfo *vtkParse_Main(int argc, char *argv[])
   /* was output file already specified by the "-o" option? */
   expected_files = (options.OutputFileName == NULL ? 2 : 1);
 
+  /* in batch mode, the headers are listed in the batch file */
+  if (options.BatchFileName)
+    {
+    expected_files = 0;
+    }
+
+  /* if a hierarchy is was given, then BTX/ETX can be ignored */
+  vtkParse_SetIgnoreBTX(0);
+  if (options.HierarchyFileName)
+    {
+    vtkParse_SetIgnoreBTX(1);
+    }
+
   /* verify number of args, print usage if not valid */
   if (argi == 0)
     {
     free(args);
     exit(0);
     }
-  else if (argi < 0 || options.NumberOfFiles != expected_files)
+  else if (argi < 0 || (options.BatchFileName && !batch) ||
+           options.NumberOfFiles != expected_files)
     {
     parse_print_help(stderr, args[0], 0);
     exit(1);
     }
 
-  /* open the input file */
-  options.InputFileName = options.Files[0];
-
-  if (!(ifile = fopen(options.InputFileName, "r")))
+  if (options.BatchFileName)
     {
-    fprintf(stderr, "Error opening input file %s\n", options.InputFileName);
-    exit(1);
+    switch (read_batch_file(strings, options.BatchFileName))
+      {
+      case 0:
+        fprintf(stderr, "Error opening batch file %s\n",
+                options.BatchFileName);
+        exit(1);
+      case -1:
+        exit(1);
+      }
+    free(args);
+    return batch_count;
     }
 
+  options.InputFileName = options.Files[0];
+
   if (options.OutputFileName == NULL &&
       options.NumberOfFiles > 1)
     {
@@ -424,38 +698,39 @@ FileInfo *vtkParse_Main(int argc, char *argv[])
   /* free the expanded args */
   free(args);
 
-  /* open the hint file, if given on the command line */
-  if (options.HintFileName && options.HintFileName[0] != '\0')
-    {
-    if (!(hfile = fopen(options.HintFileName, "r")))
-      {
-      fprintf(stderr, "Error opening hint file %s\n", options.HintFileName);
-      fclose(ifile);
-      exit(1);
-      }
-    }
-
   /* make sure than an output file was given on the command line */
   if (options.OutputFileName == NULL)
     {
     fprintf(stderr, "No output file was specified\n");
-    fclose(ifile);
-    if (hfile)
-      {
-      fclose(hfile);
-      }
     exit(1);
     }
 
-  /* if a hierarchy is was given, then BTX/ETX can be ignored */
-  vtkParse_SetIgnoreBTX(0);
-  if (options.HierarchyFileName)
+  /* the command-line options describe the only header */
+  batch_count = 1;
+  batch_entries = &options;
+
+  return batch_count;
+}
+
+/* Parse a header with the given options, exit on error */
+static FileInfo *parse_header_file(
+  vtkParseContext *context, OptionInfo *opts, const HintTable *hints)
+{
+  FILE *ifile;
+  FileInfo *data;
+
+  /* open the input file */
+  if (!(ifile = fopen(opts->InputFileName, "r")))
     {
-    vtkParse_SetIgnoreBTX(1);
+    fprintf(stderr, "Error opening input file %s\n", opts->InputFileName);
+    exit(1);
     }
 
   /* parse the input file */
-  data = vtkParse_ParseFile(options.InputFileName, ifile, stderr);
+  data = vtkParse_ParseFileWithContext(
+    context, opts->InputFileName, ifile, stderr);
+
+  fclose(ifile);
 
   if (!data)
     {
@@ -463,12 +738,12 @@ FileInfo *vtkParse_Main(int argc, char *argv[])
     }
 
   /* fill in some blanks by using the hints file */
-  if (hfile)
+  if (hints)
     {
-    vtkParse_ReadHints(data, hfile, stderr);
+    vtkParse_ApplyHintTable(data, hints, stderr);
     }
 
-  if (!options.IsSpecialObject && data->MainClass)
+  if (!opts->IsSpecialObject && data->MainClass)
     {
     /* mark class as abstract unless it has New() method */
     int nfunc = data->MainClass->NumberOfFunctions;
@@ -489,6 +764,95 @@ FileInfo *vtkParse_Main(int argc, char *argv[])
   return data;
 }
 
+/* Read the hint file, if given on the command line */
+static void read_hint_file()
+{
+  FILE *hfile;
+
+  if (options.HintFileName && options.HintFileName[0] != '\0')
+    {
+    if (!(hfile = fopen(options.HintFileName, "r")))
+      {
+      fprintf(stderr, "Error opening hint file %s\n", options.HintFileName);
+      exit(1);
+      }
+    hint_table = vtkParse_ReadHintTable(hfile, stderr);
+    fclose(hfile);
+    }
+}
+
+/* Command-line argument handler for wrapper tools */
+FileInfo *vtkParse_Main(int argc, char *argv[])
+{
+  vtkParseContext *context;
+  FileInfo *data;
+
+  parse_main_options(argc, argv, 0);
+  read_hint_file();
+
+  context = vtkParse_NewContext();
+  data = parse_header_file(context, &options, hint_table);
+  vtkParse_FreeContext(context);
+
+  return data;
+}
+
+/* Command-line argument handler for batch mode */
+int vtkParse_MainBatch(int argc, char *argv[])
+{
+  int n;
+
+  n = parse_main_options(argc, argv, 1);
+  read_hint_file();
+
+  return n;
+}
+
+/* Get the hints that were read from the hint file */
+const HintTable *vtkParse_GetHintTable()
+{
+  return hint_table;
+}
+
+/* Get the options for one of the headers */
+OptionInfo *vtkParse_GetBatchOptions(int i)
+{
+  if (i < 0 || i >= batch_count)
+    {
+    return NULL;
+    }
+
+  return &batch_entries[i];
+}
+
+/* Parse one of the headers */
+FileInfo *vtkParse_MainBatchFile(int i)
+{
+  vtkParseContext *context;
+  FileInfo *data;
+
+  context = vtkParse_NewContext();
+  data = vtkParse_MainBatchFileWithContext(context, i);
+  vtkParse_FreeContext(context);
+
+  return data;
+}
+
+/* Parse one of the headers with the given context */
+FileInfo *vtkParse_MainBatchFileWithContext(
+  vtkParseContext *context, int i)
+{
+  OptionInfo *opts = vtkParse_GetBatchOptions(i);
+
+  if (opts == NULL)
+    {
+    fprintf(stderr, "Header %d is not in the batch\n", i);
+    exit(1);
+    }
+
+  return parse_header_file(context, opts, hint_table);
+}
+
 /* Command-line argument handler for wrapper tools */
 void vtkParse_MainMulti(int argc, char *argv[])
 {
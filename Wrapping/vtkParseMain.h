@@ -22,6 +22,7 @@
  -U <macro>        cancel a macro definition
  -I <dir>          add an include directory
  -o <file>         specify the output file
+ -j <n>            number of threads, for tools that support it
  @<file>           read arguments from a file
  --help            print a help message and exit
  --version         print the VTK version number and exit
@@ -31,6 +32,14 @@
  --special         wrap a non-vtkObjectBase class
  --hints <file>    hints file
  --types <file>    type hierarchy file
+ --batch <file>    file that lists the headers to wrap
+ --macros <file>   file for caching the macro definitions
+ --binary <file>   binary type hierarchy file to write
+ --manifest <file> file that lists the hashes of the output files
+ --kit <file>      file that holds the XML for all the headers
+ --index <file>    file that gives the offset of each class in the kit
+ --fileinfo        write the parsed data in binary instead of XML
+ --dump            print the records of a file written with "--fileinfo"
 
  Notes:
 
@@ -45,11 +54,51 @@
 
  3) The options "--vtkobject" and "--special" are ignored if the
     "--types" option is used.
+
+ 4) The "--batch" option allows many headers to be wrapped by a
+    single process.  Each line of the batch file gives the options
+    for one header, for example "--concrete --vtkobject -o out.xml in.h",
+    while the options given on the command line apply to all headers.
+
+ 5) The "-j" option sets the number of threads for parsing headers,
+    and "-j 0" will use one thread per processor.
+ 6) The "--macros" file holds the macros that are defined before
+    each header is parsed.  It is written by the first process that
+    parses a header, and it is rewritten if the "-D" or "-U" options
+    change or if the standard macros of the wrapper tools change.
+
+ 7) The "--binary" option is for vtkWrapHierarchy, which will write
+    the hierarchy to the given file in a binary format as well as
+    writing the text file.  The binary file can be used with "--types".
+
+ 8) The "--manifest" option is for vtkWrapXML, which will write the
+    hash and size of each output file to the given file, one line per
+    output.  Output files whose contents have not changed are never
+    rewritten, and the manifest allows this to be checked without
+    reading the old files.
+
+ 9) The "--kit" option is for vtkWrapXML in batch mode, which will
+    write one document that holds the XML for all of the headers, and
+    "--index" will write a file that gives "<class> <offset> <length>"
+    for each class, where the offset and length are in bytes and give
+    the position of the header's XML within the kit document.  When
+    "--kit" is used, "-o" can be left out of the lines of the batch
+    file for the headers that do not need their own XML file.
+
+ 10) The "--fileinfo" option is for vtkWrapXML, which will write the
+    data for each header in the binary format of vtkParseBinary.h
+    instead of writing XML.  It cannot be used with "--kit".
+
+ 11) The "--dump" option is for vtkWrapXML, which will read each input
+    file as a binary file that was written with "--fileinfo" and print
+    its records to the output file as text.  No headers are parsed when
+    "--dump" is used.
 */
 
 #ifndef VTK_PARSE_MAIN_H
 #define VTK_PARSE_MAIN_H
 
+#include "vtkParse.h"
 #include "vtkParseData.h"
 #include <stdio.h>
 
@@ -64,10 +113,18 @@ typedef struct _OptionInfo
   char         *OutputFileName;    /* the second file, or the "-o" file */
   char         *HintFileName;      /* the file preceded by "--hints" */
   char         *HierarchyFileName; /* the file preceded by "--types" */
+  char         *BinaryFileName;    /* the file preceded by "--binary" */
+  char         *ManifestFileName;  /* the file preceded by "--manifest" */
+  char         *KitFileName;       /* the file preceded by "--kit" */
+  char         *IndexFileName;     /* the file preceded by "--index" */
+  int           IsFileInfo;        /* set when "--fileinfo" is set */
+  int           IsDump;            /* set when "--dump" is set */
   int           IsVTKObject;       /* set when "--vtkobject" is set */
   int           IsSpecialObject;   /* set when "--special" is set */
   int           IsConcrete;        /* set when "--concrete" is set */
   int           IsAbstract;        /* set when "--abstract" is set */
+  char         *BatchFileName;     /* the file preceded by "--batch" */
+  int           NumberOfThreads;   /* set by "-j", the default is 1 */
 } OptionInfo;
 
 #ifdef __cplusplus
@@ -84,6 +141,40 @@ OptionInfo *vtkParse_GetCommandLineOptions();
  */
 FileInfo *vtkParse_Main(int argc, char *argv[]);
 
+/**
+ * A main function for batch mode, for wrapper tools that can write
+ * many output files.  It returns the number of headers to wrap, which
+ * is one if "--batch" was not used.  It does not parse the headers.
+ * It will exit on error.
+ */
+int vtkParse_MainBatch(int argc, char *argv[]);
+
+/**
+ * Get the hints that were read from the "--hints" file, or NULL if
+ * there was no hints file.  The hints are read just once, by either
+ * vtkParse_Main() or vtkParse_MainBatch(), and are shared by all of
+ * the headers that are parsed.
+ */
+const HintTable *vtkParse_GetHintTable();
+
+/**
+ * Get the options for header "i" after vtkParse_MainBatch() is called.
+ */
+OptionInfo *vtkParse_GetBatchOptions(int i);
+
+/**
+ * Parse header "i" after vtkParse_MainBatch() is called, and apply
+ * the hints.  It will exit on error.
+ */
+FileInfo *vtkParse_MainBatchFile(int i);
+
+/**
+ * Parse header "i" with the given parser context.  Headers can be
+ * parsed by different threads if each thread has its own context.
+ */
+FileInfo *vtkParse_MainBatchFileWithContext(
+  vtkParseContext *context, int i);
+
 /**
  * A main function that can take multiple input files.
  * It does not parse the files.  It will exit on error.
@@ -13,16 +13,183 @@
 =========================================================================*/
 
 #include "vtkParse.h"
-#include "vtkParseMain.h"
 #include "vtkParseMerge.h"
 #include "vtkParseData.h"
 #include "vtkParseExtras.h"
 #include "vtkParseHierarchy.h"
+#include "vtkParseThreads.h"
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <ctype.h>
 
+/* A superclass header that was parsed, after the hints were applied */
+typedef struct _MergeCacheEntry
+{
+  const char *FileName;      /* full path to the header file */
+  FileInfo   *Data;
+} MergeCacheEntry;
+
+/* The data that is shared by all the classes that are merged */
+struct _MergeSession
+{
+  HierarchyInfo   *Hierarchy;        /* owned by the session */
+  const HintTable *Hints;            /* owned by the caller */
+  vtkParseMutex   *Mutex;            /* guards the headers */
+  unsigned long    NumberOfHeaders;
+  MergeCacheEntry *Headers;          /* the superclass headers */
+};
+
+/* find a header in the cache, the caller must hold the mutex */
+static FileInfo *merge_cache_find(
+  const MergeSession *session, const char *filename)
+{
+  unsigned long i;
+
+  for (i = 0; i < session->NumberOfHeaders; i++)
+    {
+    if (strcmp(session->Headers[i].FileName, filename) == 0)
+      {
+      return session->Headers[i].Data;
+      }
+    }
+
+  return NULL;
+}
+
+/* add a header to the cache, or return the header that is already
+ * there, the caller must hold the mutex */
+static FileInfo *merge_cache_add(
+  MergeSession *session, const char *filename, FileInfo *finfo)
+{
+  unsigned long n = session->NumberOfHeaders;
+  FileInfo *cached;
+  char *cp;
+
+  cached = merge_cache_find(session, filename);
+  if (cached)
+    {
+    return cached;
+    }
+
+  /* double the slots whenever size is a power of two */
+  if (n == 0 || (n & (n-1)) == 0)
+    {
+    session->Headers = (MergeCacheEntry *)realloc(
+      session->Headers, (n == 0 ? 4 : 2*n)*sizeof(MergeCacheEntry));
+    }
+
+  cp = (char *)malloc(strlen(filename) + 1);
+  strcpy(cp, filename);
+  session->Headers[n].FileName = cp;
+  session->Headers[n].Data = finfo;
+  session->NumberOfHeaders = n + 1;
+
+  return finfo;
+}
+
+/* Create a session for merging classes */
+MergeSession *vtkParseMerge_NewSession(
+  const char *hierarchyfile, const HintTable *hints)
+{
+  MergeSession *session;
+
+  session = (MergeSession *)malloc(sizeof(MergeSession));
+  session->Hierarchy = NULL;
+  session->Hints = hints;
+  session->Mutex = vtkParseThreads_NewMutex();
+  session->NumberOfHeaders = 0;
+  session->Headers = NULL;
+
+  if (hierarchyfile)
+    {
+    session->Hierarchy = vtkParseHierarchy_ReadFile(hierarchyfile);
+    }
+
+  return session;
+}
+
+/* Free the session and all the headers that it parsed */
+void vtkParseMerge_FreeSession(MergeSession *session)
+{
+  unsigned long i;
+
+  for (i = 0; i < session->NumberOfHeaders; i++)
+    {
+    free((char *)session->Headers[i].FileName);
+    vtkParse_Free(session->Headers[i].Data);
+    }
+  free(session->Headers);
+
+  if (session->Hierarchy)
+    {
+    vtkParseHierarchy_Free(session->Hierarchy);
+    }
+
+  vtkParseThreads_FreeMutex(session->Mutex);
+  free(session);
+}
+
+/* Parse the header file for a superclass and apply the hints, unless
+ * the header is already in the cache.  The result must not be changed,
+ * since it is shared. */
+static FileInfo *merge_parse_header(
+  MergeSession *session, const char *header)
+{
+  FILE *fp;
+  FileInfo *finfo;
+  FileInfo *cached;
+  const char *filename;
+
+  filename = vtkParse_FindIncludeFile(header);
+  if (!filename)
+    {
+    fprintf(stderr, "Couldn't locate header file %s\n", header);
+    exit(1);
+    }
+
+  vtkParseThreads_Lock(session->Mutex);
+  cached = merge_cache_find(session, filename);
+  vtkParseThreads_Unlock(session->Mutex);
+
+  if (cached)
+    {
+    return cached;
+    }
+
+  fp = fopen(filename, "r");
+  if (!fp)
+    {
+    fprintf(stderr, "Couldn't open header file %s\n", header);
+    exit(1);
+    }
+
+  finfo = vtkParse_ParseFile(filename, fp, stderr);
+  fclose(fp);
+
+  if (!finfo)
+    {
+    exit(1);
+    }
+
+  if (session->Hints)
+    {
+    vtkParse_ApplyHintTable(finfo, session->Hints, stderr);
+    }
+
+  /* another thread might have parsed the same header in the meantime */
+  vtkParseThreads_Lock(session->Mutex);
+  cached = merge_cache_add(session, filename, finfo);
+  vtkParseThreads_Unlock(session->Mutex);
+
+  if (cached != finfo)
+    {
+    vtkParse_Free(finfo);
+    }
+
+  return cached;
+}
+
 /* add a class to the MergeInfo */
 unsigned long vtkParseMerge_PushClass(MergeInfo *info, const char *classname)
 {
@@ -510,10 +677,11 @@ unsigned long vtkParseMerge_Merge(
 /* Recursive suproutine to add the methods of "classname" and all its
  * superclasses to "merge" */
 void vtkParseMerge_MergeHelper(
-  FileInfo *finfo, const NamespaceInfo *data, const HierarchyInfo *hinfo,
-  const char *classname, FILE *hintfile, MergeInfo *info, ClassInfo *merge)
+  MergeSession *session, FileInfo *finfo, const NamespaceInfo *data,
+  const char *classname, MergeInfo *info, ClassInfo *merge)
 {
-  FILE *fp = NULL;
+  const HierarchyInfo *hinfo = session->Hierarchy;
+  FileInfo *sfinfo = NULL;
   ClassInfo *cinfo = NULL;
   ClassInfo *new_cinfo = NULL;
   HierarchyEntry *entry = NULL;
@@ -522,7 +690,6 @@ void vtkParseMerge_MergeHelper(
   unsigned long template_arg_count = 0;
   const char *nspacename = NULL;
   const char *header;
-  const char *filename;
   unsigned long i, j, n, m;
   int recurse;
 
@@ -590,43 +757,14 @@ void vtkParseMerge_MergeHelper(
     header = entry->HeaderFile;
     if (!header)
       {
-      if (hintfile) { fclose(hintfile); }
       fprintf(stderr, "Null header file for class %s!\n", classname);
       exit(1);
       }
 
-    filename = vtkParse_FindIncludeFile(header);
-    if (!filename)
-      {
-      if (hintfile) { fclose(hintfile); }
-      fprintf(stderr, "Couldn't locate header file %s\n", header);
-      exit(1);
-      }
-
-    fp = fopen(filename, "r");
-    if (!fp)
-      {
-      if (hintfile) { fclose(hintfile); }
-      fprintf(stderr, "Couldn't open header file %s\n", header);
-      exit(1);
-      }
-
-    finfo = vtkParse_ParseFile(filename, fp, stderr);
-    fclose(fp);
-
-    if (!finfo)
-      {
-      if (hintfile) { fclose(hintfile); }
-      exit(1);
-      }
-
-    if (hintfile)
-      {
-      rewind(hintfile);
-      vtkParse_ReadHints(finfo, hintfile, stderr);
-      }
+    /* the parsed header is cached, so it is only parsed once */
+    sfinfo = merge_parse_header(session, header);
 
-    data = finfo->Contents;
+    data = sfinfo->Contents;
     if (nspacename)
       {
       m = data->NumberOfNamespaces;
@@ -668,14 +806,16 @@ void vtkParseMerge_MergeHelper(
 
   if (cinfo)
     {
+    /* merging removes methods from the superclass, so use a copy,
+     * since the class might be shared through the cache */
+    new_cinfo = (ClassInfo *)malloc(sizeof(ClassInfo));
+    vtkParse_CopyClass(new_cinfo, cinfo);
     if (template_args)
       {
-      new_cinfo = (ClassInfo *)malloc(sizeof(ClassInfo));
-      vtkParse_CopyClass(new_cinfo, cinfo);
       vtkParse_InstantiateClassTemplate(
         new_cinfo, finfo->Strings, template_arg_count, template_args);
-      cinfo = new_cinfo;
       }
+    cinfo = new_cinfo;
 
     recurse = 0;
     if (info)
@@ -701,10 +841,12 @@ void vtkParseMerge_MergeHelper(
       n = cinfo->NumberOfSuperClasses;
       for (i = 0; i < n; i++)
         {
-        vtkParseMerge_MergeHelper(finfo, data, hinfo, cinfo->SuperClasses[i],
-                                  hintfile, info, merge);
+        vtkParseMerge_MergeHelper(session, finfo, data,
+                                  cinfo->SuperClasses[i], info, merge);
         }
       }
+
+    vtkParse_FreeClass(new_cinfo);
     }
 
   if (template_arg_count > 0)
@@ -716,56 +858,33 @@ void vtkParseMerge_MergeHelper(
 
 /* Merge the methods from the superclasses */
 MergeInfo *vtkParseMerge_MergeSuperClasses(
-  FileInfo *finfo, NamespaceInfo *data, ClassInfo *classInfo)
+  MergeSession *session, FileInfo *finfo, NamespaceInfo *data,
+  ClassInfo *classInfo)
 {
-  FILE *hintfile = NULL;
-  HierarchyInfo *hinfo = NULL;
   MergeInfo *info = NULL;
-  OptionInfo *oinfo = NULL;
   unsigned long i, n;
 
-  oinfo = vtkParse_GetCommandLineOptions();
-
-  if (oinfo->HierarchyFileName)
+  if (session->Hierarchy)
     {
-    hinfo = vtkParseHierarchy_ReadFile(oinfo->HierarchyFileName);
-
-    if (oinfo->HintFileName)
-      {
-      hintfile = fopen(oinfo->HintFileName, "r");
-      }
-
     info = vtkParseMerge_CreateMergeInfo(classInfo);
 
     n = classInfo->NumberOfSuperClasses;
     for (i = 0; i < n; i++)
       {
-      vtkParseMerge_MergeHelper(finfo, data, hinfo,
+      vtkParseMerge_MergeHelper(session, finfo, data,
                                 classInfo->SuperClasses[i],
-                                hintfile, info, classInfo);
-      }
-
-    if (hintfile)
-      {
-      fclose(hintfile);
+                                info, classInfo);
       }
     }
 
-  if (hinfo)
-    {
-    vtkParseHierarchy_Free(hinfo);
-    }
-
   return info;
 }
 
 /* Merge superclass methods according to using declarations */
 void vtkParseMerge_ApplyUsingDeclarations(
-  FileInfo *finfo, NamespaceInfo *data, ClassInfo *classInfo)
+  MergeSession *session, FileInfo *finfo, NamespaceInfo *data,
+  ClassInfo *classInfo)
 {
-  FILE *hintfile = NULL;
-  HierarchyInfo *hinfo = NULL;
-  OptionInfo *oinfo = NULL;
   unsigned long i, n;
 
   /* first, check if there are any declarations to apply */
@@ -782,33 +901,14 @@ void vtkParseMerge_ApplyUsingDeclarations(
     return;
     }
 
-  oinfo = vtkParse_GetCommandLineOptions();
-
-  if (oinfo->HierarchyFileName)
+  if (session->Hierarchy)
     {
-    hinfo = vtkParseHierarchy_ReadFile(oinfo->HierarchyFileName);
-
-    if (oinfo->HintFileName)
-      {
-      hintfile = fopen(oinfo->HintFileName, "r");
-      }
-
     n = classInfo->NumberOfSuperClasses;
     for (i = 0; i < n; i++)
       {
-      vtkParseMerge_MergeHelper(finfo, data, hinfo,
+      vtkParseMerge_MergeHelper(session, finfo, data,
                                 classInfo->SuperClasses[i],
-                                hintfile, NULL, classInfo);
+                                NULL, classInfo);
       }
-
-    if (hintfile)
-      {
-      fclose(hintfile);
-      }
-    }
-
-  if (hinfo)
-    {
-    vtkParseHierarchy_Free(hinfo);
     }
 }
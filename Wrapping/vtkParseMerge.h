@@ -20,6 +20,7 @@
 #ifndef VTK_PARSE_MERGE_H
 #define VTK_PARSE_MERGE_H
 
+#include "vtkParse.h"
 #include "vtkParseData.h"
 
 /**
@@ -35,10 +36,33 @@ typedef struct _MergeInfo
   unsigned long **OverrideClasses;  /* class for the override */
 } MergeInfo;
 
+/**
+ * A session holds the data that is shared by all the classes that are
+ * merged by one process: the hierarchy file, the hints, and the headers
+ * of the superclasses, which are each parsed only once.  A session can
+ * be shared by several threads.
+ */
+typedef struct _MergeSession MergeSession;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * Create a session for merging classes.  The hierarchy file is read
+ * once, and it is needed to find the superclass headers.  The hints,
+ * which can be NULL, are applied to each superclass header and must
+ * not be freed until the session is freed.
+ */
+MergeSession *vtkParseMerge_NewSession(
+  const char *hierarchyfile, const HintTable *hints);
+
+/**
+ * Free the session, including the superclass headers that it parsed.
+ * This must not be called while other threads are using the session.
+ */
+void vtkParseMerge_FreeSession(MergeSession *session);
+
 /**
  * Merge all inherited methods into the ClassInfo.
  * This will find and parse the header files for all the superclasses,
@@ -47,7 +71,8 @@ extern "C" {
  * each inherited method was inherited from.
  */
 MergeInfo *vtkParseMerge_MergeSuperClasses(
-  FileInfo *finfo, NamespaceInfo *data, ClassInfo *classInfo);
+  MergeSession *session, FileInfo *finfo, NamespaceInfo *data,
+  ClassInfo *classInfo);
 
 /**
  * Free the MergeInfo object.
@@ -61,7 +86,8 @@ void vtkParseMerge_FreeMergeInfo(MergeInfo *info);
  * will be brought into the class.
  */
 void vtkParseMerge_ApplyUsingDeclarations(
-  FileInfo *finfo, NamespaceInfo *data, ClassInfo *classInfo);
+  MergeSession *session, FileInfo *finfo, NamespaceInfo *data,
+  ClassInfo *classInfo);
 
 #ifdef __cplusplus
 } /* extern "C" */
@@ -13,11 +13,18 @@
 =========================================================================*/
 
 #include "vtkParsePreprocess.h"
+#include "vtkParseThreads.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
-#include <errno.h>
 #include <sys/stat.h>
+#if defined(_WIN32)
+# include <process.h>
+# define getpid _getpid
+#else
+# include <unistd.h>
+# include <sys/mman.h>
+#endif
 
 /**
   This file handles preprocessor directives via a simple
@@ -26,12 +33,44 @@
 
 #define PREPROC_DEBUG 0
 
-/** Block size for reading files */
+/** Block size for reading files that cannot be mapped */
 #define FILE_BUFFER_SIZE 8192
 
 /** Size of hash table must be a power of two */
 #define PREPROC_HASH_TABLE_SIZE 1024u
 
+/** Number of macros in each chunk of the macro pool */
+#define PREPROC_MACRO_CHUNK_SIZE 256
+
+/** An entry in the macro hash table.  The full hash is stored so
+ * that most mismatches are rejected without a string comparison. */
+typedef struct _MacroHashEntry
+{
+  unsigned int  Hash;
+  MacroInfo    *Macro;
+} MacroHashEntry;
+
+/** The macro hash table uses open addressing with linear probing,
+ * and it doubles in size to keep the load factor below one half.
+ * The macros are allocated from a pool, so that their addresses do
+ * not change when the table grows. */
+struct _MacroTable
+{
+  MacroHashEntry  *Entries;
+  unsigned long    Size;           /* always a power of two */
+  unsigned long    Count;          /* number of occupied entries */
+  unsigned long    NumberOfChunks; /* the pool of macros */
+  MacroInfo      **Chunks;
+  unsigned long    ChunkPosition;  /* next free macro in last chunk */
+  unsigned long    NumberOfFreeMacros; /* macros that were removed */
+  unsigned long    MaxFreeMacros;
+  MacroInfo      **FreeMacros;
+};
+
+/** Header for macro files, which is followed by a stamp that is a hash
+ * of the standard macros, since they depend on the compiler */
+#define PREPROC_MACRO_FILE_MAGIC "VTKMACR1"
+
 /** Hashes for preprocessor keywords */
 #define HASH_IFDEF      0x0fa4b283u
 #define HASH_IFNDEF     0x04407ab1u
@@ -47,6 +86,71 @@
 #define HASH_LINE       0x7c9a15adu
 #define HASH_PRAGMA     0x1566a9fdu
 
+/** A header file that has been read, stored as the directive lines from
+ * the file so that the file can be included again without going to the
+ * filesystem.  The cache is shared by all threads, and the entries are
+ * never modified after they have been added to the cache. */
+typedef struct _PreprocessCachedFile
+{
+  const char *Path;
+  unsigned int Hash;
+  char *Directives;
+  size_t NumberOfDirectives;
+  const char *Guard; /* the include guard, within the first directive */
+  struct _PreprocessCachedFile *Next;
+} PreprocessCachedFile;
+
+/** The cache of header files, guarded by the global mutex */
+static PreprocessCachedFile *preproc_file_cache[PREPROC_HASH_TABLE_SIZE];
+
+/** The file that was found for an "#include" spelling.  The file that
+ * is found depends on the directory of the including file (except for
+ * system includes), and on the include path.  These are shared by all
+ * threads, and are never modified after they are added. */
+typedef struct _PreprocessIncludeSpelling
+{
+  const char *Text; /* the including file's directory, then the spelling */
+  size_t DirectoryLength;
+  unsigned int Hash;
+  unsigned int IncludePath; /* the hash of the include directories */
+  int SystemFirst;
+  PreprocessCachedFile *File;
+  struct _PreprocessIncludeSpelling *Next;
+} PreprocessIncludeSpelling;
+
+/** The include spellings, guarded by the global mutex */
+static PreprocessIncludeSpelling *preproc_spelling_cache[
+  PREPROC_HASH_TABLE_SIZE];
+
+/** The result of stat() for a possible include file path.  These are
+ * shared by all threads, and it is assumed that header files do not
+ * appear or disappear while the process is running. */
+typedef struct _PreprocessFileStat
+{
+  const char *Path;
+  unsigned int Hash;
+  int IsFile;
+  struct _PreprocessFileStat *Next;
+} PreprocessFileStat;
+
+/** The stat cache, guarded by the global mutex, it grows as needed */
+static PreprocessFileStat **preproc_stat_cache = NULL;
+static unsigned int preproc_stat_cache_size = 0;
+static unsigned int preproc_stat_cache_count = 0;
+
+/** Hash a file path, for the include file tables */
+static unsigned int preproc_hash_path(const char *path)
+{
+  unsigned int h = 5381;
+
+  while (*path != '\0')
+    {
+    h = (h << 5) + h + (unsigned char)*path++;
+    }
+
+  return h;
+}
+
 /** Extend dynamic arrays in a progression of powers of two.
  * Whenever "n" reaches a power of two, then the array size is
  * doubled so that "n" can be safely incremented. */
@@ -126,12 +230,64 @@ static int preproc_identical(const char *text1, const char *text2)
   return result;
 }
 
+/** Get the macro table, create it if it does not exist yet. */
+static MacroTable *preproc_macro_table(PreprocessInfo *info)
+{
+  MacroTable *table = info->MacroHashTable;
+
+  if (table == NULL)
+    {
+    table = (MacroTable *)malloc(sizeof(MacroTable));
+    table->Size = PREPROC_HASH_TABLE_SIZE;
+    table->Count = 0;
+    table->Entries = (MacroHashEntry *)malloc(
+      table->Size*sizeof(MacroHashEntry));
+    memset(table->Entries, 0, table->Size*sizeof(MacroHashEntry));
+    table->NumberOfChunks = 0;
+    table->Chunks = NULL;
+    table->ChunkPosition = PREPROC_MACRO_CHUNK_SIZE;
+    table->NumberOfFreeMacros = 0;
+    table->MaxFreeMacros = 0;
+    table->FreeMacros = NULL;
+    info->MacroHashTable = table;
+    }
+
+  return table;
+}
+
+/** Allocate a macro from the pool. */
+static MacroInfo *preproc_alloc_macro(PreprocessInfo *info)
+{
+  MacroTable *table = preproc_macro_table(info);
+  MacroInfo *macro;
+
+  if (table->NumberOfFreeMacros > 0)
+    {
+    macro = table->FreeMacros[--table->NumberOfFreeMacros];
+    }
+  else
+    {
+    if (table->ChunkPosition == PREPROC_MACRO_CHUNK_SIZE)
+      {
+      table->Chunks = (MacroInfo **)preproc_array_check(
+        table->Chunks, sizeof(MacroInfo *), table->NumberOfChunks);
+      table->Chunks[table->NumberOfChunks++] = (MacroInfo *)malloc(
+        PREPROC_MACRO_CHUNK_SIZE*sizeof(MacroInfo));
+      table->ChunkPosition = 0;
+      }
+    macro = &table->Chunks[table->NumberOfChunks-1][table->ChunkPosition++];
+    }
+
+  vtkParsePreprocess_InitMacro(macro);
+
+  return macro;
+}
+
 /** Create a new preprocessor macro. */
 static MacroInfo *preproc_new_macro(
   PreprocessInfo *info, const char *name, const char *definition)
 {
-  MacroInfo *macro = (MacroInfo *)malloc(sizeof(MacroInfo));
-  vtkParsePreprocess_InitMacro(macro);
+  MacroInfo *macro = preproc_alloc_macro(info);
 
   if (name)
     {
@@ -161,150 +317,181 @@ static MacroInfo *preproc_new_macro(
   return macro;
 }
 
-/** Free a preprocessor macro struct. */
-static void preproc_free_macro(MacroInfo *info)
+/** Free a preprocessor macro struct, by returning it to the pool. */
+static void preproc_free_macro(PreprocessInfo *info, MacroInfo *macro)
 {
-  free(info);
+  MacroTable *table = info->MacroHashTable;
+
+  free((char **)macro->Parameters);
+  macro->Parameters = NULL;
+
+  /* the free list shrinks and grows, so its capacity is kept */
+  if (table->NumberOfFreeMacros == table->MaxFreeMacros)
+    {
+    table->MaxFreeMacros = (table->MaxFreeMacros ?
+                            2*table->MaxFreeMacros : 16);
+    table->FreeMacros = (MacroInfo **)realloc(
+      table->FreeMacros, table->MaxFreeMacros*sizeof(MacroInfo *));
+    }
+  table->FreeMacros[table->NumberOfFreeMacros++] = macro;
 }
 
-/** Find a preprocessor macro, return 0 if not found. */
-static MacroInfo *preproc_find_macro(
-  PreprocessInfo *info, StringTokenizer *token)
+/** Find the table entry for a macro, or the empty entry where it
+ * would be inserted.  The table must not be NULL. */
+static MacroHashEntry *preproc_probe_macro(
+  MacroTable *table, StringTokenizer *token)
 {
-  unsigned int m = PREPROC_HASH_TABLE_SIZE - 1;
-  unsigned int i = (token->hash & m);
+  unsigned long m = table->Size - 1;
+  unsigned long i = (token->hash & m);
+  unsigned int h = token->hash;
   const char *name = token->text;
   size_t l = token->len;
-  MacroInfo ***htable = info->MacroHashTable;
-  MacroInfo **hptr;
+  MacroHashEntry *entry;
   const char *mname;
 
-  if (htable && ((hptr = htable[i]) != NULL) && *hptr)
+  for (entry = &table->Entries[i]; entry->Macro != NULL;
+       entry = &table->Entries[i])
     {
-    do
+    /* the hash rejects nearly all mismatches */
+    if (entry->Hash == h)
       {
-      mname = (*hptr)->Name;
+      mname = entry->Macro->Name;
       if (mname[0] == name[0] &&
           strncmp(mname, name, l) == 0 &&
           mname[l] == '\0')
         {
-        return *hptr;
+        break;
         }
-      hptr++;
       }
-    while (*hptr);
+    i = ((i + 1) & m);
+    }
+
+  return entry;
+}
+
+/** Double the size of the macro table. */
+static void preproc_grow_macro_table(MacroTable *table)
+{
+  MacroHashEntry *entries = table->Entries;
+  unsigned long n = table->Size;
+  unsigned long m = 2*n - 1;
+  unsigned long i, j;
+
+  table->Size = 2*n;
+  table->Count = 0;
+  table->Entries = (MacroHashEntry *)malloc(
+    table->Size*sizeof(MacroHashEntry));
+  memset(table->Entries, 0, table->Size*sizeof(MacroHashEntry));
+
+  for (i = 0; i < n; i++)
+    {
+    if (entries[i].Macro)
+      {
+      j = (entries[i].Hash & m);
+      while (table->Entries[j].Macro) { j = ((j + 1) & m); }
+      table->Entries[j] = entries[i];
+      table->Count++;
+      }
+    }
+
+  free(entries);
+}
+
+/** Find a preprocessor macro, return 0 if not found. */
+static MacroInfo *preproc_find_macro(
+  PreprocessInfo *info, StringTokenizer *token)
+{
+  MacroTable *table = info->MacroHashTable;
+
+  if (table)
+    {
+    return preproc_probe_macro(table, token)->Macro;
     }
 
   return NULL;
 }
 
 /** Return the address of the macro within the hash table.
-  * If "insert" is nonzero, add a new location if macro not found. */
+  * If "insert" is nonzero, add a new location if macro not found.
+  * The location is only valid until the next insertion. */
 static MacroInfo **preproc_macro_location(
   PreprocessInfo *info, StringTokenizer *token, int insert)
 {
-  MacroInfo ***htable = info->MacroHashTable;
-  unsigned int m = PREPROC_HASH_TABLE_SIZE - 1;
-  unsigned int i = (token->hash & m);
-  const char *name = token->text;
-  size_t l = token->len;
-  size_t n;
-  MacroInfo **hptr;
-  const char *mname;
+  MacroTable *table = info->MacroHashTable;
+  MacroHashEntry *entry;
 
-  if (htable == NULL)
+  if (table == NULL)
     {
     if (!insert)
       {
       return NULL;
       }
+    table = preproc_macro_table(info);
+    }
 
-    m = PREPROC_HASH_TABLE_SIZE;
-    htable = (MacroInfo ***)malloc(m*sizeof(MacroInfo **));
-    info->MacroHashTable = htable;
-    do { *htable++ = NULL; } while (--m);
-    htable = info->MacroHashTable;
+  /* keep the load factor below one half */
+  if (insert && 2*(table->Count + 1) > table->Size)
+    {
+    preproc_grow_macro_table(table);
     }
 
-  hptr = htable[i];
+  entry = preproc_probe_macro(table, token);
 
-  if (hptr == NULL)
+  if (entry->Macro == NULL)
     {
     if (!insert)
       {
       return NULL;
       }
 
-    hptr = (MacroInfo **)malloc(2*sizeof(MacroInfo *));
-    hptr[0] = NULL;
-    hptr[1] = NULL;
-    htable[i] = hptr;
-    }
-  else if (*hptr)
-    {
-    /* see if macro is already there */
-    n = 0;
-    do
-      {
-      mname = (*hptr)->Name;
-      if (mname[0] == name[0] &&
-          strncmp(mname, name, l) == 0 &&
-          mname[l] == '\0')
-        {
-        break;
-        }
-      n++;
-      hptr++;
-      }
-    while (*hptr);
-
-    if (*hptr == NULL)
-      {
-      if (!insert)
-        {
-        return NULL;
-        }
-
-      /* if n+1 is a power of two, double allocated space */
-      if (n > 0 && (n & (n+1)) == 0)
-        {
-        hptr = htable[i];
-        hptr = (MacroInfo **)realloc(hptr, (2*(n+1))*sizeof(MacroInfo *));
-        htable[i] = hptr;
-        hptr += n;
-        }
-
-      /* add a terminating null */
-      hptr[1] = NULL;
-      }
+    /* the count includes locations that the caller might not fill,
+     * it is made exact again when the table grows */
+    entry->Hash = token->hash;
+    table->Count++;
     }
 
-  return hptr;
+  return &entry->Macro;
 }
 
 /** Remove a preprocessor macro.  Returns 0 if macro not found. */
 static int preproc_remove_macro(
   PreprocessInfo *info, StringTokenizer *token)
 {
-  MacroInfo **hptr;
+  MacroTable *table = info->MacroHashTable;
+  MacroHashEntry *entries;
+  unsigned long m, i, j, k;
+
+  if (table == NULL)
+    {
+    return 0;
+    }
 
-  hptr = preproc_macro_location(info, token, 0);
+  entries = table->Entries;
+  m = table->Size - 1;
+  i = preproc_probe_macro(table, token) - entries;
 
-  if (hptr && *hptr)
+  if (entries[i].Macro == NULL)
     {
-    preproc_free_macro(*hptr);
+    return 0;
+    }
 
-    do
+  preproc_free_macro(info, entries[i].Macro);
+
+  /* shift back any following entries that probed past this one */
+  for (j = ((i + 1) & m); entries[j].Macro != NULL; j = ((j + 1) & m))
+    {
+    k = (entries[j].Hash & m);
+    if ((j > i && (k <= i || k > j)) || (j < i && (k <= i && k > j)))
       {
-      hptr[0] = hptr[1];
-      hptr++;
+      entries[i] = entries[j];
+      i = j;
       }
-    while (*hptr);
-
-    return 1;
     }
 
-  return 0;
+  entries[i].Macro = NULL;
+  table->Count--;
+
+  return 1;
 }
 
 /** A simple way to add a preprocessor macro definition. */
@@ -1569,29 +1756,161 @@ static int preproc_evaluate_define(
 }
 
 /**
- * Add an include file to the list.  Return 0 if it is already there.
+ * Look up an include file in the hash table of included files, and
+ * return the stored path or NULL if the file was not included.
  */
-static int preproc_add_include_file(PreprocessInfo *info, const char *name)
+static const char *preproc_lookup_include_file(
+  PreprocessInfo *info, const char *name)
 {
-  unsigned long i, n;
+  const char **htable = info->IncludeFileHashTable;
+  unsigned long m;
+  unsigned int i;
 
-  n = info->NumberOfIncludeFiles;
-  for (i = 0; i < n; i++)
+  if (htable == NULL)
+    {
+    return NULL;
+    }
+
+  /* the table size is twice the power of two that exceeds the count */
+  m = 2;
+  while (m <= info->NumberOfIncludeFiles) { m <<= 1; }
+  m = 2*m - 1;
+
+  for (i = (preproc_hash_path(name) & m); htable[i] != NULL; i = (i+1) & m)
     {
-    if (strcmp(info->IncludeFiles[i], name) == 0)
+    if (strcmp(htable[i], name) == 0)
       {
-      return 0;
+      return htable[i];
       }
     }
 
+  return NULL;
+}
+
+/**
+ * Add an include file to the list and to the hash table, and return
+ * the stored path.  The file must not already be in the list.
+ */
+static const char *preproc_insert_include_file(
+  PreprocessInfo *info, const char *name)
+{
+  const char **htable;
+  const char *path;
+  unsigned long n = info->NumberOfIncludeFiles;
+  unsigned long i, m;
+  unsigned int j;
+
+  path = vtkParse_CacheString(info->Strings, name, strlen(name));
   info->IncludeFiles = (const char **)preproc_array_check(
-    (char **)info->IncludeFiles, sizeof(char *), info->NumberOfIncludeFiles);
-  info->IncludeFiles[info->NumberOfIncludeFiles++] =
-    vtkParse_CacheString(info->Strings, name, strlen(name));
+    (char **)info->IncludeFiles, sizeof(char *), n);
+  info->IncludeFiles[info->NumberOfIncludeFiles++] = path;
+
+  /* the table is rebuilt with double size when the count reaches a
+   * power of two, so that it is never more than half full */
+  m = 2;
+  while (m <= n + 1) { m <<= 1; }
+  m = 2*m - 1;
+  if (info->IncludeFileHashTable == NULL || ((n + 1) & n) == 0)
+    {
+    free((char **)info->IncludeFileHashTable);
+    htable = (const char **)malloc((m + 1)*sizeof(char *));
+    memset((char **)htable, 0, (m + 1)*sizeof(char *));
+    info->IncludeFileHashTable = htable;
+    for (i = 0; i < n; i++)
+      {
+      j = (preproc_hash_path(info->IncludeFiles[i]) & m);
+      while (htable[j] != NULL) { j = (j+1) & m; }
+      htable[j] = info->IncludeFiles[i];
+      }
+    }
+
+  htable = info->IncludeFileHashTable;
+  j = (preproc_hash_path(path) & m);
+  while (htable[j] != NULL) { j = (j+1) & m; }
+  htable[j] = path;
+
+  return path;
+}
+
+/**
+ * Add an include file to the list.  Return 0 if it is already there.
+ */
+static int preproc_add_include_file(PreprocessInfo *info, const char *name)
+{
+  if (preproc_lookup_include_file(info, name))
+    {
+    return 0;
+    }
+
+  preproc_insert_include_file(info, name);
 
   return 1;
 }
 
+/**
+ * Check whether a path is a file, using the stat cache.  This must
+ * be called while the global mutex is locked.
+ */
+static int preproc_stat_file(const char *path)
+{
+  PreprocessFileStat **htable;
+  PreprocessFileStat *entry;
+  PreprocessFileStat *next;
+  struct stat fs;
+  unsigned int h = preproc_hash_path(path);
+  unsigned int m, i;
+
+  if (preproc_stat_cache)
+    {
+    m = preproc_stat_cache_size - 1;
+    for (entry = preproc_stat_cache[h & m]; entry; entry = entry->Next)
+      {
+      if (entry->Hash == h && strcmp(entry->Path, path) == 0)
+        {
+        return entry->IsFile;
+        }
+      }
+    }
+
+  entry = (PreprocessFileStat *)malloc(sizeof(PreprocessFileStat));
+  entry->Path = strcpy((char *)malloc(strlen(path) + 1), path);
+  entry->Hash = h;
+#if defined(_WIN32) && !defined(__CYGWIN__)
+  entry->IsFile = (stat(path, &fs) == 0 &&
+                   (fs.st_mode & _S_IFMT) != _S_IFDIR);
+#else
+  entry->IsFile = (stat(path, &fs) == 0 && !S_ISDIR(fs.st_mode));
+#endif
+
+  /* double the table size when it is full */
+  if (preproc_stat_cache_count >= preproc_stat_cache_size)
+    {
+    m = (preproc_stat_cache_size ? 2*preproc_stat_cache_size : 1024);
+    htable = (PreprocessFileStat **)malloc(m*sizeof(PreprocessFileStat *));
+    memset(htable, 0, m*sizeof(PreprocessFileStat *));
+    for (i = 0; i < preproc_stat_cache_size; i++)
+      {
+      for (next = preproc_stat_cache[i]; next != NULL; )
+        {
+        PreprocessFileStat *tmp = next;
+        next = next->Next;
+        tmp->Next = htable[tmp->Hash & (m - 1)];
+        htable[tmp->Hash & (m - 1)] = tmp;
+        }
+      }
+    free(preproc_stat_cache);
+    preproc_stat_cache = htable;
+    preproc_stat_cache_size = m;
+    }
+
+  m = preproc_stat_cache_size - 1;
+  entry->Next = preproc_stat_cache[h & m];
+  preproc_stat_cache[h & m] = entry;
+  preproc_stat_cache_count++;
+
+  return entry->IsFile;
+}
+
 /**
  * Find an include file.  If "cache_only" is set, then do a check to
  * see if the file was previously found without going to the filesystem.
@@ -1600,13 +1919,14 @@ const char *preproc_find_include_file(
   PreprocessInfo *info, const char *filename, int system_first,
   int cache_only)
 {
-  unsigned long i, n, ii, nn;
+  unsigned long i, n;
   size_t j, m;
-  struct stat fs;
   const char *directory;
+  const char *path;
   char *output;
   size_t outputsize = 16;
   int count;
+  int found;
 
   /* allow filename to be terminated by quote or bracket */
   m = 0;
@@ -1640,28 +1960,14 @@ const char *preproc_find_include_file(
     strncpy(output, filename, m);
     output[m] = '\0';
 
-    nn = info->NumberOfIncludeFiles;
-    for (ii = 0; ii < nn; ii++)
+    path = preproc_lookup_include_file(info, output);
+    if (path == NULL && !cache_only)
       {
-      if (strcmp(output, info->IncludeFiles[ii]) == 0)
-        {
-        free(output);
-        return info->IncludeFiles[ii];
-        }
-      }
-
-    if (cache_only)
-      {
-      free(output);
-      return NULL;
+      path = preproc_insert_include_file(info, output);
       }
 
-    info->IncludeFiles = (const char **)preproc_array_check(
-      (char **)info->IncludeFiles, sizeof(char *),
-      info->NumberOfIncludeFiles);
-    info->IncludeFiles[info->NumberOfIncludeFiles++] = output;
-
-    return output;
+    free(output);
+    return path;
     }
 
   /* Make sure the current filename is already added */
@@ -1729,31 +2035,25 @@ const char *preproc_find_include_file(
 
       if (count == 0)
         {
-        nn = info->NumberOfIncludeFiles;
-        for (ii = 0; ii < nn; ii++)
+        path = preproc_lookup_include_file(info, output);
+        if (path)
           {
-          if (strcmp(output, info->IncludeFiles[ii]) == 0)
-            {
-            free(output);
-            return info->IncludeFiles[ii];
-            }
+          free(output);
+          return path;
           }
         }
-#if defined(_WIN32) && !defined(__CYGWIN__)
-      else if (stat(output, &fs) == 0 &&
-               (fs.st_mode & _S_IFMT) != _S_IFDIR)
-#else
-      else if (stat(output, &fs) == 0 &&
-               !S_ISDIR(fs.st_mode))
-#endif
+      else
         {
-        nn = info->NumberOfIncludeFiles;
-        info->IncludeFiles = (const char **)preproc_array_check(
-          (char **)info->IncludeFiles, sizeof(char *), nn);
-        info->IncludeFiles[info->NumberOfIncludeFiles++] =
-          vtkParse_CacheString(info->Strings, output, strlen(output));
-        free(output);
-        return info->IncludeFiles[nn];
+        /* the stat cache is shared by all threads */
+        vtkParseThreads_LockGlobal();
+        found = preproc_stat_file(output);
+        vtkParseThreads_UnlockGlobal();
+        if (found)
+          {
+          path = preproc_insert_include_file(info, output);
+          free(output);
+          return path;
+          }
         }
       }
     }
@@ -1829,159 +2129,360 @@ void preproc_escape_string(
 }
 
 /**
- * Include a file.  All macros defined in the included file
- * will have their IsExternal flag set.
+ * Find a file in the cache of header files, or return NULL.
  */
-static int preproc_include_file(
-  PreprocessInfo *info, const char *filename, int system_first)
+static PreprocessCachedFile *preproc_find_cached_file(
+  const char *path, unsigned int h)
 {
-  const char *switchchars = "\n\r\"\'\?\\/*()";
-  char switchchar[256];
-  char *tbuf;
-  size_t tbuflen = FILE_BUFFER_SIZE;
-  char *line;
-  size_t linelen = 80;
-  size_t i, j, n, r;
-  size_t d = 0;
-  size_t dn = 0;
-  int state = 0;
-  int result = VTK_PARSE_OK;
-  FILE *fp = NULL;
-  const char *path = NULL;
-  const char *save_filename;
-  int save_external;
+  PreprocessCachedFile *entry;
 
-  /* check to see if the file has aleady been included */
-  path = preproc_find_include_file(info, filename, system_first, 1);
-  if (path != 0)
+  vtkParseThreads_LockGlobal();
+  entry = preproc_file_cache[h & (PREPROC_HASH_TABLE_SIZE - 1)];
+  while (entry && (entry->Hash != h || strcmp(entry->Path, path) != 0))
     {
-#if PREPROC_DEBUG
-    int k = 0;
-    while (filename[k] != '>' && filename[k] != '\"' &&
-           filename[k] != '\n' && filename[k] != '\0') { k++; }
-    if (filename[k] == '>')
-      fprintf(stderr, "already loaded file <%*.*s>\n", k, k, filename);
-    else
-      fprintf(stderr, "already loaded file \"%*.*s\"\n", k, k, filename);
-#endif
+    entry = entry->Next;
+    }
+  vtkParseThreads_UnlockGlobal();
 
-    return VTK_PARSE_OK;
+  return entry;
+}
+
+/**
+ * Add a file to the cache of header files.  If another thread added
+ * the same file first, then the new entry is freed and the existing
+ * entry is returned.
+ */
+static PreprocessCachedFile *preproc_add_cached_file(
+  PreprocessCachedFile *entry)
+{
+  PreprocessCachedFile **htable;
+  PreprocessCachedFile *other;
+
+  vtkParseThreads_LockGlobal();
+  htable = &preproc_file_cache[entry->Hash & (PREPROC_HASH_TABLE_SIZE - 1)];
+  for (other = *htable; other != NULL; other = other->Next)
+    {
+    if (other->Hash == entry->Hash && strcmp(other->Path, entry->Path) == 0)
+      {
+      break;
+      }
     }
-  /* go to the filesystem */
-  path = preproc_find_include_file(info, filename, system_first, 0);
-  if (path == NULL)
+  if (other == NULL)
     {
-#if PREPROC_DEBUG
-    int k = 0;
-    while (filename[k] != '>' && filename[k] != '\"' &&
-           filename[k] != '\n' && filename[k] != '\0') { k++; }
-    if (filename[k] == '>')
-      fprintf(stderr, "couldn't find file <%*.*s>\n", k, k, filename);
-    else
-      fprintf(stderr, "couldn't find file \"%*.*s\"\n", k, k, filename);
-#endif
-    return VTK_PARSE_FILE_NOT_FOUND;
+    entry->Next = *htable;
+    *htable = entry;
     }
+  vtkParseThreads_UnlockGlobal();
 
-#if PREPROC_DEBUG
-  fprintf(stderr, "including file %s\n", path);
-#endif
-  fp = fopen(path, "r");
-
-  if (fp == NULL)
+  if (other != NULL)
     {
-#if PREPROC_DEBUG
-    fprintf(stderr, "couldn't open file %s\n", path);
-#endif
-    return VTK_PARSE_FILE_OPEN_ERROR;
+    free((char *)entry->Path);
+    free(entry->Directives);
+    free(entry);
+    entry = other;
     }
 
-  save_external = info->IsExternal;
-  save_filename = info->FileName;
-  info->IsExternal = 1;
-  info->FileName = path;
+  return entry;
+}
 
-  /* make a table of interesting characters */
-  memset(switchchar, '\0', 256);
-  n = strlen(switchchars) + 1;
-  for (i = 0; i < n; i++)
+/**
+ * Get the hash of an "#include" spelling, along with the length of the
+ * directory of the current file and the length of the spelling.
+ */
+static unsigned int preproc_hash_spelling(
+  PreprocessInfo *info, const char *filename, int system_first,
+  size_t *dirlenp, size_t *lenp)
+{
+  unsigned int h = 5381;
+  size_t j = 0;
+  size_t m = 0;
+  size_t i;
+
+  /* the directory of the current file is not searched for <file> */
+  if (!system_first && info->FileName)
     {
-    switchchar[(unsigned char)(switchchars[i])] = 1;
+    j = strlen(info->FileName);
+    while (j > 0 && info->FileName[j-1] != '/') { j--; }
     }
 
-  tbuf = (char *)malloc(tbuflen+4);
-  line = (char *)malloc(linelen);
+  while (filename[m] != '\"' && filename[m] != '>' &&
+         filename[m] != '\n' && filename[m] != '\0') { m++; }
 
-  /* the buffer must hold a whole line for it to be processed */
-  j = 0;
-  i = 0;
-  n = 0;
-  r = 0;
+  for (i = 0; i < j; i++)
+    {
+    h = (h << 5) + h + (unsigned char)info->FileName[i];
+    }
+  for (i = 0; i < m; i++)
+    {
+    h = (h << 5) + h + (unsigned char)filename[i];
+    }
+  h = (h << 5) + h + info->IncludeDirectoriesHash;
+  h = (h << 5) + h + (system_first != 0);
 
-  do
+  *dirlenp = j;
+  *lenp = m;
+  return h;
+}
+
+/**
+ * Find the cached file for an "#include" spelling, or return NULL if
+ * the file has not been found with this spelling before.
+ */
+static PreprocessCachedFile *preproc_find_spelling(
+  PreprocessInfo *info, const char *filename, int system_first)
+{
+  PreprocessIncludeSpelling *entry;
+  size_t j, m;
+  unsigned int h;
+
+  system_first = (system_first != 0);
+  h = preproc_hash_spelling(info, filename, system_first, &j, &m);
+
+  vtkParseThreads_LockGlobal();
+  for (entry = preproc_spelling_cache[h & (PREPROC_HASH_TABLE_SIZE - 1)];
+       entry != NULL; entry = entry->Next)
     {
-    if (i >= n)
+    if (entry->Hash == h &&
+        entry->IncludePath == info->IncludeDirectoriesHash &&
+        entry->SystemFirst == system_first &&
+        entry->DirectoryLength == j &&
+        strncmp(entry->Text, info->FileName, j) == 0 &&
+        strncmp(&entry->Text[j], filename, m) == 0 &&
+        entry->Text[j+m] == '\0')
       {
-      /* recycle unused lookahead chars */
-      if (r)
+      break;
+      }
+    }
+  vtkParseThreads_UnlockGlobal();
+
+  return (entry ? entry->File : NULL);
+}
+
+/**
+ * Add an "#include" spelling and the cached file that was found for it.
+ */
+static void preproc_add_spelling(
+  PreprocessInfo *info, const char *filename, int system_first,
+  PreprocessCachedFile *file)
+{
+  PreprocessIncludeSpelling **htable;
+  PreprocessIncludeSpelling *entry;
+  char *text;
+  size_t j, m;
+  unsigned int h;
+
+  system_first = (system_first != 0);
+  h = preproc_hash_spelling(info, filename, system_first, &j, &m);
+
+  text = (char *)malloc(j + m + 1);
+  if (j > 0)
+    {
+    memcpy(text, info->FileName, j);
+    }
+  memcpy(&text[j], filename, m);
+  text[j+m] = '\0';
+
+  entry = (PreprocessIncludeSpelling *)malloc(
+    sizeof(PreprocessIncludeSpelling));
+  entry->Text = text;
+  entry->DirectoryLength = j;
+  entry->Hash = h;
+  entry->IncludePath = info->IncludeDirectoriesHash;
+  entry->SystemFirst = system_first;
+  entry->File = file;
+
+  /* if another thread added the same spelling, then both entries
+   * refer to the same cached file, so the duplicate does no harm */
+  vtkParseThreads_LockGlobal();
+  htable = &preproc_spelling_cache[h & (PREPROC_HASH_TABLE_SIZE - 1)];
+  entry->Next = *htable;
+  *htable = entry;
+  vtkParseThreads_UnlockGlobal();
+}
+
+/**
+ * Check whether the directives are enclosed by "#ifndef X" or
+ * "#if !defined(X)" and a matching "#endif", with no "#else" or
+ * "#elif".  If so, return a pointer to the guard macro X.
+ */
+static const char *preproc_find_guard(const char *text, size_t n)
+{
+  StringTokenizer tokens;
+  const char *guard = NULL;
+  int depth = 0;
+  size_t i;
+
+  if (n < 2)
+    {
+    return NULL;
+    }
+
+  /* check the first directive */
+  vtkParse_InitTokenizer(&tokens, text, WS_PREPROC);
+  vtkParse_NextToken(&tokens);
+  if (tokens.tok == TOK_ID && tokens.hash == HASH_IFNDEF &&
+      tokens.len == 6 && strncmp(tokens.text, "ifndef", 6) == 0)
+    {
+    vtkParse_NextToken(&tokens);
+    if (tokens.tok == TOK_ID)
+      {
+      guard = tokens.text;
+      vtkParse_NextToken(&tokens);
+      }
+    }
+  else if (tokens.tok == TOK_ID && tokens.hash == HASH_IF &&
+           tokens.len == 2 && strncmp(tokens.text, "if", 2) == 0)
+    {
+    vtkParse_NextToken(&tokens);
+    if (tokens.tok == '!')
+      {
+      vtkParse_NextToken(&tokens);
+      if (tokens.tok == TOK_ID && tokens.hash == HASH_DEFINED &&
+          tokens.len == 7 && strncmp(tokens.text, "defined", 7) == 0)
         {
-        r = n + 2 - i;
-        if (r == 2)
+        vtkParse_NextToken(&tokens);
+        if (tokens.tok == '(')
           {
-          tbuf[0] = tbuf[tbuflen-2];
-          tbuf[1] = tbuf[tbuflen-1];
+          vtkParse_NextToken(&tokens);
+          if (tokens.tok == TOK_ID)
+            {
+            guard = tokens.text;
+            vtkParse_NextToken(&tokens);
+            if (tokens.tok != ')')
+              {
+              guard = NULL;
+              }
+            vtkParse_NextToken(&tokens);
+            }
           }
-        else if (r == 1)
+        else if (tokens.tok == TOK_ID)
           {
-          tbuf[0] = tbuf[tbuflen-1];
+          guard = tokens.text;
+          vtkParse_NextToken(&tokens);
           }
         }
+      }
+    }
+
+  if (guard == NULL || tokens.tok != 0)
+    {
+    return NULL;
+    }
 
-      /* read the next chunk of the file */
-      i = 0;
-      if (feof(fp))
+  /* the matching "#endif" must be the last directive */
+  for (i = 0; i < n; i++)
+    {
+    vtkParse_InitTokenizer(&tokens, text, WS_PREPROC);
+    vtkParse_NextToken(&tokens);
+    if (tokens.tok == TOK_ID)
+      {
+      if ((tokens.hash == HASH_IF && tokens.len == 2 &&
+           strncmp("if", tokens.text, tokens.len) == 0) ||
+          (tokens.hash == HASH_IFDEF && tokens.len == 5 &&
+           strncmp("ifdef", tokens.text, tokens.len) == 0) ||
+          (tokens.hash == HASH_IFNDEF && tokens.len == 6 &&
+           strncmp("ifndef", tokens.text, tokens.len) == 0))
         {
-        /* still have the lookahead chars left */
-        n = r;
-        r = 0;
+        depth++;
         }
-      else
+      else if ((tokens.hash == HASH_ELIF && tokens.len == 4 &&
+                strncmp("elif", tokens.text, tokens.len) == 0) ||
+               (tokens.hash == HASH_ELSE && tokens.len == 4 &&
+                strncmp("else", tokens.text, tokens.len) == 0))
         {
-        /* fill the remainder of the buffer */
-        errno = 0;
-        tbuflen = r + FILE_BUFFER_SIZE;
-        while ((n = fread(&tbuf[r], 1, tbuflen-r, fp)) == 0 && ferror(fp))
-          {
-          if (errno != EINTR)
-            {
-            fclose(fp);
-            free(tbuf);
-            free(line);
-            info->IsExternal = save_external;
-            return VTK_PARSE_FILE_READ_ERROR;
-            }
-          errno = 0;
-          clearerr(fp);
-          }
-
-        if (n + r < tbuflen)
-          {
-          /* this only occurs if the final fread does not fill the buffer */
-          n += r;
-          r = 0;
-          }
-        else
+        if (depth == 1)
           {
-          /* set a lookahead reserve of two chars */
-          n -= (2 - r);
-          r = 2;
+          return NULL;
           }
-
-        /* guard against lookahead past last char in file */
-        tbuf[n + r] = '\0';
         }
+      else if (tokens.hash == HASH_ENDIF && tokens.len == 5 &&
+               strncmp("endif", tokens.text, tokens.len) == 0)
+        {
+        depth--;
+        }
+      }
+    if (depth <= 0 && i + 1 < n)
+      {
+      return NULL;
       }
+    text += strlen(text) + 1;
+    }
+
+  return (depth == 0 ? guard : NULL);
+}
+
+/**
+ * Read a file and keep all the preprocessor directives in it.  Each
+ * directive is a single logical line, i.e. with line continuations
+ * removed, and any comments that begin on that line are kept.
+ */
+static int preproc_read_file(
+  const char *path, PreprocessCachedFile **entryp)
+{
+  const char *switchchars = "\n\r\"\'\?\\/*()";
+  char switchchar[256];
+  FileBuffer contents;
+  char *tbuf;
+  char *line;
+  size_t linelen;
+  char *text;
+  size_t textlen = 0;
+  size_t textmaxlen = 1024;
+  size_t count = 0;
+  size_t first_content = 0;
+  size_t last_content = 0;
+  int has_content = 0;
+  const char *cp;
+  size_t i, j, n;
+  size_t d = 0;
+  size_t dn = 0;
+  int state = 0;
+  int result;
+  FILE *fp = NULL;
+  PreprocessCachedFile *entry;
+
+#if PREPROC_DEBUG
+  fprintf(stderr, "including file %s\n", path);
+#endif
+  fp = fopen(path, "r");
+
+  if (fp == NULL)
+    {
+#if PREPROC_DEBUG
+    fprintf(stderr, "couldn't open file %s\n", path);
+#endif
+    return VTK_PARSE_FILE_OPEN_ERROR;
+    }
+
+  /* read or map the whole file, with nulls for safe lookahead */
+  result = vtkParsePreprocess_LoadFile(&contents, fp, 2);
+  fclose(fp);
+  if (result != VTK_PARSE_OK)
+    {
+    return result;
+    }
 
+  /* make a table of interesting characters */
+  memset(switchchar, '\0', 256);
+  n = strlen(switchchars) + 1;
+  for (i = 0; i < n; i++)
+    {
+    switchchar[(unsigned char)(switchchars[i])] = 1;
+    }
+
+  /* no line can be longer than the file, unless raw strings expand */
+  tbuf = contents.Data;
+  n = contents.Size;
+  linelen = n + 8;
+  line = (char *)malloc(linelen);
+  text = (char *)malloc(textmaxlen);
+
+  /* walk through the file one line at a time */
+  j = 0;
+  i = 0;
+
+  do
+    {
     /* copy the characters until end of line is found */
     while (i < n)
       {
@@ -2127,23 +2628,163 @@ static int preproc_include_file(
         }
       }
 
-    if (i < n || n == 0)
+    /* check whether the line is a directive */
+    cp = line;
+    line[j] = '\0';
+    cp += vtkParse_SkipWhitespace(cp, WS_PREPROC);
+    if (*cp == '#')
       {
-      const char *cp = line;
-      line[j] = '\0';
-      j = 0;
-      cp += vtkParse_SkipWhitespace(cp, WS_PREPROC);
-      if (*cp == '#')
+      /* keep the directive, including its terminating null */
+      while (textlen + j + 1 > textmaxlen)
+        {
+        textmaxlen *= 2;
+        text = (char *)realloc(text, textmaxlen);
+        }
+      memcpy(&text[textlen], line, j + 1);
+      textlen += j + 1;
+      count++;
+      }
+    else if (line[vtkParse_SkipWhitespace(line, WS_DEFAULT)] != '\0')
+      {
+      /* note where code appears, for include guard detection */
+      if (!has_content)
         {
-        vtkParsePreprocess_HandleDirective(info, line);
+        first_content = count;
+        has_content = 1;
         }
+      last_content = count;
       }
+    j = 0;
     }
-  while (n > 0);
+  while (i < n);
 
-  free(tbuf);
+  vtkParsePreprocess_UnloadFile(&contents);
   free(line);
-  fclose(fp);
+
+  entry = (PreprocessCachedFile *)malloc(sizeof(PreprocessCachedFile));
+  entry->Path = strcpy((char *)malloc(strlen(path) + 1), path);
+  entry->Hash = preproc_hash_path(path);
+  entry->Directives = (char *)realloc(text, textlen + 1);
+  entry->NumberOfDirectives = count;
+  entry->Guard = NULL;
+  entry->Next = NULL;
+
+  /* there can be no code outside of an include guard */
+  if (!has_content || (first_content > 0 && last_content < count))
+    {
+    entry->Guard = preproc_find_guard(entry->Directives, count);
+    }
+  *entryp = entry;
+
+  return VTK_PARSE_OK;
+}
+
+/**
+ * Include a file.  All macros defined in the included file
+ * will have their IsExternal flag set.
+ */
+static int preproc_include_file(
+  PreprocessInfo *info, const char *filename, int system_first)
+{
+  PreprocessCachedFile *entry;
+  const char *path = NULL;
+  const char *save_filename;
+  const char *cp;
+  int save_external;
+  int result = VTK_PARSE_OK;
+  size_t i;
+
+  /* if this spelling was seen before, the search can be skipped */
+  entry = preproc_find_spelling(info, filename, system_first);
+  if (entry == NULL)
+    {
+    /* check to see if the file has aleady been included */
+    path = preproc_find_include_file(info, filename, system_first, 1);
+    if (path != 0)
+      {
+#if PREPROC_DEBUG
+      int k = 0;
+      while (filename[k] != '>' && filename[k] != '\"' &&
+             filename[k] != '\n' && filename[k] != '\0') { k++; }
+      if (filename[k] == '>')
+        fprintf(stderr, "already loaded file <%*.*s>\n", k, k, filename);
+      else
+        fprintf(stderr, "already loaded file \"%*.*s\"\n", k, k, filename);
+#endif
+
+      return VTK_PARSE_OK;
+      }
+    /* go to the filesystem */
+    path = preproc_find_include_file(info, filename, system_first, 0);
+    if (path == NULL)
+      {
+#if PREPROC_DEBUG
+      int k = 0;
+      while (filename[k] != '>' && filename[k] != '\"' &&
+             filename[k] != '\n' && filename[k] != '\0') { k++; }
+      if (filename[k] == '>')
+        fprintf(stderr, "couldn't find file <%*.*s>\n", k, k, filename);
+      else
+        fprintf(stderr, "couldn't find file \"%*.*s\"\n", k, k, filename);
+#endif
+      return VTK_PARSE_FILE_NOT_FOUND;
+      }
+
+    /* use the cached file, or read the file and add it to the cache */
+    entry = preproc_find_cached_file(path, preproc_hash_path(path));
+    if (entry == NULL)
+      {
+      result = preproc_read_file(path, &entry);
+      if (result != VTK_PARSE_OK)
+        {
+        return result;
+        }
+      entry = preproc_add_cached_file(entry);
+      }
+    preproc_add_spelling(info, filename, system_first, entry);
+    }
+
+  /* if the file has an include guard that is defined, skip it */
+  if (entry->Guard && vtkParsePreprocess_GetMacro(info, entry->Guard))
+    {
+#if PREPROC_DEBUG
+    fprintf(stderr, "skipping guarded file %s\n", entry->Path);
+#endif
+    /* the "#endif" of the guard would have set this */
+    info->ConditionalDone = 1;
+    return VTK_PARSE_OK;
+    }
+
+  /* for a known spelling, check whether the file was already included */
+  if (path == NULL)
+    {
+    if (info->FileName)
+      {
+      preproc_add_include_file(info, info->FileName);
+      }
+    if (!preproc_add_include_file(info, entry->Path))
+      {
+#if PREPROC_DEBUG
+      fprintf(stderr, "already loaded file %s\n", entry->Path);
+#endif
+      return VTK_PARSE_OK;
+      }
+    path = preproc_lookup_include_file(info, entry->Path);
+    }
+
+  save_external = info->IsExternal;
+  save_filename = info->FileName;
+  info->IsExternal = 1;
+  info->FileName = path;
+
+  /* replay the directives, the conditionals are evaluated anew because
+   * they depend on the macros that are defined at the point of inclusion */
+  cp = entry->Directives;
+  for (i = 0; i < entry->NumberOfDirectives; i++)
+    {
+    vtkParsePreprocess_HandleDirective(info, cp);
+    cp += strlen(cp) + 1;
+    }
 
   info->IsExternal = save_external;
   info->FileName = save_filename;
@@ -3161,6 +3802,11 @@ void vtkParsePreprocess_IncludeDirectory(
     info->NumberOfIncludeDirectories);
   info->IncludeDirectories[info->NumberOfIncludeDirectories++] =
     vtkParse_CacheString(info->Strings, name, strlen(name));
+
+  /* the include path is part of the key for the include spellings */
+  info->IncludeDirectoriesHash =
+    (info->IncludeDirectoriesHash << 5) + info->IncludeDirectoriesHash +
+    preproc_hash_path(name);
 }
 
 /**
@@ -3183,6 +3829,532 @@ const char *vtkParsePreprocess_FindIncludeFile(
   return preproc_find_include_file(info, filename, system_first, 0);
 }
 
+/**
+ * Read or map a whole file.
+ */
+int vtkParsePreprocess_LoadFile(FileBuffer *contents, FILE *fp, size_t pad)
+{
+  size_t size = 0;
+  size_t maxsize = FILE_BUFFER_SIZE;
+  size_t n;
+  char *data;
+#if !defined(_WIN32)
+  struct stat fs;
+  size_t pagesize;
+#endif
+
+  contents->Data = NULL;
+  contents->Size = 0;
+  contents->MapSize = 0;
+
+#if !defined(_WIN32)
+  /* map regular files that have not been read from yet, but only if
+   * the padding fits in the zero-filled remainder of the last page */
+  if (fstat(fileno(fp), &fs) == 0 && S_ISREG(fs.st_mode) &&
+      fs.st_size > 0 && ftell(fp) == 0)
+    {
+    pagesize = (size_t)sysconf(_SC_PAGESIZE);
+    size = (size_t)fs.st_size;
+    if (pad == 0 ||
+        (size % pagesize != 0 && pagesize - size % pagesize >= pad))
+      {
+      data = (char *)mmap(NULL, size + pad, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE, fileno(fp), 0);
+      if (data != (char *)MAP_FAILED)
+        {
+        contents->Data = data;
+        contents->Size = size;
+        contents->MapSize = size + pad;
+        return VTK_PARSE_OK;
+        }
+      }
+    maxsize = size + 1;
+    size = 0;
+    }
+#endif
+
+  /* read the file, the buffer is only resized if the size is unknown */
+  data = (char *)malloc(maxsize + pad);
+  for (;;)
+    {
+    if (size == maxsize)
+      {
+      maxsize *= 2;
+      data = (char *)realloc(data, maxsize + pad);
+      }
+    n = fread(&data[size], 1, maxsize - size, fp);
+    if (n == 0)
+      {
+      break;
+      }
+    size += n;
+    }
+
+  if (ferror(fp))
+    {
+    free(data);
+    return VTK_PARSE_FILE_READ_ERROR;
+    }
+
+  memset(&data[size], '\0', pad);
+  contents->Data = data;
+  contents->Size = size;
+
+  return VTK_PARSE_OK;
+}
+
+/**
+ * Release the memory for a file.
+ */
+void vtkParsePreprocess_UnloadFile(FileBuffer *contents)
+{
+#if !defined(_WIN32)
+  if (contents->MapSize != 0)
+    {
+    munmap(contents->Data, contents->MapSize);
+    }
+  else
+#endif
+    {
+    free(contents->Data);
+    }
+
+  contents->Data = NULL;
+  contents->Size = 0;
+  contents->MapSize = 0;
+}
+
+/**
+ * Write a 32-bit unsigned int in little-endian order.
+ */
+static void preproc_write_uint(FILE *fp, unsigned long val)
+{
+  unsigned char b[4];
+  b[0] = (unsigned char)(val & 0xff);
+  b[1] = (unsigned char)((val >> 8) & 0xff);
+  b[2] = (unsigned char)((val >> 16) & 0xff);
+  b[3] = (unsigned char)((val >> 24) & 0xff);
+  fwrite(b, 1, 4, fp);
+}
+
+/**
+ * Write a string, including the terminating null.
+ */
+static void preproc_write_string(FILE *fp, const char *cp)
+{
+  fwrite(cp, 1, strlen(cp) + 1, fp);
+}
+
+/**
+ * Read a 32-bit unsigned int, return zero if past the end.
+ */
+static int preproc_read_uint(
+  const char **cpp, const char *ep, unsigned long *val)
+{
+  const unsigned char *b = (const unsigned char *)(*cpp);
+
+  if (ep - *cpp < 4)
+    {
+    return 0;
+    }
+
+  *val = ((unsigned long)b[0] | ((unsigned long)b[1] << 8) |
+          ((unsigned long)b[2] << 16) | ((unsigned long)b[3] << 24));
+  *cpp += 4;
+  return 1;
+}
+
+/**
+ * Read a null-terminated string, return NULL if past the end.
+ */
+static const char *preproc_read_string(const char **cpp, const char *ep)
+{
+  const char *cp = *cpp;
+  const char *tp = (const char *)memchr(cp, '\0', ep - cp);
+
+  if (tp == NULL)
+    {
+    return NULL;
+    }
+
+  *cpp = tp + 1;
+  return cp;
+}
+
+/**
+ * Read the macros from the data in a macro file.  If "insert" is
+ * zero, then just check that the data is valid.
+ */
+static int preproc_read_macros(
+  PreprocessInfo *info, const char *cp, const char *ep,
+  unsigned long n, int insert)
+{
+  StringTokenizer token;
+  MacroInfo **macro_p;
+  MacroInfo *macro;
+  const char *name;
+  const char *definition;
+  const char *param;
+  unsigned long flags, m, i, j;
+
+  for (i = 0; i < n; i++)
+    {
+    if (!preproc_read_uint(&cp, ep, &flags) ||
+        !preproc_read_uint(&cp, ep, &m) ||
+        (name = preproc_read_string(&cp, ep)) == NULL ||
+        (definition = preproc_read_string(&cp, ep)) == NULL)
+      {
+      return 0;
+      }
+
+    macro = NULL;
+    if (insert)
+      {
+      macro = preproc_alloc_macro(info);
+      macro->Name = vtkParse_CacheString(info->Strings, name, strlen(name));
+      if ((flags & 0x10) != 0)
+        {
+        macro->Definition = vtkParse_CacheString(
+          info->Strings, definition, strlen(definition));
+        }
+      macro->IsFunction = ((flags & 0x01) != 0);
+      macro->IsVariadic = ((flags & 0x02) != 0);
+      macro->IsExternal = ((flags & 0x04) != 0);
+      macro->IsExcluded = ((flags & 0x08) != 0);
+      macro->NumberOfParameters = m;
+      if (m > 0)
+        {
+        macro->Parameters = (const char **)malloc(m*sizeof(const char *));
+        }
+      }
+
+    for (j = 0; j < m; j++)
+      {
+      if ((param = preproc_read_string(&cp, ep)) == NULL)
+        {
+        return 0;
+        }
+      if (macro)
+        {
+        macro->Parameters[j] = vtkParse_CacheString(
+          info->Strings, param, strlen(param));
+        }
+      }
+
+    if (macro)
+      {
+      vtkParse_InitTokenizer(&token, macro->Name, WS_PREPROC);
+      macro_p = preproc_macro_location(info, &token, 1);
+      if (*macro_p)
+        {
+        preproc_free_macro(info, macro);
+        }
+      else
+        {
+        *macro_p = macro;
+        }
+      }
+    }
+
+  return (cp == ep);
+}
+
+/**
+ * Get the stamp for macro files, which is a hash of the standard
+ * macros.  It is computed once per process.
+ */
+static const char *preproc_macro_stamp(void)
+{
+  static char stamp[32] = "";
+  PreprocessInfo *info;
+  StringCache strings;
+  MacroTable *table;
+  MacroInfo *macro;
+  const char *cp;
+  unsigned int h = 5381;
+  unsigned long i, n = 0;
+
+  vtkParseThreads_LockGlobal();
+  if (stamp[0] == '\0')
+    {
+    info = (PreprocessInfo *)malloc(sizeof(PreprocessInfo));
+    vtkParsePreprocess_Init(info, NULL);
+    vtkParse_InitStringCache(&strings);
+    info->Strings = &strings;
+    vtkParsePreprocess_AddStandardMacros(info, VTK_PARSE_NATIVE);
+
+    /* hash the names and definitions in hash table order */
+    table = info->MacroHashTable;
+    for (i = 0; table && i < table->Size; i++)
+      {
+      if ((macro = table->Entries[i].Macro) != NULL)
+        {
+        for (cp = macro->Name; *cp != '\0'; cp++)
+          {
+          h = (h << 5) + h + (unsigned char)*cp;
+          }
+        h = (h << 5) + h + '=';
+        for (cp = macro->Definition; cp && *cp != '\0'; cp++)
+          {
+          h = (h << 5) + h + (unsigned char)*cp;
+          }
+        h = (h << 5) + h + '\n';
+        n++;
+        }
+      }
+
+    vtkParsePreprocess_Free(info);
+    vtkParse_FreeStringCache(&strings);
+    sprintf(stamp, "%08x %lu", h, n);
+    }
+  vtkParseThreads_UnlockGlobal();
+
+  return stamp;
+}
+
+/**
+ * Write all macros to a file.
+ */
+int vtkParsePreprocess_WriteMacros(
+  PreprocessInfo *info, const char *filename, const char *key)
+{
+  MacroTable *table;
+  MacroInfo *macro;
+  char *tmpname;
+  const char *stamp;
+  FILE *fp;
+  unsigned long n = 0;
+  unsigned long i, j, flags;
+  int result = VTK_PARSE_OK;
+
+  /* get the stamp before the lock is taken, since it uses the lock */
+  stamp = preproc_macro_stamp();
+
+  /* write to a temporary file, and then rename it */
+  tmpname = (char *)malloc(strlen(filename) + 32);
+  sprintf(tmpname, "%s.%lu.tmp", filename, (unsigned long)getpid());
+
+  /* the global lock keeps our threads from using the same tmpname */
+  vtkParseThreads_LockGlobal();
+
+  fp = fopen(tmpname, "wb");
+  if (fp == NULL)
+    {
+    vtkParseThreads_UnlockGlobal();
+    free(tmpname);
+    return VTK_PARSE_FILE_OPEN_ERROR;
+    }
+
+  table = info->MacroHashTable;
+  for (i = 0; table && i < table->Size; i++)
+    {
+    if (table->Entries[i].Macro)
+      {
+      n++;
+      }
+    }
+
+  fwrite(PREPROC_MACRO_FILE_MAGIC, 1, 8, fp);
+  preproc_write_string(fp, stamp);
+  preproc_write_string(fp, key);
+  preproc_write_uint(fp, n);
+
+  /* write the macros in hash table order */
+  for (i = 0; table && i < table->Size; i++)
+    {
+    if ((macro = table->Entries[i].Macro) != NULL)
+      {
+      flags = ((macro->IsFunction ? 0x01 : 0) |
+               (macro->IsVariadic ? 0x02 : 0) |
+               (macro->IsExternal ? 0x04 : 0) |
+               (macro->IsExcluded ? 0x08 : 0) |
+               (macro->Definition ? 0x10 : 0));
+      preproc_write_uint(fp, flags);
+      preproc_write_uint(fp, macro->NumberOfParameters);
+      preproc_write_string(fp, macro->Name);
+      preproc_write_string(fp, (macro->Definition ? macro->Definition : ""));
+      for (j = 0; j < macro->NumberOfParameters; j++)
+        {
+        preproc_write_string(fp, macro->Parameters[j]);
+        }
+      }
+    }
+
+  if (ferror(fp))
+    {
+    result = VTK_PARSE_FILE_READ_ERROR;
+    }
+  if (fclose(fp) != 0 || result != VTK_PARSE_OK)
+    {
+    remove(tmpname);
+    result = VTK_PARSE_FILE_OPEN_ERROR;
+    }
+  else if (rename(tmpname, filename) != 0)
+    {
+    /* on Windows, rename() will not replace an existing file */
+    remove(filename);
+    if (rename(tmpname, filename) != 0)
+      {
+      remove(tmpname);
+      result = VTK_PARSE_FILE_OPEN_ERROR;
+      }
+    }
+
+  vtkParseThreads_UnlockGlobal();
+  free(tmpname);
+
+  return result;
+}
+
+/**
+ * Read the macros that were written by WriteMacros.
+ */
+int vtkParsePreprocess_ReadMacros(
+  PreprocessInfo *info, const char *filename, const char *key)
+{
+  FILE *fp;
+  char *buf;
+  const char *cp;
+  const char *ep;
+  const char *stamp;
+  const char *filekey;
+  unsigned long n;
+  long size;
+  int result = VTK_PARSE_FILE_READ_ERROR;
+
+  fp = fopen(filename, "rb");
+  if (fp == NULL)
+    {
+    return VTK_PARSE_FILE_OPEN_ERROR;
+    }
+
+  /* read the whole file at once */
+  if (fseek(fp, 0, SEEK_END) != 0 || (size = ftell(fp)) < 8 ||
+      fseek(fp, 0, SEEK_SET) != 0)
+    {
+    fclose(fp);
+    return VTK_PARSE_FILE_READ_ERROR;
+    }
+  buf = (char *)malloc(size);
+  if (fread(buf, 1, size, fp) != (size_t)size)
+    {
+    fclose(fp);
+    free(buf);
+    return VTK_PARSE_FILE_READ_ERROR;
+    }
+  fclose(fp);
+
+  /* check the header, then check the macros before adding them */
+  cp = buf + 8;
+  ep = buf + size;
+  if (memcmp(buf, PREPROC_MACRO_FILE_MAGIC, 8) == 0 &&
+      (stamp = preproc_read_string(&cp, ep)) != NULL &&
+      strcmp(stamp, preproc_macro_stamp()) == 0 &&
+      (filekey = preproc_read_string(&cp, ep)) != NULL &&
+      strcmp(filekey, key) == 0 &&
+      preproc_read_uint(&cp, ep, &n) &&
+      preproc_read_macros(info, cp, ep, n, 0))
+    {
+    preproc_read_macros(info, cp, ep, n, 1);
+    result = VTK_PARSE_OK;
+    }
+
+  free(buf);
+
+  return result;
+}
+
+/**
+ * Copy all of the macros from another preprocessor.
+ */
+void vtkParsePreprocess_CopyMacros(
+  PreprocessInfo *info, const PreprocessInfo *source)
+{
+  const MacroTable *table = source->MacroHashTable;
+  MacroTable *newtable = NULL;
+  MacroInfo *macro;
+  MacroInfo *newmacro;
+  MacroInfo **macro_p;
+  StringTokenizer token;
+  const char **params;
+  unsigned long i, j;
+
+  if (table == NULL)
+    {
+    return;
+    }
+
+  /* if there are no macros yet, the hash table is copied as-is */
+  if (info->MacroHashTable == NULL)
+    {
+    newtable = preproc_macro_table(info);
+    if (newtable->Size != table->Size)
+      {
+      free(newtable->Entries);
+      newtable->Size = table->Size;
+      newtable->Entries = (MacroHashEntry *)malloc(
+        newtable->Size*sizeof(MacroHashEntry));
+      memset(newtable->Entries, 0, newtable->Size*sizeof(MacroHashEntry));
+      }
+    }
+
+  for (i = 0; i < table->Size; i++)
+    {
+    if ((macro = table->Entries[i].Macro) == NULL)
+      {
+      continue;
+      }
+
+    newmacro = preproc_alloc_macro(info);
+    newmacro->Name = vtkParse_CacheString(
+      info->Strings, macro->Name, strlen(macro->Name));
+    if (macro->Definition)
+      {
+      newmacro->Definition = vtkParse_CacheString(
+        info->Strings, macro->Definition, strlen(macro->Definition));
+      }
+    if (macro->Comment)
+      {
+      newmacro->Comment = vtkParse_CacheString(
+        info->Strings, macro->Comment, strlen(macro->Comment));
+      }
+    if (macro->NumberOfParameters > 0)
+      {
+      params = (const char **)malloc(
+        macro->NumberOfParameters*sizeof(const char *));
+      for (j = 0; j < macro->NumberOfParameters; j++)
+        {
+        params[j] = vtkParse_CacheString(
+          info->Strings, macro->Parameters[j],
+          strlen(macro->Parameters[j]));
+        }
+      newmacro->NumberOfParameters = macro->NumberOfParameters;
+      newmacro->Parameters = params;
+      }
+    newmacro->IsFunction = macro->IsFunction;
+    newmacro->IsVariadic = macro->IsVariadic;
+    newmacro->IsExternal = macro->IsExternal;
+    newmacro->IsExcluded = macro->IsExcluded;
+
+    if (newtable)
+      {
+      newtable->Entries[i].Hash = table->Entries[i].Hash;
+      newtable->Entries[i].Macro = newmacro;
+      newtable->Count++;
+      }
+    else
+      {
+      vtkParse_InitTokenizer(&token, newmacro->Name, WS_PREPROC);
+      macro_p = preproc_macro_location(info, &token, 1);
+      if (*macro_p)
+        {
+        preproc_free_macro(info, *macro_p);
+        }
+      *macro_p = newmacro;
+      }
+    }
+}
+
 /**
  * Initialize a preprocessor macro struct
  */
@@ -3219,8 +4391,10 @@ void vtkParsePreprocess_Init(
   info->MacroHashTable = NULL;
   info->NumberOfIncludeDirectories = 0;
   info->IncludeDirectories = NULL;
+  info->IncludeDirectoriesHash = 5381;
   info->NumberOfIncludeFiles = 0;
   info->IncludeFiles = NULL;
+  info->IncludeFileHashTable = NULL;
   info->Strings = NULL;
   info->IsExternal = 0;
   info->ConditionalDepth = 0;
@@ -3239,31 +4413,33 @@ void vtkParsePreprocess_Init(
  */
 void vtkParsePreprocess_Free(PreprocessInfo *info)
 {
-  unsigned long i, n;
-  MacroInfo **mptr;
+  MacroTable *table = info->MacroHashTable;
+  unsigned long i;
 
   free((char *)info->FileName);
 
-  if (info->MacroHashTable)
+  if (table)
     {
-    n = PREPROC_HASH_TABLE_SIZE;
-    for (i = 0; i < n; i++)
+    for (i = 0; i < table->Size; i++)
       {
-      mptr = info->MacroHashTable[i];
-      if (mptr)
+      if (table->Entries[i].Macro)
         {
-        while (*mptr)
-          {
-          vtkParsePreprocess_FreeMacro(*mptr++);
-          }
+        free((char **)table->Entries[i].Macro->Parameters);
         }
-      free(info->MacroHashTable[i]);
       }
-    free(info->MacroHashTable);
+    for (i = 0; i < table->NumberOfChunks; i++)
+      {
+      free(table->Chunks[i]);
+      }
+    free(table->Chunks);
+    free(table->FreeMacros);
+    free(table->Entries);
+    free(table);
     }
 
   free((char **)info->IncludeDirectories);
   free((char **)info->IncludeFiles);
+  free((char **)info->IncludeFileHashTable);
 
   free(info);
 }
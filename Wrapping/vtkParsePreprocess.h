@@ -31,12 +31,24 @@
   lookup error occurred, and will also let the parser know
   if an #if or #else directive requires that the next block
   of code be skipped.
+
+  Header files that are included via #include are only read
+  once per process.  The directives in each header file are
+  kept in a cache that is shared by all threads, and if the
+  file is included again, even by a different PreprocessInfo,
+  then the cached directives are evaluated instead of reading
+  the file again.  The file that was found for each #include is
+  also kept, so that a later #include with the same spelling, from
+  the same directory and with the same include path, needs no search.
+  If the file has an include guard, and the guard macro is already
+  defined, then the file is skipped without any filesystem access.
 */
 
 #ifndef VTK_PARSE_PREPROCESS_H
 #define VTK_PARSE_PREPROCESS_H
 
 #include "vtkParseString.h"
+#include <stdio.h>
 
 /**
  * The preprocessor int type.  Use the compiler's longest int type.
@@ -65,6 +77,21 @@ typedef struct _MacroInfo
   int            IsExcluded; /* do not expand this macro */
 } MacroInfo;
 
+/**
+ * The contents of a file that was loaded into memory.
+ */
+typedef struct _FileBuffer
+{
+  char          *Data;     /* the contents, followed by null padding */
+  size_t         Size;     /* the size of the contents */
+  size_t         MapSize;  /* the size of the mapping, if mapped */
+} FileBuffer;
+
+/**
+ * The hash table for macro lookup, which is opaque.
+ */
+typedef struct _MacroTable MacroTable;
+
 /**
  * Contains all symbols defined thus far (including those defined
  * in any included header files).
@@ -72,11 +99,13 @@ typedef struct _MacroInfo
 typedef struct _PreprocessInfo
 {
   const char    *FileName;         /* the file that is being parsed */
-  MacroInfo   ***MacroHashTable;   /* hash table for macro lookup */
+  MacroTable    *MacroHashTable;   /* hash table for macro lookup */
   unsigned long  NumberOfIncludeDirectories;
   const char   **IncludeDirectories;
+  unsigned int   IncludeDirectoriesHash; /* identifies the include path */
   unsigned long  NumberOfIncludeFiles; /* all included files */
   const char   **IncludeFiles;
+  const char   **IncludeFileHashTable; /* hash table for IncludeFiles */
   StringCache   *Strings;          /* to aid string allocation */
   int            IsExternal;       /* label all macros as "external" */
   int            ConditionalDepth; /* internal state variable */
@@ -226,6 +255,51 @@ const char *vtkParsePreprocess_FindIncludeFile(
   PreprocessInfo *info, const char *filename, int system_first,
   int *already_loaded);
 
+/**
+ * Write all of the macros to a binary file, so that a later process
+ * can read them with vtkParsePreprocess_ReadMacros() instead of
+ * defining them again.  The key should describe the options that
+ * were used to define the macros.  The file is written to a temporary
+ * file that is renamed when complete, so that other processes never
+ * read a partial file.  Return values are VTK_PARSE_OK and
+ * VTK_PARSE_FILE_OPEN_ERROR.
+ */
+int vtkParsePreprocess_WriteMacros(
+  PreprocessInfo *info, const char *filename, const char *key);
+
+/**
+ * Read the macros from a file that was written by
+ * vtkParsePreprocess_WriteMacros().  If the file was written with a
+ * different key, or by a tool with different standard macros, then
+ * no macros are added and VTK_PARSE_FILE_READ_ERROR is returned.
+ * Return values are VTK_PARSE_OK, VTK_PARSE_FILE_OPEN_ERROR, and
+ * VTK_PARSE_FILE_READ_ERROR.
+ */
+int vtkParsePreprocess_ReadMacros(
+  PreprocessInfo *info, const char *filename, const char *key);
+
+/**
+ * Copy all of the macros from another preprocessor, so that the
+ * macros can be defined once and then used for many files.  The
+ * strings are copied into the StringCache of "info".
+ */
+void vtkParsePreprocess_CopyMacros(
+  PreprocessInfo *info, const PreprocessInfo *source);
+
+/**
+ * Load the rest of a file into memory, followed by "pad" null bytes.
+ * The memory is writable, and if possible the file is memory-mapped
+ * instead of being read.  The FILE can be closed after this is called.
+ * Return values are VTK_PARSE_OK and VTK_PARSE_FILE_READ_ERROR.
+ */
+int vtkParsePreprocess_LoadFile(
+  FileBuffer *contents, FILE *fp, size_t pad);
+
+/**
+ * Free the memory for a file that was loaded.
+ */
+void vtkParsePreprocess_UnloadFile(FileBuffer *contents);
+
 /**
  * Initialize a preprocessor symbol struct.
  */
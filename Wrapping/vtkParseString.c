@@ -16,6 +16,52 @@
 #include <stdlib.h>
 #include <string.h>
 
+/* SSE2 is always available on x86_64, and AVX2 is used if the compiler
+ * can build code for it and the CPU supports it at run time */
+#if !defined(VTK_PARSE_NO_SIMD)
+# if defined(__SSE2__) || defined(_M_X64) || \
+     (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define PARSE_USE_SSE2
+#  include <emmintrin.h>
+# endif
+# if (defined(__x86_64__) || defined(__i386__)) && \
+     (defined(__clang__) || __GNUC__ > 4 || \
+      (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#  define PARSE_USE_AVX2
+#  include <immintrin.h>
+# endif
+#endif
+
+/* the SIMD loops use aligned loads, which never cross a page boundary
+ * but can read past the end of a string, so the sanitizers must not
+ * check them */
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+# define PARSE_NO_SANITIZE \
+  __attribute__((no_sanitize_address, no_sanitize_thread))
+#elif defined(__has_feature)
+# if __has_feature(address_sanitizer) || __has_feature(thread_sanitizer)
+#  define PARSE_NO_SANITIZE \
+  __attribute__((no_sanitize("address", "thread")))
+# endif
+#endif
+#ifndef PARSE_NO_SANITIZE
+# define PARSE_NO_SANITIZE
+#endif
+
+#if defined(PARSE_USE_SSE2) || defined(PARSE_USE_AVX2)
+# if defined(_MSC_VER)
+#  include <intrin.h>
+static unsigned int parse_ctz(unsigned int x)
+{
+  unsigned long i;
+  _BitScanForward(&i, x);
+  return i;
+}
+# else
+#  define parse_ctz(x) ((unsigned int)__builtin_ctz(x))
+# endif
+#endif
+
 
 /*----------------------------------------------------------------
  * String tokenization methods
@@ -77,6 +123,282 @@ unsigned char parse_charbits[256] = {
 #define parse_chartype(c, bits) \
   ((parse_charbits[(unsigned char)(c)] & (bits)) != 0)
 
+/*----------------------------------------------------------------
+ * Fast scanning
+ *
+ * These find the next char of interest 16 or 32 bytes at a time.
+ * Each load is aligned, and the bits for the bytes that precede
+ * the starting point are masked off.  The char classes must match
+ * parse_charbits exactly.
+ */
+
+#if defined(PARSE_USE_SSE2)
+
+/* Set bytes in "v" that are within the range [lo,hi] */
+#define parse_sse2_range(v, lo, hi) \
+  _mm_cmpgt_epi8(_mm_set1_epi8((char)(0x80 + (hi) - (lo) + 1)), \
+                 _mm_add_epi8((v), _mm_set1_epi8((char)(0x80 - (lo)))))
+
+/* Find the first c1, c2, c3, or null */
+PARSE_NO_SANITIZE
+static const char *parse_sse2_find_char(
+  const char *cp, char c1, char c2, char c3)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i v1 = _mm_set1_epi8(c1);
+  const __m128i v2 = _mm_set1_epi8(c2);
+  const __m128i v3 = _mm_set1_epi8(c3);
+  const char *p = (const char *)((size_t)cp & ~(size_t)15);
+  unsigned int mask = (0xFFFFu << (cp - p)) & 0xFFFFu;
+  __m128i v, m;
+
+  for (;;)
+    {
+    v = _mm_load_si128((const __m128i *)p);
+    m = _mm_or_si128(
+      _mm_or_si128(_mm_cmpeq_epi8(v, zero), _mm_cmpeq_epi8(v, v1)),
+      _mm_or_si128(_mm_cmpeq_epi8(v, v2), _mm_cmpeq_epi8(v, v3)));
+    mask &= (unsigned int)_mm_movemask_epi8(m);
+    if (mask != 0)
+      {
+      return p + parse_ctz(mask);
+      }
+    mask = 0xFFFFu;
+    p += 16;
+    }
+}
+
+/* Find the first char that is not CPRE_XID */
+PARSE_NO_SANITIZE
+static const char *parse_sse2_skip_xid(const char *cp)
+{
+  const __m128i lower = _mm_set1_epi8(0x20);
+  const __m128i under = _mm_set1_epi8('_');
+  const char *p = (const char *)((size_t)cp & ~(size_t)15);
+  unsigned int mask = (0xFFFFu << (cp - p)) & 0xFFFFu;
+  __m128i v, m;
+
+  for (;;)
+    {
+    v = _mm_load_si128((const __m128i *)p);
+    m = _mm_or_si128(
+      _mm_or_si128(parse_sse2_range(_mm_or_si128(v, lower), 'a', 'z'),
+                   parse_sse2_range(v, '0', '9')),
+      _mm_or_si128(_mm_cmpeq_epi8(v, under),
+                   parse_sse2_range(v, 0x80, 0x9F)));
+    mask &= ~(unsigned int)_mm_movemask_epi8(m);
+    if (mask != 0)
+      {
+      return p + parse_ctz(mask);
+      }
+    mask = 0xFFFFu;
+    p += 16;
+    }
+}
+
+/* Find the first char that is not CPRE_HSPACE, or not CPRE_WHITE */
+PARSE_NO_SANITIZE
+static const char *parse_sse2_skip_space(const char *cp, int vspace)
+{
+  const __m128i tab = _mm_set1_epi8('\t');
+  const __m128i cr = _mm_set1_epi8('\r');
+  const __m128i space = _mm_set1_epi8(' ');
+  const char *p = (const char *)((size_t)cp & ~(size_t)15);
+  unsigned int mask = (0xFFFFu << (cp - p)) & 0xFFFFu;
+  __m128i v, m;
+
+  for (;;)
+    {
+    v = _mm_load_si128((const __m128i *)p);
+    if (vspace)
+      {
+      m = _mm_or_si128(parse_sse2_range(v, '\t', '\r'),
+                       _mm_cmpeq_epi8(v, space));
+      }
+    else
+      {
+      m = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(v, tab), _mm_cmpeq_epi8(v, cr)),
+        _mm_cmpeq_epi8(v, space));
+      }
+    mask &= ~(unsigned int)_mm_movemask_epi8(m);
+    if (mask != 0)
+      {
+      return p + parse_ctz(mask);
+      }
+    mask = 0xFFFFu;
+    p += 16;
+    }
+}
+
+#endif /* PARSE_USE_SSE2 */
+
+#if defined(PARSE_USE_AVX2)
+
+#define PARSE_TARGET_AVX2 __attribute__((target("avx2")))
+
+/* Set bytes in "v" that are within the range [lo,hi] */
+#define parse_avx2_range(v, lo, hi) \
+  _mm256_cmpgt_epi8( \
+    _mm256_set1_epi8((char)(0x80 + (hi) - (lo) + 1)), \
+    _mm256_add_epi8((v), _mm256_set1_epi8((char)(0x80 - (lo)))))
+
+/* Find the first c1, c2, c3, or null */
+PARSE_TARGET_AVX2 PARSE_NO_SANITIZE
+static const char *parse_avx2_find_char(
+  const char *cp, char c1, char c2, char c3)
+{
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i v1 = _mm256_set1_epi8(c1);
+  const __m256i v2 = _mm256_set1_epi8(c2);
+  const __m256i v3 = _mm256_set1_epi8(c3);
+  const char *p = (const char *)((size_t)cp & ~(size_t)31);
+  unsigned int mask = 0xFFFFFFFFu << (cp - p);
+  __m256i v, m;
+
+  for (;;)
+    {
+    v = _mm256_load_si256((const __m256i *)p);
+    m = _mm256_or_si256(
+      _mm256_or_si256(_mm256_cmpeq_epi8(v, zero), _mm256_cmpeq_epi8(v, v1)),
+      _mm256_or_si256(_mm256_cmpeq_epi8(v, v2), _mm256_cmpeq_epi8(v, v3)));
+    mask &= (unsigned int)_mm256_movemask_epi8(m);
+    if (mask != 0)
+      {
+      return p + parse_ctz(mask);
+      }
+    mask = 0xFFFFFFFFu;
+    p += 32;
+    }
+}
+
+/* Find the first char that is not CPRE_XID */
+PARSE_TARGET_AVX2 PARSE_NO_SANITIZE
+static const char *parse_avx2_skip_xid(const char *cp)
+{
+  const __m256i lower = _mm256_set1_epi8(0x20);
+  const __m256i under = _mm256_set1_epi8('_');
+  const char *p = (const char *)((size_t)cp & ~(size_t)31);
+  unsigned int mask = 0xFFFFFFFFu << (cp - p);
+  __m256i v, m;
+
+  for (;;)
+    {
+    v = _mm256_load_si256((const __m256i *)p);
+    m = _mm256_or_si256(
+      _mm256_or_si256(
+        parse_avx2_range(_mm256_or_si256(v, lower), 'a', 'z'),
+        parse_avx2_range(v, '0', '9')),
+      _mm256_or_si256(_mm256_cmpeq_epi8(v, under),
+                      parse_avx2_range(v, 0x80, 0x9F)));
+    mask &= ~(unsigned int)_mm256_movemask_epi8(m);
+    if (mask != 0)
+      {
+      return p + parse_ctz(mask);
+      }
+    mask = 0xFFFFFFFFu;
+    p += 32;
+    }
+}
+
+/* Find the first char that is not CPRE_HSPACE, or not CPRE_WHITE */
+PARSE_TARGET_AVX2 PARSE_NO_SANITIZE
+static const char *parse_avx2_skip_space(const char *cp, int vspace)
+{
+  const __m256i tab = _mm256_set1_epi8('\t');
+  const __m256i cr = _mm256_set1_epi8('\r');
+  const __m256i space = _mm256_set1_epi8(' ');
+  const char *p = (const char *)((size_t)cp & ~(size_t)31);
+  unsigned int mask = 0xFFFFFFFFu << (cp - p);
+  __m256i v, m;
+
+  for (;;)
+    {
+    v = _mm256_load_si256((const __m256i *)p);
+    if (vspace)
+      {
+      m = _mm256_or_si256(parse_avx2_range(v, '\t', '\r'),
+                          _mm256_cmpeq_epi8(v, space));
+      }
+    else
+      {
+      m = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, tab), _mm256_cmpeq_epi8(v, cr)),
+        _mm256_cmpeq_epi8(v, space));
+      }
+    mask &= ~(unsigned int)_mm256_movemask_epi8(m);
+    if (mask != 0)
+      {
+      return p + parse_ctz(mask);
+      }
+    mask = 0xFFFFFFFFu;
+    p += 32;
+    }
+}
+
+#endif /* PARSE_USE_AVX2 */
+
+/* Find the first c1, c2, c3, or null */
+static const char *parse_find_char(
+  const char *cp, char c1, char c2, char c3)
+{
+#if defined(PARSE_USE_AVX2)
+  if (__builtin_cpu_supports("avx2"))
+    {
+    return parse_avx2_find_char(cp, c1, c2, c3);
+    }
+#endif
+#if defined(PARSE_USE_SSE2)
+  return parse_sse2_find_char(cp, c1, c2, c3);
+#else
+  while (*cp != c1 && *cp != c2 && *cp != c3 && *cp != '\0')
+    {
+    cp++;
+    }
+  return cp;
+#endif
+}
+
+/* Find the first char that is not CPRE_XID */
+static const char *parse_skip_xid(const char *cp)
+{
+#if defined(PARSE_USE_AVX2)
+  if (__builtin_cpu_supports("avx2"))
+    {
+    return parse_avx2_skip_xid(cp);
+    }
+#endif
+#if defined(PARSE_USE_SSE2)
+  return parse_sse2_skip_xid(cp);
+#else
+  while (parse_chartype(*cp, CPRE_XID))
+    {
+    cp++;
+    }
+  return cp;
+#endif
+}
+
+/* Find the first char that is not of the given space type */
+static const char *parse_skip_space(const char *cp, parse_space_t spacetype)
+{
+#if defined(PARSE_USE_AVX2)
+  if (__builtin_cpu_supports("avx2"))
+    {
+    return parse_avx2_skip_space(cp, (spacetype & CPRE_VSPACE) != 0);
+    }
+#endif
+#if defined(PARSE_USE_SSE2)
+  return parse_sse2_skip_space(cp, (spacetype & CPRE_VSPACE) != 0);
+#else
+  while (parse_chartype(*cp, spacetype))
+    {
+    cp++;
+    }
+  return cp;
+#endif
+}
+
 /** Skip over a comment. */
 size_t vtkParse_SkipComment(const char *text)
 {
@@ -87,22 +409,23 @@ size_t vtkParse_SkipComment(const char *text)
     if (cp[1] == '/')
       {
       cp += 2;
-      while (*cp != '\n' && *cp != '\0')
+      for (;;)
         {
-        if (cp[0] == '\\')
-          {
-          if (cp[1] == '\n') { cp++; }
-          else if (cp[1] == '\r' && cp[2] == '\n') { cp += 2; }
-          }
+        cp = parse_find_char(cp, '\n', '\\', '\\');
+        if (cp[0] != '\\') { break; }
+        if (cp[1] == '\n') { cp++; }
+        else if (cp[1] == '\r' && cp[2] == '\n') { cp += 2; }
         cp++;
         }
       }
     else if (cp[1] == '*')
       {
       cp += 2;
-      while (*cp != '\0')
+      for (;;)
         {
-        if (cp[0] == '*' && cp[1] == '/') { cp += 2; break; }
+        cp = parse_find_char(cp, '*', '*', '*');
+        if (cp[0] == '\0') { break; }
+        if (cp[1] == '/') { cp += 2; break; }
         cp++;
         }
       }
@@ -120,11 +443,7 @@ size_t vtkParse_SkipWhitespace(const char *text, parse_space_t spacetype)
     {
     if (parse_chartype(*cp, spacetype))
       {
-      do
-        {
-        cp++;
-        }
-      while (parse_chartype(*cp, spacetype));
+      cp = parse_skip_space(cp + 1, spacetype);
       }
     if (cp[0] == '\\')
       {
@@ -170,13 +489,13 @@ size_t vtkParse_SkipQuotes(const char *text)
   if (parse_chartype(*cp, CPRE_QUOTE))
     {
     cp++;
-    while (*cp != qc && *cp != '\n' && *cp != '\0')
+    for (;;)
       {
-      if (*cp++ == '\\')
-        {
-        if (cp[0] == '\r' && cp[1] == '\n') { cp += 2; }
-        else if (*cp != '\0') { cp++; }
-        }
+      cp = parse_find_char(cp, qc, '\n', '\\');
+      if (*cp != '\\') { break; }
+      cp++;
+      if (cp[0] == '\r' && cp[1] == '\n') { cp += 2; }
+      else if (*cp != '\0') { cp++; }
       }
     }
   if (*cp == qc)
@@ -218,11 +537,7 @@ size_t vtkParse_SkipId(const char *text)
 
   if (parse_chartype(*cp, CPRE_ID))
     {
-    do
-      {
-      cp++;
-      }
-    while (parse_chartype(*cp, CPRE_XID));
+    cp = parse_skip_xid(cp + 1);
     }
 
   return cp - text;
@@ -520,13 +835,128 @@ void vtkParse_InitTokenizer(
  * generated by the parse have been freed.
  */
 
-/* allocate a string of n+1 bytes */
+/* The header that precedes each interned string, the size is a
+ * multiple of eight so that the string itself stays aligned */
+typedef struct _InternedStringHeader
+{
+  unsigned int Length;
+  unsigned int Hash;
+} InternedStringHeader;
+
+#define parse_interned_header(cp) \
+  ((const InternedStringHeader *)(cp) - 1)
+
+/* initialize the cache */
 void vtkParse_InitStringCache(StringCache *cache)
 {
   cache->NumberOfChunks = 0;
   cache->Chunks = NULL;
   cache->ChunkSize = 0;
   cache->Position = 0;
+  cache->NumberOfStrings = 0;
+  cache->HashTableSize = 0;
+  cache->HashTable = NULL;
+}
+
+/* initialize a cache that interns strings */
+void vtkParse_InitInternedStringCache(StringCache *cache)
+{
+  vtkParse_InitStringCache(cache);
+  cache->HashTableSize = 1024;
+  cache->HashTable = (const char **)calloc(1024, sizeof(const char *));
+}
+
+/* compute the hash for n chars of a string */
+static unsigned int parse_hash_string(const char *cp, size_t n)
+{
+  unsigned int h = 5381;
+  size_t i;
+
+  for (i = 0; i < n; i++)
+    {
+    h = ((h << 5) + h) ^ (unsigned char)cp[i];
+    }
+
+  return h;
+}
+
+/* find the slot for a string in the hash table */
+static const char **parse_find_interned(
+  const StringCache *cache, const char *cp, size_t n, unsigned int h)
+{
+  unsigned long m = cache->HashTableSize - 1;
+  unsigned long i = h & m;
+  const char **entry;
+  const InternedStringHeader *header;
+
+  for (;;)
+    {
+    entry = &cache->HashTable[i];
+    if (*entry == NULL)
+      {
+      return entry;
+      }
+    header = parse_interned_header(*entry);
+    if (header->Hash == h && header->Length == n &&
+        memcmp(*entry, cp, n) == 0)
+      {
+      return entry;
+      }
+    i = (i + 1) & m;
+    }
+}
+
+/* double the size of the hash table */
+static void parse_grow_interned(StringCache *cache)
+{
+  const char **oldtable = cache->HashTable;
+  unsigned long oldsize = cache->HashTableSize;
+  const InternedStringHeader *header;
+  unsigned long i;
+
+  cache->HashTableSize = 2*oldsize;
+  cache->HashTable = (const char **)calloc(
+    cache->HashTableSize, sizeof(const char *));
+
+  for (i = 0; i < oldsize; i++)
+    {
+    if (oldtable[i])
+      {
+      header = parse_interned_header(oldtable[i]);
+      *parse_find_interned(cache, oldtable[i], header->Length,
+                           header->Hash) = oldtable[i];
+      }
+    }
+
+  free((char **)oldtable);
+}
+
+/* check whether a string was interned by this cache */
+int vtkParse_IsInternedString(const StringCache *cache, const char *cp)
+{
+  size_t n;
+
+  if (cache->HashTableSize == 0 || cp == NULL)
+    {
+    return 0;
+    }
+
+  /* do not use the header, since the string might not have one */
+  n = strlen(cp);
+  return (*parse_find_interned(
+            cache, cp, n, parse_hash_string(cp, n)) == cp);
+}
+
+/* get the length of an interned string */
+size_t vtkParse_InternedStringLength(const char *cp)
+{
+  return parse_interned_header(cp)->Length;
+}
+
+/* get the hash of an interned string */
+unsigned int vtkParse_InternedStringHash(const char *cp)
+{
+  return parse_interned_header(cp)->Hash;
 }
 
 /* allocate a string of n+1 bytes */
@@ -590,15 +1020,60 @@ void vtkParse_FreeStringCache(StringCache *cache)
     {
     free(cache->Chunks);
     }
+  if (cache->HashTable)
+    {
+    free((char **)cache->HashTable);
+    }
 
   cache->Chunks = NULL;
   cache->NumberOfChunks = 0;
+  cache->NumberOfStrings = 0;
+  cache->HashTableSize = 0;
+  cache->HashTable = NULL;
 }
 
 /* duplicate the first n bytes of a string and terminate it */
 const char *vtkParse_CacheString(StringCache *cache, const char *in, size_t n)
 {
   char *res = NULL;
+  const char **entry;
+  const char *cp;
+  InternedStringHeader header;
+
+  if (cache->HashTableSize != 0 && in != NULL)
+    {
+    /* the string stops at the first null */
+    cp = (const char *)memchr(in, '\0', n);
+    if (cp)
+      {
+      n = cp - in;
+      }
+
+    /* return the existing copy, if there is one */
+    header.Length = (unsigned int)n;
+    header.Hash = parse_hash_string(in, n);
+    entry = parse_find_interned(cache, in, n, header.Hash);
+    if (*entry)
+      {
+      return *entry;
+      }
+
+    /* store the header just before the string */
+    res = vtkParse_NewString(cache, n + sizeof(InternedStringHeader));
+    memcpy(res, &header, sizeof(InternedStringHeader));
+    res += sizeof(InternedStringHeader);
+    memcpy(res, in, n);
+    res[n] = '\0';
+    *entry = res;
+
+    /* keep the table less than half full */
+    if (++cache->NumberOfStrings > cache->HashTableSize/2)
+      {
+      parse_grow_interned(cache);
+      }
+
+    return res;
+    }
 
   res = vtkParse_NewString(cache, n);
   strncpy(res, in, n);
@@ -31,6 +31,10 @@
   met by static strings, but dynamically-generated strings must be
   cached until the parse is complete.  The primary cacheing functions
   are vtkParse_CacheString() and vtkParse_FreeStringCache().
+
+  On x86 processors, comments, whitespace, quotes, and ids are skipped
+  with SSE2 or AVX2 instructions, depending on what the processor
+  supports.  Define VTK_PARSE_NO_SIMD to use plain C loops instead.
 */
 
 #ifndef VTK_PARSE_STRING_H
@@ -204,7 +208,9 @@ unsigned int vtkParse_DecodeUtf8(const char **cpp, int *error_flag);
 /**
  * StringCache provides a simple way of allocating strings centrally.
  * It eliminates the need to allocate and free each individual string,
- * which makes the code simpler and more efficient.
+ * which makes the code simpler and more efficient.  An interning cache
+ * also keeps a hash table of the strings from vtkParse_CacheString(),
+ * so that identical strings share the same memory.
  */
 typedef struct _StringCache
 {
@@ -212,6 +218,9 @@ typedef struct _StringCache
   char         **Chunks;
   size_t         ChunkSize;
   size_t         Position;
+  unsigned long  NumberOfStrings;  /* number of interned strings */
+  unsigned long  HashTableSize;    /* zero if cache does not intern */
+  const char   **HashTable;
 } StringCache;
 
 /**
@@ -219,6 +228,28 @@ typedef struct _StringCache
  */
 void vtkParse_InitStringCache(StringCache *cache);
 
+/**
+ * Initialize a string cache that interns the strings that are given to
+ * vtkParse_CacheString().  Two interned strings from the same cache are
+ * equal if and only if their pointers are equal.  Strings that are
+ * allocated with vtkParse_NewString() are never interned.
+ */
+void vtkParse_InitInternedStringCache(StringCache *cache);
+
+/**
+ * Check whether a string was interned by the given cache.  This is done
+ * with a hash table lookup, so it is not as cheap as it might seem.
+ */
+int vtkParse_IsInternedString(const StringCache *cache, const char *cp);
+
+/**
+ * Get the length or the hash of an interned string.  These values are
+ * stored alongside the string, so there is no need to compute them.
+ * The result is undefined if the string was not interned.
+ */
+size_t vtkParse_InternedStringLength(const char *cp);
+unsigned int vtkParse_InternedStringHash(const char *cp);
+
 /**
  * Alocate a new string from the cache.
  * A total of n+1 bytes will be allocated, to leave room for null.
@@ -230,6 +261,8 @@ char *vtkParse_NewString(StringCache *cache, size_t n);
  * structures.  The string will last until the application exits.
  * At most 'n' chars will be copied, and the string will be terminated.
  * If a null pointer is provided, then a null pointer will be returned.
+ * If the cache is an interning cache and an identical string has
+ * already been cached, then the existing string is returned.
  */
 const char *vtkParse_CacheString(
   StringCache *cache, const char *cp, size_t n);
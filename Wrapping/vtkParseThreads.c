@@ -0,0 +1,373 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkParseThreads.c
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#include "vtkParseThreads.h"
+#include "vtkParse.h"
+#include <stdlib.h>
+#include <stdio.h>
+
+#if defined(_WIN32)
+# include <windows.h>
+#elif !defined(VTK_PARSE_NO_THREADS)
+# include <pthread.h>
+# include <unistd.h>
+#endif
+
+/* the stack size for the worker threads */
+#define VTK_PARSE_THREAD_STACK_SIZE (8*1024*1024)
+
+/* The mutex is a thin wrapper around the native mutex */
+struct _vtkParseMutex
+{
+#if defined(_WIN32)
+  CRITICAL_SECTION Lock;
+#elif !defined(VTK_PARSE_NO_THREADS)
+  pthread_mutex_t Lock;
+#else
+  int Lock;
+#endif
+};
+
+/* The global mutex, which is statically initialized */
+#if defined(_WIN32)
+static SRWLOCK global_lock = SRWLOCK_INIT;
+#elif !defined(VTK_PARSE_NO_THREADS)
+static pthread_mutex_t global_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/* The jobs that were dealt to one worker.  The worker takes jobs from
+ * the front, and other workers steal jobs from the back. */
+typedef struct _WorkerQueue
+{
+  vtkParseMutex *Mutex;
+  int           *Jobs;
+  int            Front;
+  int            Back;
+} WorkerQueue;
+
+/* The pool of workers */
+typedef struct _WorkerPool
+{
+  int                   NumberOfWorkers;
+  WorkerQueue          *Queues;
+  vtkParseThreads_Func  Func;
+  void                 *Arg;
+} WorkerPool;
+
+/* The arg for each thread */
+typedef struct _WorkerInfo
+{
+  WorkerPool *Pool;
+  int         Index;
+} WorkerInfo;
+
+/* A job and its cost, for sorting */
+typedef struct _JobCost
+{
+  size_t Cost;
+  int    Job;
+} JobCost;
+
+/* Sort by decreasing cost, and then by index */
+static int job_compare(const void *vp1, const void *vp2)
+{
+  const JobCost *j1 = (const JobCost *)vp1;
+  const JobCost *j2 = (const JobCost *)vp2;
+
+  if (j1->Cost != j2->Cost)
+    {
+    return (j1->Cost > j2->Cost ? -1 : 1);
+    }
+
+  return (j1->Job < j2->Job ? -1 : (j1->Job > j2->Job ? 1 : 0));
+}
+
+/* Get the next job for a worker, or return -1 if there are none left */
+static int pool_next_job(WorkerPool *pool, int worker)
+{
+  WorkerQueue *queue;
+  int job = -1;
+  int i;
+
+  /* take a job from the front of our own queue */
+  queue = &pool->Queues[worker];
+  vtkParseThreads_Lock(queue->Mutex);
+  if (queue->Front < queue->Back)
+    {
+    job = queue->Jobs[queue->Front++];
+    }
+  vtkParseThreads_Unlock(queue->Mutex);
+
+  /* steal a job from the back of another queue */
+  for (i = 1; job < 0 && i < pool->NumberOfWorkers; i++)
+    {
+    queue = &pool->Queues[(worker + i) % pool->NumberOfWorkers];
+    vtkParseThreads_Lock(queue->Mutex);
+    if (queue->Front < queue->Back)
+      {
+      job = queue->Jobs[--queue->Back];
+      }
+    vtkParseThreads_Unlock(queue->Mutex);
+    }
+
+  return job;
+}
+
+/* Run jobs until there are none left */
+static void pool_work(WorkerPool *pool, int worker)
+{
+  int job;
+
+  while ((job = pool_next_job(pool, worker)) >= 0)
+    {
+    pool->Func(pool->Arg, worker, job);
+    }
+}
+
+/* The entry point for the threads */
+#if defined(_WIN32)
+static DWORD WINAPI pool_thread(LPVOID vp)
+{
+  WorkerInfo *info = (WorkerInfo *)vp;
+  pool_work(info->Pool, info->Index);
+  return 0;
+}
+#elif !defined(VTK_PARSE_NO_THREADS)
+static void *pool_thread(void *vp)
+{
+  WorkerInfo *info = (WorkerInfo *)vp;
+  pool_work(info->Pool, info->Index);
+  return NULL;
+}
+#endif
+
+/* Get the number of processors */
+int vtkParseThreads_NumberOfProcessors()
+{
+  int n = 1;
+
+#if defined(_WIN32)
+  SYSTEM_INFO sysinfo;
+  GetSystemInfo(&sysinfo);
+  n = (int)sysinfo.dwNumberOfProcessors;
+#elif !defined(VTK_PARSE_NO_THREADS) && defined(_SC_NPROCESSORS_ONLN)
+  n = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+  return (n > 0 ? n : 1);
+}
+
+/* Get the number of workers for the jobs */
+int vtkParseThreads_NumberOfWorkers(int nthreads, int njobs)
+{
+  if (nthreads <= 0)
+    {
+    nthreads = vtkParseThreads_NumberOfProcessors();
+    }
+  if (nthreads > njobs)
+    {
+    nthreads = njobs;
+    }
+#if defined(VTK_PARSE_NO_THREADS)
+  nthreads = 1;
+#endif
+
+  return (nthreads > 0 ? nthreads : 1);
+}
+
+/* Run the jobs with a pool of threads */
+void vtkParseThreads_Run(
+  int nthreads, int njobs, const size_t *costs,
+  vtkParseThreads_Func func, void *arg)
+{
+  WorkerPool pool;
+  WorkerInfo *info;
+  JobCost *order;
+  int i;
+#if defined(_WIN32)
+  HANDLE *threads;
+#elif !defined(VTK_PARSE_NO_THREADS)
+  pthread_t *threads;
+  pthread_attr_t attr;
+#endif
+
+  if (njobs <= 0)
+    {
+    return;
+    }
+
+  nthreads = vtkParseThreads_NumberOfWorkers(nthreads, njobs);
+
+  /* sort the jobs so that the most costly jobs run first */
+  order = (JobCost *)malloc(njobs*sizeof(JobCost));
+  for (i = 0; i < njobs; i++)
+    {
+    order[i].Cost = (costs ? costs[i] : 0);
+    order[i].Job = i;
+    }
+  qsort(order, njobs, sizeof(JobCost), job_compare);
+
+  /* deal the jobs to the workers */
+  pool.NumberOfWorkers = nthreads;
+  pool.Queues = (WorkerQueue *)malloc(nthreads*sizeof(WorkerQueue));
+  pool.Func = func;
+  pool.Arg = arg;
+  for (i = 0; i < nthreads; i++)
+    {
+    pool.Queues[i].Mutex = vtkParseThreads_NewMutex();
+    pool.Queues[i].Jobs = (int *)malloc((njobs/nthreads + 1)*sizeof(int));
+    pool.Queues[i].Front = 0;
+    pool.Queues[i].Back = 0;
+    }
+  for (i = 0; i < njobs; i++)
+    {
+    WorkerQueue *queue = &pool.Queues[i % nthreads];
+    queue->Jobs[queue->Back++] = order[i].Job;
+    }
+  free(order);
+
+  info = (WorkerInfo *)malloc(nthreads*sizeof(WorkerInfo));
+  for (i = 0; i < nthreads; i++)
+    {
+    info[i].Pool = &pool;
+    info[i].Index = i;
+    }
+
+  /* start the threads, the calling thread is worker zero */
+#if defined(_WIN32)
+  threads = (HANDLE *)malloc(nthreads*sizeof(HANDLE));
+  for (i = 1; i < nthreads; i++)
+    {
+    threads[i] = CreateThread(NULL, VTK_PARSE_THREAD_STACK_SIZE,
+                              pool_thread, &info[i], 0, NULL);
+    if (threads[i] == NULL)
+      {
+      fprintf(stderr, "Unable to create a thread.\n");
+      exit(1);
+      }
+    }
+#elif !defined(VTK_PARSE_NO_THREADS)
+  threads = (pthread_t *)malloc(nthreads*sizeof(pthread_t));
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, VTK_PARSE_THREAD_STACK_SIZE);
+  for (i = 1; i < nthreads; i++)
+    {
+    if (pthread_create(&threads[i], &attr, pool_thread, &info[i]) != 0)
+      {
+      fprintf(stderr, "Unable to create a thread.\n");
+      exit(1);
+      }
+    }
+  pthread_attr_destroy(&attr);
+#endif
+
+  pool_work(&pool, 0);
+
+  /* wait for the other threads to finish */
+#if defined(_WIN32)
+  for (i = 1; i < nthreads; i++)
+    {
+    WaitForSingleObject(threads[i], INFINITE);
+    CloseHandle(threads[i]);
+    }
+  free(threads);
+#elif !defined(VTK_PARSE_NO_THREADS)
+  for (i = 1; i < nthreads; i++)
+    {
+    pthread_join(threads[i], NULL);
+    }
+  free(threads);
+#endif
+
+  for (i = 0; i < nthreads; i++)
+    {
+    vtkParseThreads_FreeMutex(pool.Queues[i].Mutex);
+    free(pool.Queues[i].Jobs);
+    }
+  free(pool.Queues);
+  free(info);
+}
+
+/* Create a mutex */
+vtkParseMutex *vtkParseThreads_NewMutex()
+{
+  vtkParseMutex *mutex = (vtkParseMutex *)malloc(sizeof(vtkParseMutex));
+
+#if defined(_WIN32)
+  InitializeCriticalSection(&mutex->Lock);
+#elif !defined(VTK_PARSE_NO_THREADS)
+  pthread_mutex_init(&mutex->Lock, NULL);
+#else
+  mutex->Lock = 0;
+#endif
+
+  return mutex;
+}
+
+/* Lock the mutex */
+void vtkParseThreads_Lock(vtkParseMutex *mutex)
+{
+#if defined(_WIN32)
+  EnterCriticalSection(&mutex->Lock);
+#elif !defined(VTK_PARSE_NO_THREADS)
+  pthread_mutex_lock(&mutex->Lock);
+#else
+  mutex->Lock = 1;
+#endif
+}
+
+/* Unlock the mutex */
+void vtkParseThreads_Unlock(vtkParseMutex *mutex)
+{
+#if defined(_WIN32)
+  LeaveCriticalSection(&mutex->Lock);
+#elif !defined(VTK_PARSE_NO_THREADS)
+  pthread_mutex_unlock(&mutex->Lock);
+#else
+  mutex->Lock = 0;
+#endif
+}
+
+/* Free the mutex */
+void vtkParseThreads_FreeMutex(vtkParseMutex *mutex)
+{
+#if defined(_WIN32)
+  DeleteCriticalSection(&mutex->Lock);
+#elif !defined(VTK_PARSE_NO_THREADS)
+  pthread_mutex_destroy(&mutex->Lock);
+#endif
+
+  free(mutex);
+}
+
+/* Lock the global mutex */
+void vtkParseThreads_LockGlobal()
+{
+#if defined(_WIN32)
+  AcquireSRWLockExclusive(&global_lock);
+#elif !defined(VTK_PARSE_NO_THREADS)
+  pthread_mutex_lock(&global_lock);
+#endif
+}
+
+/* Unlock the global mutex */
+void vtkParseThreads_UnlockGlobal()
+{
+#if defined(_WIN32)
+  ReleaseSRWLockExclusive(&global_lock);
+#elif !defined(VTK_PARSE_NO_THREADS)
+  pthread_mutex_unlock(&global_lock);
+#endif
+}
@@ -0,0 +1,106 @@
+/*=========================================================================
+
+  Program:   Visualization Toolkit
+  Module:    vtkParseThreads.h
+
+  Copyright (c) Ken Martin, Will Schroeder, Bill Lorensen
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+/**
+ This file provides a thread pool and a mutex for the wrapper tools,
+ so that several header files can be parsed at the same time.
+
+ The pool takes a number of jobs, each with a cost (for example, the
+ size of the header file).  The jobs are dealt out to the workers in
+ order of decreasing cost, so that the largest files are parsed first,
+ and a worker that runs out of jobs will steal jobs from the other
+ workers.  Jobs are identified by their index, so that the results
+ can be collected in a deterministic order after the pool is done.
+
+ If the compiler does not support thread-local storage, then the
+ parser is not thread-safe and the jobs are run serially.
+*/
+
+#ifndef VTK_PARSE_THREADS_H
+#define VTK_PARSE_THREADS_H
+
+#include <stddef.h>
+
+/**
+ * An opaque mutex.
+ */
+typedef struct _vtkParseMutex vtkParseMutex;
+
+/**
+ * The function that is called for each job.  The "worker" is an index
+ * between zero and the number of threads, so that each worker can have
+ * its own data, and "job" is the index of the job.
+ */
+typedef void (*vtkParseThreads_Func)(void *arg, int worker, int job);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Get the number of processors, or return 1 if it cannot be determined.
+ */
+int vtkParseThreads_NumberOfProcessors();
+
+/**
+ * Get the number of workers that vtkParseThreads_Run() will use for
+ * the given number of threads and jobs, so that the caller can set up
+ * the data for each worker.
+ */
+int vtkParseThreads_NumberOfWorkers(int nthreads, int njobs);
+
+/**
+ * Run jobs 0 to (njobs - 1) with the given number of threads.  The
+ * "costs" array can be NULL, otherwise it gives the relative cost of
+ * each job.  If nthreads is zero or less, one thread per processor
+ * will be used.  The calling thread waits until all jobs are done.
+ */
+void vtkParseThreads_Run(
+  int nthreads, int njobs, const size_t *costs,
+  vtkParseThreads_Func func, void *arg);
+
+/**
+ * Create a mutex.
+ */
+vtkParseMutex *vtkParseThreads_NewMutex();
+
+/**
+ * Lock the mutex.
+ */
+void vtkParseThreads_Lock(vtkParseMutex *mutex);
+
+/**
+ * Unlock the mutex.
+ */
+void vtkParseThreads_Unlock(vtkParseMutex *mutex);
+
+/**
+ * Free a mutex.
+ */
+void vtkParseThreads_FreeMutex(vtkParseMutex *mutex);
+
+/**
+ * Lock or unlock the global mutex.  This mutex does not have to be
+ * created, so it can guard data that is shared by all the threads
+ * in the process, such as the preprocessor's cache of header files.
+ */
+void vtkParseThreads_LockGlobal();
+void vtkParseThreads_UnlockGlobal();
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif
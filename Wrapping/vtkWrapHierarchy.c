@@ -40,11 +40,15 @@
 #include "vtkParse.h"
 #include "vtkParseData.h"
 #include "vtkParseMain.h"
+#include "vtkParseHierarchy.h"
 #include "vtkParsePreprocess.h"
+#include "vtkParseThreads.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #ifdef _WIN32
 # include <windows.h>
 #else
@@ -52,34 +56,205 @@
 #endif
 
 /**
- * Helper to append a text line to an array of lines
+ * Helper to append a text line to an array of lines, the duplicates
+ * are removed afterwards by remove_duplicate_lines()
  */
-static char **append_unique_line(char **lines, char *line, size_t *np)
+static char **append_line(char **lines, const char *line, size_t *np)
 {
-  size_t l, n;
+  size_t n;
 
   n = *np;
 
-  /* check to make sure this line isn't a duplicate */
-  for (l = 0; l < n; l++)
+  /* allocate more memory if n+1 is a power of two */
+  if (((n+1) & n) == 0)
+    {
+    lines = (char **)realloc(lines, (n+1)*2*sizeof(char *));
+    }
+
+  lines[n] = (char *)malloc(strlen(line)+1);
+  strcpy(lines[n++], line);
+  lines[n] = NULL;
+
+  *np = n;
+  return lines;
+}
+
+/**
+ * Hash a line, for finding duplicate lines
+ */
+static size_t hash_line(const char *cp)
+{
+  size_t h = 5381;
+
+  while (*cp != '\0')
+    {
+    h = ((h << 5) + h) ^ (unsigned char)*cp++;
+    }
+
+  return h;
+}
+
+/**
+ * Remove duplicate lines, keeping the first of each, and return the
+ * new number of lines.  A hash table is used to find the duplicates,
+ * so that the time is linear in the number of lines.
+ */
+static size_t remove_duplicate_lines(char **lines, size_t n)
+{
+  size_t *table;
+  size_t i, j, k, h, m;
+
+  /* the table holds (index + 1) of each unique line, or zero */
+  m = 16;
+  while (m < 2*n)
     {
-    if (strcmp(line, lines[l]) == 0)
+    m *= 2;
+    }
+  table = (size_t *)calloc(m, sizeof(size_t));
+
+  k = 0;
+  for (i = 0; i < n; i++)
+    {
+    h = hash_line(lines[i]) & (m - 1);
+    while ((j = table[h]) != 0 && strcmp(lines[j-1], lines[i]) != 0)
+      {
+      h = (h + 1) & (m - 1);
+      }
+    if (j == 0)
+      {
+      lines[k++] = lines[i];
+      table[h] = k;
+      }
+    else
+      {
+      free(lines[i]);
+      }
+    }
+  lines[k] = NULL;
+
+  free(table);
+
+  return k;
+}
+
+/**
+ * Compare lines, for sorting
+ */
+static int string_compare(const void *vp1, const void *vp2)
+{
+  return strcmp(*(const char **)vp1, *(const char **)vp2);
+}
+
+/**
+ * Sort a null-terminated array of lines, unless already sorted
+ */
+static void sort_lines(char **lines)
+{
+  size_t n;
+  int sorted = 1;
+
+  for (n = 0; lines[n] != NULL; n++)
+    {
+    if (n > 0 && strcmp(lines[n-1], lines[n]) > 0)
+      {
+      sorted = 0;
+      }
+    }
+
+  if (!sorted)
+    {
+    qsort(lines, n, sizeof(char *), &string_compare);
+    }
+}
+
+/**
+ * Move the first cursor down the heap until the heap is ordered, where
+ * each cursor points to the current line of one of the sorted arrays
+ */
+static void sift_down_lines(char ***heap, size_t n, size_t i)
+{
+  char **tmp;
+  size_t c;
+
+  for (;;)
+    {
+    c = 2*i + 1;
+    if (c >= n)
       {
       break;
       }
+    if (c + 1 < n && strcmp(*heap[c+1], *heap[c]) < 0)
+      {
+      c++;
+      }
+    if (strcmp(*heap[c], *heap[i]) >= 0)
+      {
+      break;
+      }
+    tmp = heap[i];
+    heap[i] = heap[c];
+    heap[c] = tmp;
+    i = c;
     }
-  if (l == n)
+}
+
+/**
+ * Merge sorted, null-terminated arrays of lines into one sorted array
+ * without duplicates.  The lines are moved into the new array (or
+ * freed if they are duplicates), but the old arrays are not freed.
+ */
+static char **merge_sorted_lines(char ***arrays, size_t narrays, size_t *np)
+{
+  char ***heap;
+  char **lines;
+  char *line;
+  size_t i, k, n, total;
+
+  total = 0;
+  for (i = 0; i < narrays; i++)
     {
-    /* allocate more memory if n+1 is a power of two */
-    if (((n+1) & n) == 0)
+    for (k = 0; arrays[i][k] != NULL; k++) { ; };
+    total += k;
+    }
+  lines = (char **)malloc((total + 1)*sizeof(char *));
+
+  /* make a heap of cursors for the arrays that are not empty */
+  heap = (char ***)malloc((narrays + 1)*sizeof(char **));
+  k = 0;
+  for (i = 0; i < narrays; i++)
+    {
+    if (arrays[i][0] != NULL)
       {
-      lines = (char **)realloc(lines, (n+1)*2*sizeof(char *));
+      heap[k++] = arrays[i];
       }
+    }
+  for (i = k/2; i > 0; i--)
+    {
+    sift_down_lines(heap, k, i-1);
+    }
 
-    lines[n] = (char *)malloc(strlen(line)+1);
-    strcpy(lines[n++], line);
-    lines[n] = NULL;
+  /* take the smallest line until all arrays are done */
+  n = 0;
+  while (k > 0)
+    {
+    line = *heap[0]++;
+    if (n > 0 && strcmp(line, lines[n-1]) == 0)
+      {
+      free(line);
+      }
+    else
+      {
+      lines[n++] = line;
+      }
+    if (*heap[0] == NULL)
+      {
+      heap[0] = heap[--k];
+      }
+    sift_down_lines(heap, k, 0);
     }
+  lines[n] = NULL;
+
+  free(heap);
 
   *np = n;
   return lines;
@@ -398,7 +573,7 @@ static char **append_class_contents(
       line, &m, &maxlen, header_file, module_name, tmpflags);
 
     /* append the line to the file */
-    lines = append_unique_line(lines, line, np);
+    lines = append_line(lines, line, np);
 
     /* for classes, add all typed defined within the class */
     if ((data->Items[i].Type == VTK_CLASS_INFO ||
@@ -519,7 +694,7 @@ static char **append_namespace_contents(
         line, &m, &maxlen, header_file, module_name, tmpflags);
 
       /* append the line to the file */
-      lines = append_unique_line(lines, line, np);
+      lines = append_line(lines, line, np);
       }
 
     /* for classes, add all typed defined within the class */
@@ -559,8 +734,8 @@ static char **append_namespace_contents(
  * will be appended to them.
  */
 static char **vtkWrapHierarchy_ParseHeaderFile(
-  FILE *fp, const char *filename, const char *module_name,
-  const char *flags, char **lines)
+  vtkParseContext *context, FILE *fp, const char *filename,
+  const char *module_name, const char *flags, char **lines)
 {
   FileInfo *data;
   const char *header_file;
@@ -573,11 +748,8 @@ static char **vtkWrapHierarchy_ParseHeaderFile(
     lines[0] = NULL;
     }
 
-  /* always ignore BTX markers when building hierarchy files */
-  vtkParse_SetIgnoreBTX(1);
-
   /* the "concrete" flag doesn't matter, just set to zero */
-  data = vtkParse_ParseFile(filename, fp, stderr);
+  data = vtkParse_ParseFileWithContext(context, filename, fp, stderr);
 
   if (!data)
     {
@@ -603,6 +775,7 @@ static char **vtkWrapHierarchy_ParseHeaderFile(
   lines = append_namespace_contents(
     lines, &n, data->Contents, data->MainClass, 0,
     header_file, module_name, flags);
+  remove_duplicate_lines(lines, n);
 
   vtkParse_Free(data);
 
@@ -626,6 +799,13 @@ static char **vtkWrapHierarchy_ReadHierarchyFile(FILE *fp, char **lines)
     lines[0] = NULL;
     }
 
+  /* find the last line in "lines" */
+  i = 0;
+  while (lines[i] != NULL)
+    {
+    i++;
+    }
+
   while (fgets(line, (int)maxlen, fp))
     {
     n = strlen(line);
@@ -650,26 +830,7 @@ static char **vtkWrapHierarchy_ReadHierarchyFile(FILE *fp, char **lines)
       continue;
       }
 
-    for (i = 0; lines[i] != NULL; i++)
-      {
-      if (strcmp(line, lines[i]) == 0)
-        {
-        break;
-        }
-      }
-
-    if (lines[i] == NULL)
-      {
-      /* allocate more memory if n+1 is a power of two */
-      if (((i+1) & i) == 0)
-        {
-        lines = (char **)realloc(lines, (i+1)*2*sizeof(char *));
-        }
-
-      lines[i] = (char *)malloc(n+1);
-      strcpy(lines[i], line);
-      lines[i+1] = NULL;
-      }
+    lines = append_line(lines, line, &i);
     }
 
   free(line);
@@ -680,24 +841,28 @@ static char **vtkWrapHierarchy_ReadHierarchyFile(FILE *fp, char **lines)
     return 0;
     }
 
+  remove_duplicate_lines(lines, i);
+
   return lines;
 }
 
 /**
- * Compare a file to "lines", return 0 if they are different
+ * Compare a file to "lines", return 0 if they are different.
+ * The lines must be sorted and unique.
  */
 static int vtkWrapHierarchy_CompareHierarchyFile(FILE *fp, char *lines[])
 {
   unsigned char *matched;
+  char **found;
   char *line;
   size_t maxlen = 15;
-  size_t i, n;
+  size_t i, n, nlines;
 
   line = (char *)malloc(maxlen);
 
-  for (i = 0; lines[i] != NULL; i++) { ; };
-  matched = (unsigned char *)malloc(i);
-  memset(matched, 0, i);
+  for (nlines = 0; lines[nlines] != NULL; nlines++) { ; };
+  matched = (unsigned char *)malloc(nlines + 1);
+  memset(matched, 0, nlines + 1);
 
   while (fgets(line, (int)maxlen, fp))
     {
@@ -723,27 +888,24 @@ static int vtkWrapHierarchy_CompareHierarchyFile(FILE *fp, char *lines[])
       continue;
       }
 
-    for (i = 0; lines[i] != NULL; i++)
-      {
-      if (strcmp(line, lines[i]) == 0)
-        {
-        break;
-        }
-      }
+    found = (char **)bsearch(
+      &line, lines, nlines, sizeof(char *), &string_compare);
 
-    if (lines[i] == NULL)
+    if (found == NULL)
       {
+      free(line);
       free(matched);
       return 0;
       }
 
-    matched[i] = 1;
+    matched[found - lines] = 1;
     }
 
   for (i = 0; lines[i] != NULL; i++)
     {
     if (matched[i] == 0)
       {
+      free(line);
       free(matched);
       return 0;
       }
@@ -782,8 +944,8 @@ static int vtkWrapHierarchy_WriteHierarchyFile(FILE *fp, char *lines[])
  * Try to parse a header file, print error and exit if fail
  */
 static char **vtkWrapHierarchy_TryParseHeaderFile(
-  const char *file_name, const char *module_name,
-  const char *flags, char **lines)
+  vtkParseContext *context, const char *file_name,
+  const char *module_name, const char *flags, char **lines)
 {
   FILE *input_file;
 
@@ -797,7 +959,7 @@ static char **vtkWrapHierarchy_TryParseHeaderFile(
     }
 
   lines = vtkWrapHierarchy_ParseHeaderFile(
-                 input_file, file_name, module_name, flags, lines);
+                 context, input_file, file_name, module_name, flags, lines);
 
   if (!lines)
     {
@@ -905,16 +1067,83 @@ static int vtkWrapHierarchy_TryWriteHierarchyFile(
   return 0;
 }
 
-static int string_compare(const void *vp1, const void *vp2)
+/**
+ * Write a binary copy of a hierarchy file, print error and exit if fail
+ */
+static int vtkWrapHierarchy_TryWriteBinaryFile(
+  const char *text_file_name, const char *file_name)
 {
-  return strcmp(*(const char **)vp1, *(const char **)vp2);
+  HierarchyInfo *info;
+
+  info = vtkParseHierarchy_ReadFile(text_file_name);
+  if (!info)
+    {
+    fprintf(stderr, "vtkWrapHierarchy: error reading file %s\n",
+            text_file_name);
+    exit(1);
+    }
+
+  if (!vtkParseHierarchy_WriteBinaryFile(info, file_name))
+    {
+    vtkParseHierarchy_Free(info);
+    fprintf(stderr, "vtkWrapHierarchy: error writing file %s\n",
+            file_name);
+    exit(1);
+    }
+
+  vtkParseHierarchy_Free(info);
+
+  return 0;
+}
+
+/**
+ * The headers to be parsed by the thread pool
+ */
+typedef struct _HierarchyJobs
+{
+  vtkParseContext **Contexts;    /* one parser context per worker */
+  char            **Files;       /* the header files */
+  char            **ModuleNames; /* the module for each header */
+  char            **Flags;       /* the flags for each header */
+  char           ***Results;     /* the lines for each header */
+} HierarchyJobs;
+
+/**
+ * Parse one header, this is called by the thread pool
+ */
+static void vtkWrapHierarchy_ParseJob(void *arg, int worker, int i)
+{
+  HierarchyJobs *jobs = (HierarchyJobs *)arg;
+
+  jobs->Results[i] = vtkWrapHierarchy_TryParseHeaderFile(
+    jobs->Contexts[worker], jobs->Files[i], jobs->ModuleNames[i],
+    jobs->Flags[i], NULL);
+}
+
+/**
+ * Get the size of a file, for deciding which files to parse first
+ */
+static size_t vtkWrapHierarchy_FileSize(const char *filename)
+{
+  struct stat fs;
+
+  if (stat(filename, &fs) != 0)
+    {
+    return 0;
+    }
+
+  return (size_t)fs.st_size;
 }
 
 int main(int argc, char *argv[])
 {
   OptionInfo *options;
+  HierarchyJobs jobs;
   int i;
+  int nfiles, nprior, nthreads;
   size_t j, n;
+  size_t *costs;
+  char ***sorted;
   char **lines = 0;
   char **files = 0;
   char *flags;
@@ -935,15 +1164,25 @@ int main(int argc, char *argv[])
   files = vtkWrapHierarchy_TryReadHierarchyFile(
     options->InputFileName, files);
 
-  /* read in all the prior files */
-  for (i = 1; i < options->NumberOfFiles; i++)
+  /* count the files listed in the data file */
+  for (nfiles = 0; files[nfiles] != NULL; nfiles++) { ; };
+
+  /* read in all the prior files, each will be merged as a sorted array */
+  nprior = (options->NumberOfFiles > 1 ? options->NumberOfFiles - 1 : 0);
+  sorted = (char ***)malloc((nprior + nfiles + 1)*sizeof(char **));
+  for (i = 0; i < nprior; i++)
     {
-    lines = vtkWrapHierarchy_TryReadHierarchyFile(
-      options->Files[i], lines);
+    sorted[i] = vtkWrapHierarchy_TryReadHierarchyFile(
+      options->Files[i + 1], NULL);
     }
 
-  /* merge the files listed in the data file */
-  for (i = 0; files[i] != NULL; i++)
+  jobs.Files = files;
+  jobs.ModuleNames = (char **)malloc((nfiles+1)*sizeof(char *));
+  jobs.Flags = (char **)malloc((nfiles+1)*sizeof(char *));
+  jobs.Results = (char ***)malloc((nfiles+1)*sizeof(char **));
+  costs = (size_t *)malloc((nfiles+1)*sizeof(size_t));
+
+  for (i = 0; i < nfiles; i++)
     {
     /* look for semicolon that marks the module name */
     module_name = files[i];
@@ -955,17 +1194,69 @@ int main(int argc, char *argv[])
     while(*flags != ';' && *flags != '\0') { flags++; };
     if (*flags == ';') { *flags++ = '\0'; }
 
-    lines = vtkWrapHierarchy_TryParseHeaderFile(
-      files[i], module_name, flags, lines);
+    jobs.ModuleNames[i] = module_name;
+    jobs.Flags[i] = flags;
+    jobs.Results[i] = NULL;
+    costs[i] = vtkWrapHierarchy_FileSize(files[i]);
     }
 
-  /* sort the lines to ease lookups in the file */
-  for (n = 0; lines[n]; n++) { ; };
-  qsort(lines, n, sizeof(char *), &string_compare);
+  /* always ignore BTX markers when building hierarchy files */
+  vtkParse_SetIgnoreBTX(1);
+
+  /* each thread needs its own parser context */
+  nthreads = vtkParseThreads_NumberOfWorkers(
+    options->NumberOfThreads, nfiles);
+  jobs.Contexts = (vtkParseContext **)malloc(
+    nthreads*sizeof(vtkParseContext *));
+  for (i = 0; i < nthreads; i++)
+    {
+    jobs.Contexts[i] = vtkParse_NewContext();
+    }
+
+  /* parse the files, largest files first */
+  vtkParseThreads_Run(
+    nthreads, nfiles, costs, vtkWrapHierarchy_ParseJob, &jobs);
+
+  /* the prior files are usually sorted already, but the results are
+   * in the order the classes appeared in each header */
+  for (i = 0; i < nfiles; i++)
+    {
+    sorted[nprior + i] = jobs.Results[i];
+    }
+  for (i = 0; i < nprior + nfiles; i++)
+    {
+    sort_lines(sorted[i]);
+    }
+
+  /* merge the sorted arrays, which also removes the duplicates and
+   * sorts the lines to ease lookups in the file */
+  lines = merge_sorted_lines(sorted, (size_t)(nprior + nfiles), &n);
+  for (i = 0; i < nprior + nfiles; i++)
+    {
+    free(sorted[i]);
+    }
+  free(sorted);
+
+  for (i = 0; i < nthreads; i++)
+    {
+    vtkParse_FreeContext(jobs.Contexts[i]);
+    }
+  free(jobs.Contexts);
+  free(jobs.ModuleNames);
+  free(jobs.Flags);
+  free(jobs.Results);
+  free(costs);
 
   /* write the file, if it has changed */
   vtkWrapHierarchy_TryWriteHierarchyFile(options->OutputFileName, lines);
 
+  /* the binary file is made from the text file */
+  if (options->BinaryFileName)
+    {
+    vtkWrapHierarchy_TryWriteBinaryFile(
+      options->OutputFileName, options->BinaryFileName);
+    }
+
   for (j = 0; j < n; j++)
     {
     free(lines[j]);
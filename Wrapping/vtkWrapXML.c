@@ -27,24 +27,105 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include "vtkParse.h"
+#include "vtkParseBinary.h"
 #include "vtkParseExtras.h"
 #include "vtkParseProperties.h"
 #include "vtkParseHierarchy.h"
 #include "vtkParseMerge.h"
 #include "vtkParseMain.h"
+#include "vtkParseThreads.h"
 #include "vtkConfigure.h"
 
+/* SSE2 is used to find the chars that must be escaped, it is always
+ * available on x86_64 */
+#if !defined(VTK_PARSE_NO_SIMD)
+# if defined(__SSE2__) || defined(_M_X64) || \
+     (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define VTKXML_USE_SSE2
+#  include <emmintrin.h>
+# endif
+#endif
+
+#if defined(VTKXML_USE_SSE2)
+# if defined(_MSC_VER)
+#  include <intrin.h>
+static unsigned int vtkWrapXML_ctz(unsigned int x)
+{
+  unsigned long i;
+  _BitScanForward(&i, x);
+  return i;
+}
+# else
+#  define vtkWrapXML_ctz(x) ((unsigned int)__builtin_ctz(x))
+# endif
+#endif
+
 /* ----- XML state information ----- */
 
+typedef struct _wrapxml_buffer
+{
+  char *text; /* the output, which is not null-terminated */
+  size_t length; /* the length of the output */
+  size_t size; /* the allocated size */
+} wrapxml_buffer_t;
+
 typedef struct _wrapxml_state
 {
   FileInfo *data; /* the data that was parsed */
-  FILE *file; /* the file being written to */
+  MergeSession *session; /* the data shared by all headers */
+  wrapxml_buffer_t *out; /* the buffer for the output */
   int indentation; /* current indentation level */
   int unclosed; /* true if current tag is not closed */
 } wrapxml_state_t;
 
+/* The hash of an output file */
+#if defined(_WIN32) && !defined(__MINGW32__) && !defined(__CYGWIN__)
+typedef unsigned __int64 wrapxml_hash_t;
+#else
+typedef unsigned long long wrapxml_hash_t;
+#endif
+
+/* The manifest entry for one output file */
+typedef struct _wrapxml_entry
+{
+  const char *filename; /* the output file */
+  wrapxml_hash_t hash; /* the hash of the contents */
+  size_t size; /* the size of the contents */
+} wrapxml_entry_t;
+
+/* The manifest that was written by the previous run */
+typedef struct _wrapxml_manifest
+{
+  int count; /* the number of entries */
+  wrapxml_entry_t *entries; /* the entries, sorted by filename */
+  char *text; /* the contents of the manifest file */
+  time_t mtime; /* the time when the manifest was written */
+} wrapxml_manifest_t;
+
+/* The XML for one header, which is kept for the kit file */
+typedef struct _wrapxml_part
+{
+  char *text; /* the XML for the header */
+  size_t length; /* the length of the XML */
+  int count; /* the number of classes in the header */
+  char *names; /* the class names, each followed by a null */
+} wrapxml_part_t;
+
+/* The data for the thread pool */
+typedef struct _wrapxml_jobs
+{
+  vtkParseContext **contexts; /* one parser context per worker */
+  MergeSession *session; /* the hierarchy, hints, and superclasses */
+  wrapxml_buffer_t *buffers; /* one output buffer per worker */
+  const wrapxml_manifest_t *manifest; /* the old manifest, or NULL */
+  wrapxml_entry_t *entries; /* the new manifest entry for each output */
+  wrapxml_part_t *parts; /* the XML for each header, or NULL if no kit */
+} wrapxml_jobs_t;
+
 /* ----- XML utility functions ----- */
 
 /* The indentation string, default is two spaces */
@@ -66,84 +147,398 @@ static const char *indent(int indentation)
   return indentString[indentation % 6];
 }
 
+/* ----- XML output functions ----- */
+
 /**
- * Convert special characters in a string into their escape codes,
- * so that the string can be quoted in an xml file (the specified
- * maxlen must be at least 32 chars)
+ * Make room for "n" more chars in the output, and return a pointer
+ * to the end of the output
  */
-static const char *vtkWrapXML_Quote(const char *comment, size_t maxlen)
+static char *vtkWrapXML_Reserve(wrapxml_state_t *w, size_t n)
 {
-  static char *result = 0;
-  static size_t oldmaxlen = 0;
-  size_t i, j, n;
+  wrapxml_buffer_t *out = w->out;
+  size_t m = out->size;
 
-  if (maxlen > oldmaxlen)
+  /* the buffer is allocated even if n is zero, so it is never NULL */
+  if (out->length + n >= m)
     {
-    if (result)
+    /* double the size until the chars fit */
+    m = (m == 0 ? 4096 : m);
+    while (out->length + n >= m)
       {
-      free(result);
+      m *= 2;
       }
-    result = (char *)malloc((size_t)(maxlen+1));
-    oldmaxlen = maxlen;
+    out->text = (char *)realloc(out->text, m);
+    out->size = m;
     }
 
-  if (comment == NULL)
+  return &out->text[out->length];
+}
+
+/**
+ * Append "n" chars to the output
+ */
+static void vtkWrapXML_AppendText(
+  wrapxml_state_t *w, const char *text, size_t n)
+{
+  memcpy(vtkWrapXML_Reserve(w, n), text, n);
+  w->out->length += n;
+}
+
+/**
+ * Append a string literal to the output, the length is known at
+ * compile time
+ */
+#define vtkWrapXML_AppendLiteral(w, s) \
+  vtkWrapXML_AppendText((w), (s), sizeof(s) - 1)
+
+/**
+ * Append a null-terminated string to the output
+ */
+static void vtkWrapXML_AppendString(wrapxml_state_t *w, const char *text)
+{
+  vtkWrapXML_AppendText(w, text, strlen(text));
+}
+
+/**
+ * Append a single char to the output
+ */
+static void vtkWrapXML_AppendChar(wrapxml_state_t *w, char c)
+{
+  *vtkWrapXML_Reserve(w, 1) = c;
+  w->out->length++;
+}
+
+/**
+ * Append the indentation for the current indentation level
+ */
+static void vtkWrapXML_AppendIndent(wrapxml_state_t *w)
+{
+  vtkWrapXML_AppendString(w, indent(w->indentation));
+}
+
+/**
+ * Check for chars that can be copied to xml without escaping.  The
+ * SIMD code below must use the same rule.
+ */
+static int vtkWrapXML_IsPlain(char c)
+{
+  return (c >= 0x20 && c < 0x7f &&
+          c != '<' && c != '>' && c != '&' && c != '\"' && c != '\'');
+}
+
+/**
+ * Write the escape code for a char that is not plain, and return the
+ * number of chars that were written.  As in the "C" locale, whitespace
+ * is kept but other non-printing chars are dropped.
+ */
+static size_t vtkWrapXML_EscapeChar(char *result, char c)
+{
+  switch (c)
     {
-    return "";
+    case '<':
+      memcpy(result, "&lt;", 4);
+      return 4;
+    case '>':
+      memcpy(result, "&gt;", 4);
+      return 4;
+    case '&':
+      memcpy(result, "&amp;", 5);
+      return 5;
+    case '\"':
+      memcpy(result, "&quot;", 6);
+      return 6;
+    case '\'':
+      memcpy(result, "&apos;", 6);
+      return 6;
     }
 
-  j = 0;
-
-  n = (int)strlen(comment);
-  for (i = 0; i < n; i++)
+  if ((c >= 0x20 && c < 0x7f) || (c >= '\t' && c <= '\r'))
     {
-    if (comment[i] == '<')
-      {
-      strcpy(&result[j],"&lt;");
-      j += 4;
-      }
-    else if (comment[i] == '>')
-      {
-      strcpy(&result[j],"&gt;");
-      j += 4;
-      }
-    else if (comment[i] == '&')
+    *result = c;
+    return 1;
+    }
+
+  return 0;
+}
+
+/**
+ * Append "n" chars, after converting special characters into their
+ * escape codes so that the text can be quoted in an xml file.  The
+ * runs of plain chars are copied in bulk, and nothing is truncated.
+ */
+static void vtkWrapXML_AppendEscaped(
+  wrapxml_state_t *w, const char *text, size_t n)
+{
+  char *result;
+  size_t i = 0;
+  size_t j = 0;
+  size_t k;
+#if defined(VTKXML_USE_SSE2)
+  const __m128i lo = _mm_set1_epi8(0x1f);
+  const __m128i hi = _mm_set1_epi8(0x7f);
+  const __m128i lt = _mm_set1_epi8('<');
+  const __m128i gt = _mm_set1_epi8('>');
+  const __m128i amp = _mm_set1_epi8('&');
+  const __m128i quot = _mm_set1_epi8('\"');
+  const __m128i apos = _mm_set1_epi8('\'');
+  __m128i v, plain, special;
+  unsigned int mask;
+#endif
+
+  /* each char becomes at most six chars, and each SIMD store can
+   * write up to 16 chars past the end of the escaped text */
+  result = vtkWrapXML_Reserve(w, 6*n + 16);
+
+#if defined(VTKXML_USE_SSE2)
+  while (i + 16 <= n)
+    {
+    v = _mm_loadu_si128((const __m128i *)&text[i]);
+    /* the signed compares also reject the bytes from 0x80 to 0xff */
+    plain = _mm_and_si128(_mm_cmpgt_epi8(v, lo), _mm_cmplt_epi8(v, hi));
+    special = _mm_or_si128(
+      _mm_or_si128(_mm_cmpeq_epi8(v, lt), _mm_cmpeq_epi8(v, gt)),
+      _mm_or_si128(_mm_cmpeq_epi8(v, amp),
+        _mm_or_si128(_mm_cmpeq_epi8(v, quot), _mm_cmpeq_epi8(v, apos))));
+    plain = _mm_andnot_si128(special, plain);
+    mask = ~(unsigned int)_mm_movemask_epi8(plain) & 0xFFFFu;
+
+    /* store all 16 chars, but keep only the ones before the first
+     * char that is not plain */
+    _mm_storeu_si128((__m128i *)&result[j], v);
+    if (mask == 0)
       {
-      strcpy(&result[j],"&amp;");
-      j += 5;
+      i += 16;
+      j += 16;
       }
-    else if (comment[i] == '\"')
+    else
       {
-      strcpy(&result[j],"&quot;");
-      j += 6;
+      k = vtkWrapXML_ctz(mask);
+      j += k + vtkWrapXML_EscapeChar(&result[j + k], text[i + k]);
+      i += k + 1;
       }
-    else if (comment[i] == '\'')
+    }
+#endif
+
+  while (i < n)
+    {
+    k = i;
+    while (k < n && vtkWrapXML_IsPlain(text[k]))
       {
-      strcpy(&result[j],"&apos;");
-      j += 6;
+      k++;
       }
-    else if (isprint(comment[i]))
+    memcpy(&result[j], &text[i], k - i);
+    j += k - i;
+    if (k < n)
       {
-      result[j] = comment[i];
-      j++;
-      }
-    else if (isspace(comment[i]))
-      { /* also copy non-printing characters */
-      result[j] = comment[i];
-      j++;
+      j += vtkWrapXML_EscapeChar(&result[j], text[k]);
+      k++;
       }
+    i = k;
+    }
 
-    /* add trailing ellipsis if too long */
-    if (j >= maxlen - 5)
-      {
-      sprintf(&result[j]," ...");
-      j += (int)strlen(" ...");
-      break;
-      }
+  w->out->length += j;
+}
+
+/**
+ * Append a null-terminated string after escaping it, NULL is empty
+ */
+static void vtkWrapXML_AppendEscapedString(
+  wrapxml_state_t *w, const char *text)
+{
+  if (text)
+    {
+    vtkWrapXML_AppendEscaped(w, text, strlen(text));
+    }
+}
+
+/**
+ * Compare manifest entries by filename, for sorting and searching
+ */
+static int vtkWrapXML_CompareEntries(const void *vp1, const void *vp2)
+{
+  return strcmp(((const wrapxml_entry_t *)vp1)->filename,
+                ((const wrapxml_entry_t *)vp2)->filename);
+}
+
+/**
+ * Compute a 64-bit FNV-1a hash of the output
+ */
+static wrapxml_hash_t vtkWrapXML_Hash(const char *text, size_t n)
+{
+  /* the 64-bit constants are built from 32-bit parts for old compilers */
+  wrapxml_hash_t h = ((wrapxml_hash_t)0xcbf29ce4 << 32) | 0x84222325;
+  wrapxml_hash_t prime = ((wrapxml_hash_t)0x100 << 32) | 0x1b3;
+  size_t i;
+
+  for (i = 0; i < n; i++)
+    {
+    h ^= (unsigned char)text[i];
+    h *= prime;
+    }
+
+  return h;
+}
+
+/**
+ * Compare a file with the text, return 1 if the file is identical
+ */
+static int vtkWrapXML_FileMatches(
+  const char *filename, const char *text, size_t n)
+{
+  struct stat fs;
+  FILE *fp;
+  char *contents;
+  int matched = 0;
+
+  if (stat(filename, &fs) != 0 || (size_t)fs.st_size != n)
+    {
+    return 0;
     }
-  result[j] = '\0';
 
-  return result;
+  fp = fopen(filename, "rb");
+  if (!fp)
+    {
+    return 0;
+    }
+
+  contents = (char *)malloc(n + 1);
+  if (fread(contents, 1, n + 1, fp) == n && memcmp(contents, text, n) == 0)
+    {
+    matched = 1;
+    }
+
+  free(contents);
+  fclose(fp);
+
+  return matched;
+}
+
+/**
+ * Check whether the manifest shows that the file is up to date, so
+ * that the file does not have to be read.  The file must not have
+ * been modified after the manifest was written.
+ */
+static int vtkWrapXML_ManifestMatches(
+  const wrapxml_manifest_t *manifest, const wrapxml_entry_t *entry)
+{
+  wrapxml_entry_t *found;
+  struct stat fs;
+
+  if (manifest == NULL || manifest->count == 0)
+    {
+    return 0;
+    }
+
+  found = (wrapxml_entry_t *)bsearch(
+    entry, manifest->entries, manifest->count, sizeof(wrapxml_entry_t),
+    vtkWrapXML_CompareEntries);
+
+  return (found != NULL &&
+          found->hash == entry->hash &&
+          found->size == entry->size &&
+          stat(entry->filename, &fs) == 0 &&
+          (size_t)fs.st_size == entry->size &&
+          fs.st_mtime <= manifest->mtime);
+}
+
+/**
+ * Write text to a file with a single call, unless the file already
+ * holds the same text, in which case it is left untouched so that
+ * its timestamp does not change.
+ */
+static void vtkWrapXML_WriteIfChanged(
+  const char *filename, const char *text, size_t n,
+  const wrapxml_manifest_t *manifest, wrapxml_entry_t *entry)
+{
+  FILE *fp;
+
+  if (entry && vtkWrapXML_ManifestMatches(manifest, entry))
+    {
+    return;
+    }
+
+  if (vtkWrapXML_FileMatches(filename, text, n))
+    {
+    return;
+    }
+
+  /* binary mode, so that the file holds exactly the hashed bytes */
+  fp = fopen(filename, "wb");
+
+  if (!fp)
+    {
+    fprintf(stderr, "Error opening output file %s\n", filename);
+    exit(1);
+    }
+
+  /* the output is already buffered */
+  setvbuf(fp, NULL, _IONBF, 0);
+
+  if (fwrite(text, 1, n, fp) != n)
+    {
+    fclose(fp);
+    fprintf(stderr, "Error writing output file %s\n", filename);
+    exit(1);
+    }
+
+  fclose(fp);
+}
+
+/**
+ * Write the output to a file if it changed, and clear the output.
+ * The hash and size of the output are stored in the manifest entry.
+ * If the filename is NULL, the output is simply cleared.
+ */
+static void vtkWrapXML_Flush(
+  wrapxml_state_t *w, const char *filename,
+  const wrapxml_manifest_t *manifest, wrapxml_entry_t *entry)
+{
+  wrapxml_buffer_t *out = w->out;
+
+  entry->filename = filename;
+  entry->hash = vtkWrapXML_Hash(out->text, out->length);
+  entry->size = out->length;
+
+  if (filename)
+    {
+    vtkWrapXML_WriteIfChanged(
+      filename, out->text, out->length, manifest, entry);
+    }
+
+  out->length = 0;
+}
+
+/**
+ * Keep a copy of the output and the names of the classes for the kit
+ */
+static void vtkWrapXML_KeepPart(
+  wrapxml_state_t *w, FileInfo *data, wrapxml_part_t *part)
+{
+  wrapxml_buffer_t *out = w->out;
+  NamespaceInfo *contents = data->Contents;
+  size_t n = 0;
+  size_t m;
+  int i;
+
+  part->text = (char *)malloc(out->length + 1);
+  memcpy(part->text, out->text, out->length);
+  part->length = out->length;
+
+  /* only the classes at file scope are put in the index */
+  part->count = contents->NumberOfClasses;
+  for (i = 0; i < part->count; i++)
+    {
+    n += strlen(contents->Classes[i]->Name) + 1;
+    }
+
+  part->names = (char *)malloc(n + 1);
+  n = 0;
+  for (i = 0; i < part->count; i++)
+    {
+    m = strlen(contents->Classes[i]->Name) + 1;
+    memcpy(&part->names[n], contents->Classes[i]->Name, m);
+    n += m;
+    }
 }
 
 /**
@@ -152,33 +547,29 @@ static const char *vtkWrapXML_Quote(const char *comment, size_t maxlen)
 static void vtkWrapXML_MultiLineText(wrapxml_state_t *w, const char *cp)
 {
   size_t i = 0;
-  size_t j;
-  char temp[512];
+  size_t j, k;
 
   while (cp && cp[i] != '\0')
     {
-    for (j = 0; j < 200 && cp[i] != '\0' && cp[i] != '\n'; j++)
-      {
-      temp[j] = cp[i++];
-      }
+    /* find the end of the line */
+    j = i + strcspn(&cp[i], "\n");
 
-    while (j > 0 &&
-           (temp[j-1] == ' ' || temp[j-1] == '\t' || temp[j-1] == '\r'))
+    /* strip the trailing whitespace */
+    k = j;
+    while (k > i &&
+           (cp[k-1] == ' ' || cp[k-1] == '\t' || cp[k-1] == '\r'))
       {
-      j--;
+      k--;
       }
 
-    temp[j] = '\0';
-
-    if (j > 0)
-      {
-      fprintf(w->file, "%s%s\n", indent(w->indentation),
-              vtkWrapXML_Quote(temp, 500));
-      }
-    else
+    if (k > i)
       {
-      fprintf(w->file, "\n");
+      vtkWrapXML_AppendIndent(w);
+      vtkWrapXML_AppendEscaped(w, &cp[i], k - i);
       }
+    vtkWrapXML_AppendChar(w, '\n');
+
+    i = j;
     if (cp[i] == '\n')
       {
       i++;
@@ -193,7 +584,7 @@ void vtkWrapXML_ElementBody(wrapxml_state_t *w)
 {
   if (w->unclosed)
     {
-    fprintf(w->file, ">\n");
+    vtkWrapXML_AppendLiteral(w, ">\n");
     }
   w->unclosed = 0;
 }
@@ -204,7 +595,9 @@ void vtkWrapXML_ElementBody(wrapxml_state_t *w)
 void vtkWrapXML_ElementStart(wrapxml_state_t *w, const char *name)
 {
   vtkWrapXML_ElementBody(w);
-  fprintf(w->file, "%s<%s", indent(w->indentation), name);
+  vtkWrapXML_AppendIndent(w);
+  vtkWrapXML_AppendChar(w, '<');
+  vtkWrapXML_AppendString(w, name);
   w->unclosed = 1;
   w->indentation++;
 }
@@ -217,11 +610,14 @@ void vtkWrapXML_ElementEnd(wrapxml_state_t *w, const char *name)
   w->indentation--;
   if (w->unclosed)
     {
-    fprintf(w->file, " />\n");
+    vtkWrapXML_AppendLiteral(w, " />\n");
     }
   else
     {
-    fprintf(w->file, "%s</%s>\n", indent(w->indentation), name);
+    vtkWrapXML_AppendIndent(w);
+    vtkWrapXML_AppendLiteral(w, "</");
+    vtkWrapXML_AppendString(w, name);
+    vtkWrapXML_AppendLiteral(w, ">\n");
     }
   w->unclosed = 0;
 }
@@ -232,7 +628,11 @@ void vtkWrapXML_ElementEnd(wrapxml_state_t *w, const char *name)
 void vtkWrapXML_Attribute(
   wrapxml_state_t *w, const char *name, const char *value)
 {
-  fprintf(w->file, " %s=\"%s\"", name, vtkWrapXML_Quote(value, 500));
+  vtkWrapXML_AppendChar(w, ' ');
+  vtkWrapXML_AppendString(w, name);
+  vtkWrapXML_AppendLiteral(w, "=\"");
+  vtkWrapXML_AppendEscapedString(w, value);
+  vtkWrapXML_AppendChar(w, '\"');
 }
 
 /**
@@ -241,7 +641,12 @@ void vtkWrapXML_Attribute(
 void vtkWrapXML_AttributeWithPrefix(
   wrapxml_state_t *w, const char *name, const char *prefix, const char *value)
 {
-  fprintf(w->file, " %s=\"%s%s\"", name, prefix, vtkWrapXML_Quote(value, 500));
+  vtkWrapXML_AppendChar(w, ' ');
+  vtkWrapXML_AppendString(w, name);
+  vtkWrapXML_AppendLiteral(w, "=\"");
+  vtkWrapXML_AppendString(w, prefix);
+  vtkWrapXML_AppendEscapedString(w, value);
+  vtkWrapXML_AppendChar(w, '\"');
 }
 
 /**
@@ -254,14 +659,25 @@ void vtkWrapXML_Size(wrapxml_state_t *w, ValueInfo *val)
 
   if (ndims > 0)
     {
-    fprintf(w->file, " size=\"%s", ((ndims > 1) ? "{" : ""));
+    vtkWrapXML_AppendLiteral(w, " size=\"");
+    if (ndims > 1)
+      {
+      vtkWrapXML_AppendChar(w, '{');
+      }
     for (j = 0; j < ndims; j++)
       {
-      fprintf(w->file, "%s%s",
-        ((j > 0) ? "," : ""),
+      if (j > 0)
+        {
+        vtkWrapXML_AppendChar(w, ',');
+        }
+      vtkWrapXML_AppendString(w,
         ((val->Dimensions[j][0] == '\0') ? ":" : val->Dimensions[j]));
       }
-    fprintf(w->file, "%s\"", ((ndims > 1) ? "}" : ""));
+    if (ndims > 1)
+      {
+      vtkWrapXML_AppendChar(w, '}');
+      }
+    vtkWrapXML_AppendChar(w, '\"');
     }
 }
 
@@ -360,7 +776,9 @@ void vtkWrapXML_Flag(wrapxml_state_t *w, const char *name, int value)
 {
   if (value)
     {
-    fprintf(w->file, " %s=\"1\"", name);
+    vtkWrapXML_AppendChar(w, ' ');
+    vtkWrapXML_AppendString(w, name);
+    vtkWrapXML_AppendLiteral(w, "=\"1\"");
     }
 }
 
@@ -441,7 +859,7 @@ int vtkWrapXML_EmptyString(const char *cp)
 void vtkWrapXML_FileDoc(wrapxml_state_t *w, FileInfo *data)
 {
   size_t n;
-  char temp[500];
+  char *temp;
   const char *cp;
 
   if (vtkWrapXML_EmptyString(data->NameComment) &&
@@ -462,29 +880,35 @@ void vtkWrapXML_FileDoc(wrapxml_state_t *w, FileInfo *data)
       {
       cp++;
       }
-    strncpy(temp, " .NAME ", 7);
-    n = strlen(cp) + 7;
-    n = (n >= 500 ? 500-1 : n);
-    strncpy(&temp[7], cp, n-7);
-    temp[n] = '\0';
+    n = strlen(cp);
+    temp = (char *)malloc(n + 8);
+    memcpy(temp, " .NAME ", 7);
+    memcpy(&temp[7], cp, n + 1);
     vtkWrapXML_MultiLineText(w, temp);
+    free(temp);
     }
 
   if (data->Description)
     {
-    fprintf(w->file, "\n%s .SECTION Description\n", indent(w->indentation));
+    vtkWrapXML_AppendChar(w, '\n');
+    vtkWrapXML_AppendIndent(w);
+    vtkWrapXML_AppendLiteral(w, " .SECTION Description\n");
     vtkWrapXML_MultiLineText(w, data->Description);
     }
 
   if (data->Caveats && data->Caveats[0] != '\0')
     {
-    fprintf(w->file, "\n%s .SECTION Caveats\n", indent(w->indentation));
+    vtkWrapXML_AppendChar(w, '\n');
+    vtkWrapXML_AppendIndent(w);
+    vtkWrapXML_AppendLiteral(w, " .SECTION Caveats\n");
     vtkWrapXML_MultiLineText(w, data->Caveats);
     }
 
   if (data->SeeAlso && data->SeeAlso[0] != '\0')
     {
-    fprintf(w->file, "\n%s .SECTION See also\n", indent(w->indentation));
+    vtkWrapXML_AppendChar(w, '\n');
+    vtkWrapXML_AppendIndent(w);
+    vtkWrapXML_AppendLiteral(w, " .SECTION See also\n");
 
     cp = data->SeeAlso;
     while(isspace(*cp))
@@ -501,7 +925,7 @@ void vtkWrapXML_FileDoc(wrapxml_state_t *w, FileInfo *data)
       /* There might be another section in the See also */
       if (strncmp(cp, ".SECTION", 8) == 0)
         {
-        fprintf(w->file, "\n");
+        vtkWrapXML_AppendChar(w, '\n');
 
         while(cp > data->SeeAlso && isspace(*(cp - 1)) && *(cp - 1) != '\n')
           {
@@ -511,12 +935,12 @@ void vtkWrapXML_FileDoc(wrapxml_state_t *w, FileInfo *data)
         break;
         }
 
-      if (n > 0 && n < 400)
+      if (n > 0)
         {
-        strncpy(temp, cp, n);
-        temp[n] = '\0';
-        fprintf(w->file,"%s %s\n", indent(w->indentation),
-                vtkWrapXML_Quote(temp,500));
+        vtkWrapXML_AppendIndent(w);
+        vtkWrapXML_AppendChar(w, ' ');
+        vtkWrapXML_AppendEscaped(w, cp, n);
+        vtkWrapXML_AppendChar(w, '\n');
         }
       cp += n;
       while(isspace(*cp))
@@ -743,7 +1167,7 @@ void vtkWrapXML_Enum(
   unsigned long i;
   const char *elementName = "enum";
 
-  fprintf(w->file, "\n");
+  vtkWrapXML_AppendChar(w, '\n');
   vtkWrapXML_ElementStart(w, elementName);
 
   if (inClass)
@@ -775,7 +1199,7 @@ void vtkWrapXML_Constant(
   /* inClass will be 2 for enum class */
   if (inClass < 2)
     {
-    fprintf(w->file, "\n");
+    vtkWrapXML_AppendChar(w, '\n');
     }
 
   vtkWrapXML_ElementStart(w, elementName);
@@ -819,7 +1243,7 @@ void vtkWrapXML_Variable(
     elementName = "member";
     }
 
-  fprintf(w->file, "\n");
+  vtkWrapXML_AppendChar(w, '\n');
   vtkWrapXML_ElementStart(w, elementName);
 
   vtkWrapXML_Name(w, var->Name);
@@ -856,7 +1280,7 @@ void vtkWrapXML_Typedef(
 {
   const char *elementName = "typedef";
 
-  fprintf(w->file, "\n");
+  vtkWrapXML_AppendChar(w, '\n');
   vtkWrapXML_ElementStart(w, elementName);
 
   vtkWrapXML_Name(w, type->Name);
@@ -902,7 +1326,7 @@ void vtkWrapXML_Using(
       name = data->Name;
       }
 
-    fprintf(w->file, "\n");
+    vtkWrapXML_AppendChar(w, '\n');
     vtkWrapXML_ElementStart(w, elementName);
     vtkWrapXML_Name(w, name);
     vtkWrapXML_Attribute(w, "context", data->Scope);
@@ -950,7 +1374,10 @@ void vtkWrapXML_FunctionCommon(
       cp = (char *)malloc(l+1);
       }
     vtkParse_FunctionInfoToString(func, cp, VTK_PARSE_EVERYTHING);
-    fprintf(w->file, "%s %s\n", indent(w->indentation), vtkWrapXML_Quote(cp, 500));
+    vtkWrapXML_AppendIndent(w);
+    vtkWrapXML_AppendChar(w, ' ');
+    vtkWrapXML_AppendEscapedString(w, cp);
+    vtkWrapXML_AppendChar(w, '\n');
     if (cp != temp)
       {
       free(cp);
@@ -1018,7 +1445,7 @@ void vtkWrapXML_Function(
       }
     }
 
-  fprintf(w->file, "\n");
+  vtkWrapXML_AppendChar(w, '\n');
   vtkWrapXML_ElementStart(w, elementName);
   vtkWrapXML_Name(w, name);
 
@@ -1026,7 +1453,7 @@ void vtkWrapXML_Function(
     {
     vtkWrapXML_Flag(w, "template", 1);
     vtkWrapXML_Template(w, func->Template);
-    fprintf(w->file, "\n");
+    vtkWrapXML_AppendChar(w, '\n');
     }
 
   vtkWrapXML_FunctionCommon(w, func, 1);
@@ -1043,7 +1470,7 @@ void vtkWrapXML_ClassPropertyMethods(
   unsigned int methodType;
   int first = 1;
 
-  fprintf(w->file, " bitfield=\"");
+  vtkWrapXML_AppendLiteral(w, " bitfield=\"");
 
   for (i = 0; i < 32; i++)
     {
@@ -1063,12 +1490,16 @@ void vtkWrapXML_ClassPropertyMethods(
         methodBitfield &= ~VTK_METHOD_SET_BOOL;
         }
 
-      fprintf(w->file, "%s%s", ((first == 0) ? "|" : ""),
+      if (first == 0)
+        {
+        vtkWrapXML_AppendChar(w, '|');
+        }
+      vtkWrapXML_AppendString(w,
         vtkParseProperties_MethodTypeAsString(methodType));
       first = 0;
       }
     }
-  fprintf(w->file, "\"");
+  vtkWrapXML_AppendChar(w, '\"');
 }
 
 /**
@@ -1117,7 +1548,7 @@ void vtkWrapXML_ClassMethod(
     return;
     }
 
-  fprintf(w->file, "\n");
+  vtkWrapXML_AppendChar(w, '\n');
   vtkWrapXML_ElementStart(w, elementName);
   if (!isCtrOrDtr)
     {
@@ -1181,7 +1612,7 @@ void vtkWrapXML_ClassProperty(
   const char *access = 0;
   unsigned long i;
 
-  fprintf(w->file, "\n");
+  vtkWrapXML_AppendChar(w, '\n');
   vtkWrapXML_ElementStart(w, elementName);
   vtkWrapXML_Name(w, property->Name);
 
@@ -1340,7 +1771,7 @@ void vtkWrapXML_Class(
   unsigned long i, j, n;
 
   /* start new XML section for class */
-  fprintf(w->file, "\n");
+  vtkWrapXML_AppendChar(w, '\n');
   if (classInfo->ItemType == VTK_STRUCT_INFO)
     {
     elementName = "struct";
@@ -1395,12 +1826,13 @@ void vtkWrapXML_Class(
   if (classInfo->NumberOfSuperClasses)
     {
     //merge = vtkParseMerge_MergeSuperClasses(w->data, data, classInfo);
-    vtkParseMerge_ApplyUsingDeclarations(w->data, data, classInfo);
+    vtkParseMerge_ApplyUsingDeclarations(
+      w->session, w->data, data, classInfo);
     }
 
   if (merge && merge->NumberOfClasses > 1)
     {
-    fprintf(w->file, "\n");
+    vtkWrapXML_AppendChar(w, '\n');
     vtkWrapXML_ClassInheritance(w, merge);
     }
 
@@ -1536,21 +1968,370 @@ void vtkWrapXML_Body(wrapxml_state_t *w, NamespaceInfo *data)
 void vtkWrapXML_Namespace(wrapxml_state_t *w, NamespaceInfo *data)
 {
   const char *elementName = "namespace";
-  fprintf(w->file, "\n");
+  vtkWrapXML_AppendChar(w, '\n');
   vtkWrapXML_ElementStart(w, elementName);
   vtkWrapXML_Name(w, data->Name);
   vtkWrapXML_ElementBody(w);
   vtkWrapXML_Body(w, data);
-  fprintf(w->file, "\n");
+  vtkWrapXML_AppendChar(w, '\n');
   vtkWrapXML_ElementEnd(w, elementName);
 }
 
-int main(int argc, char *argv[])
+/* Write the XML for one header file */
+static void vtkWrapXML_WriteFile(
+  MergeSession *session, wrapxml_buffer_t *out, FileInfo *data,
+  const char *filename, const wrapxml_manifest_t *manifest,
+  wrapxml_entry_t *entry, wrapxml_part_t *part)
+{
+  wrapxml_state_t ws;
+
+  /* a struct to keep track of things */
+  ws.data = data;
+  ws.session = session;
+  ws.out = out;
+  ws.indentation = 0;
+  ws.unclosed = 0;
+
+  /* print the lead-in */
+  vtkWrapXML_FileHeader(&ws, data);
+
+  /* print the documentation */
+  vtkWrapXML_FileDoc(&ws, data);
+
+  /* print the main body */
+  vtkWrapXML_Body(&ws, data->Contents);
+
+  /* print the closing tag */
+  vtkWrapXML_FileFooter(&ws, data);
+
+  /* keep the output if it is needed for the kit */
+  if (part)
+    {
+    vtkWrapXML_KeepPart(&ws, data, part);
+    }
+
+  /* write the file, if it changed */
+  vtkWrapXML_Flush(&ws, filename, manifest, entry);
+}
+
+/* Apply the using declarations in all the classes within a namespace,
+ * in the same way as vtkWrapXML_Class() does */
+static void vtkWrapXML_ApplyUsings(
+  wrapxml_state_t *w, NamespaceInfo *data, ClassInfo *classInfo)
 {
+  unsigned long i;
+
+  if (classInfo->ItemType != VTK_NAMESPACE_INFO &&
+      classInfo->NumberOfSuperClasses)
+    {
+    vtkParseMerge_ApplyUsingDeclarations(
+      w->session, w->data, data, classInfo);
+    }
+
+  for (i = 0; i < classInfo->NumberOfClasses; i++)
+    {
+    vtkWrapXML_ApplyUsings(w, data, classInfo->Classes[i]);
+    }
+
+  for (i = 0; i < classInfo->NumberOfNamespaces; i++)
+    {
+    vtkWrapXML_ApplyUsings(
+      w, classInfo->Namespaces[i], classInfo->Namespaces[i]);
+    }
+}
+
+/* Write the data for one header in binary form, instead of as XML */
+static void vtkWrapXML_WriteFileInfo(
+  MergeSession *session, wrapxml_buffer_t *out, FileInfo *data,
+  const char *filename, const wrapxml_manifest_t *manifest,
+  wrapxml_entry_t *entry)
+{
+  wrapxml_state_t ws;
+  char *packed;
+  size_t size;
+
+  ws.data = data;
+  ws.session = session;
+  ws.out = out;
+  ws.indentation = 0;
+  ws.unclosed = 0;
+
+  /* apply the using declarations, as is done for the XML */
+  vtkWrapXML_ApplyUsings(&ws, data->Contents, data->Contents);
+
+  packed = vtkParseBinary_Pack(data, &size);
+  if (packed == NULL)
+    {
+    fprintf(stderr, "Data is too large for output file %s\n", filename);
+    exit(1);
+    }
+  vtkWrapXML_AppendText(&ws, packed, size);
+  free(packed);
+
+  /* write the file, if it changed */
+  vtkWrapXML_Flush(&ws, filename, manifest, entry);
+}
+
+/* Print the records of a binary file that was written with "--fileinfo",
+ * this allows the files to be checked without parsing the headers */
+static void vtkWrapXML_DumpFileInfo(const OptionInfo *options)
+{
+  BinaryFileInfo *info;
   FILE *fp;
+
+  info = vtkParseBinary_ReadFile(options->InputFileName);
+  if (info == NULL)
+    {
+    fprintf(stderr, "Unable to read binary file %s\n",
+            options->InputFileName);
+    exit(1);
+    }
+
+  fp = fopen(options->OutputFileName, "w");
+  if (fp == NULL)
+    {
+    fprintf(stderr, "Error opening output file %s\n",
+            options->OutputFileName);
+    exit(1);
+    }
+
+  vtkParseBinary_Print(fp, info);
+  fclose(fp);
+
+  vtkParseBinary_Free(info);
+}
+
+/* Read the manifest that was written by the previous run, the manifest
+ * will be empty if the file does not exist */
+static void vtkWrapXML_ReadManifest(
+  wrapxml_manifest_t *manifest, const char *filename)
+{
+  struct stat fs;
+  FILE *fp;
+  wrapxml_entry_t entry;
+  char *cp;
+  char *ep;
+  size_t n;
+  int k;
+
+  manifest->count = 0;
+  manifest->entries = NULL;
+  manifest->text = NULL;
+  manifest->mtime = 0;
+
+  if (stat(filename, &fs) != 0)
+    {
+    return;
+    }
+
+  fp = fopen(filename, "rb");
+  if (!fp)
+    {
+    return;
+    }
+
+  n = (size_t)fs.st_size;
+  manifest->text = (char *)malloc(n + 1);
+  n = fread(manifest->text, 1, n, fp);
+  manifest->text[n] = '\0';
+  manifest->mtime = fs.st_mtime;
+  fclose(fp);
+
+  /* each line is "<hash> <size> <filename>", bad lines are skipped */
+  for (cp = manifest->text; *cp != '\0'; cp = ep)
+    {
+    ep = cp + strcspn(cp, "\n");
+    if (*ep == '\n')
+      {
+      *ep++ = '\0';
+      }
+
+    entry.hash = 0;
+    for (k = 0; isxdigit((unsigned char)*cp); k++, cp++)
+      {
+      entry.hash = (entry.hash << 4) |
+        (*cp <= '9' ? *cp - '0' : (*cp | 0x20) - 'a' + 10);
+      }
+    if (k != 16 || *cp != ' ' || !isdigit((unsigned char)cp[1]))
+      {
+      continue;
+      }
+
+    entry.size = (size_t)strtoul(&cp[1], &cp, 10);
+    if (*cp != ' ' || cp[1] == '\0')
+      {
+      continue;
+      }
+    entry.filename = &cp[1];
+
+    /* if count is a power of two, allocate more space */
+    if (manifest->count == 0)
+      {
+      manifest->entries = (wrapxml_entry_t *)malloc(
+        sizeof(wrapxml_entry_t));
+      }
+    else if ((manifest->count & (manifest->count - 1)) == 0)
+      {
+      manifest->entries = (wrapxml_entry_t *)realloc(
+        manifest->entries, 2*manifest->count*sizeof(wrapxml_entry_t));
+      }
+    manifest->entries[manifest->count++] = entry;
+    }
+
+  if (manifest->count > 1)
+    {
+    qsort(manifest->entries, manifest->count, sizeof(wrapxml_entry_t),
+          vtkWrapXML_CompareEntries);
+    }
+}
+
+/* Write the manifest, with one line per output file in batch order */
+static void vtkWrapXML_WriteManifest(
+  const char *filename, const wrapxml_entry_t *entries, int n)
+{
+  wrapxml_buffer_t out;
+  wrapxml_state_t w;
+  char text[64];
+  int i;
+
+  out.text = NULL;
+  out.length = 0;
+  out.size = 0;
+
+  w.data = NULL;
+  w.session = NULL;
+  w.out = &out;
+  w.indentation = 0;
+  w.unclosed = 0;
+
+  for (i = 0; i < n; i++)
+    {
+    if (entries[i].filename == NULL)
+      {
+      continue;
+      }
+    sprintf(text, "%08lx%08lx %lu ",
+            (unsigned long)(entries[i].hash >> 32),
+            (unsigned long)(entries[i].hash & 0xffffffffUL),
+            (unsigned long)entries[i].size);
+    vtkWrapXML_AppendString(&w, text);
+    vtkWrapXML_AppendString(&w, entries[i].filename);
+    vtkWrapXML_AppendChar(&w, '\n');
+    }
+
+  vtkWrapXML_WriteIfChanged(filename, out.text, out.length, NULL, NULL);
+
+  free(out.text);
+}
+
+/* Write the kit, which holds the XML for all of the headers in batch
+ * order, and the index that gives the position of each class */
+static void vtkWrapXML_WriteKit(
+  const char *kitfile, const char *indexfile, const wrapxml_part_t *parts,
+  int n, const wrapxml_manifest_t *manifest, wrapxml_entry_t *entries)
+{
+  wrapxml_buffer_t kit;
+  wrapxml_buffer_t index;
+  wrapxml_state_t w;
+  const char *name;
+  char text[64];
+  size_t offset;
+  int i, j;
+
+  kit.text = NULL;
+  kit.length = 0;
+  kit.size = 0;
+  index = kit;
+
+  w.data = NULL;
+  w.session = NULL;
+  w.out = &kit;
+  w.indentation = 0;
+  w.unclosed = 0;
+
+  vtkWrapXML_AppendLiteral(&w, "<kit>\n");
+  for (i = 0; i < n; i++)
+    {
+    w.out = &kit;
+    offset = kit.length;
+    vtkWrapXML_AppendText(&w, parts[i].text, parts[i].length);
+
+    /* each offset is the position of a complete "file" element */
+    w.out = &index;
+    name = parts[i].names;
+    for (j = 0; j < parts[i].count; j++)
+      {
+      sprintf(text, " %lu %lu\n",
+              (unsigned long)offset, (unsigned long)parts[i].length);
+      vtkWrapXML_AppendString(&w, name);
+      vtkWrapXML_AppendString(&w, text);
+      name += strlen(name) + 1;
+      }
+    }
+  w.out = &kit;
+  vtkWrapXML_AppendLiteral(&w, "</kit>\n");
+
+  vtkWrapXML_Flush(&w, kitfile, manifest, &entries[0]);
+  free(kit.text);
+
+  if (indexfile)
+    {
+    w.out = &index;
+    vtkWrapXML_Flush(&w, indexfile, manifest, &entries[1]);
+    }
+  free(index.text);
+}
+
+/* Get the size of a file, for deciding which files to parse first */
+static size_t vtkWrapXML_FileSize(const char *filename)
+{
+  struct stat fs;
+
+  if (stat(filename, &fs) != 0)
+    {
+    return 0;
+    }
+
+  return (size_t)fs.st_size;
+}
+
+/* Parse and wrap one header, this is called by the thread pool */
+static void vtkWrapXML_WrapHeader(void *arg, int worker, int i)
+{
+  wrapxml_jobs_t *jobs = (wrapxml_jobs_t *)arg;
   FileInfo *data;
   OptionInfo *options;
-  wrapxml_state_t ws;
+
+  /* parse the header, get the options for this header */
+  data = vtkParse_MainBatchFileWithContext(jobs->contexts[worker], i);
+  options = vtkParse_GetBatchOptions(i);
+
+  if (options->IsFileInfo)
+    {
+    vtkWrapXML_WriteFileInfo(
+      jobs->session, &jobs->buffers[worker], data, options->OutputFileName,
+      jobs->manifest, &jobs->entries[i]);
+    }
+  else
+    {
+    vtkWrapXML_WriteFile(
+      jobs->session, &jobs->buffers[worker], data, options->OutputFileName,
+      jobs->manifest, &jobs->entries[i],
+      (jobs->parts ? &jobs->parts[i] : NULL));
+    }
+
+  vtkParse_Free(data);
+}
+
+int main(int argc, char *argv[])
+{
+  wrapxml_jobs_t jobs;
+  wrapxml_manifest_t manifest;
+  OptionInfo *options;
+  const char *manifestfile;
+  vtkParseContext **contexts;
+  size_t *costs;
+  int i, n, nthreads;
 
   /* recurse through included headers (off for now) */
   vtkParse_SetRecursive(0);
@@ -1558,42 +2339,116 @@ int main(int argc, char *argv[])
   /* pre-define a macro to identify the language */
   vtkParse_DefineMacro("__VTK_WRAP_XML__", 0);
 
-  /* handle args, parse header, get output file handle */
-  data = vtkParse_Main(argc, argv);
-
-  /* get the command-line options */
+  /* handle args, get the number of headers (more than one for batch) */
+  n = vtkParse_MainBatch(argc, argv);
   options = vtkParse_GetCommandLineOptions();
 
-  /* get the output file */
-  fp = fopen(options->OutputFileName, "w");
+  if (options->IndexFileName && !options->KitFileName)
+    {
+    fprintf(stderr, "The \"--index\" option requires \"--kit\".\n");
+    exit(1);
+    }
 
-  if (!fp)
+  if (options->IsFileInfo && options->KitFileName)
     {
-    fprintf(stderr, "Error opening output file %s\n", options->OutputFileName);
+    fprintf(stderr, "The \"--fileinfo\" option cannot be used with "
+            "\"--kit\".\n");
     exit(1);
     }
 
-  /* a struct to keep track of things */
-  ws.data = data;
-  ws.file = fp;
-  ws.indentation = 0;
-  ws.unclosed = 0;
+  if (options->IsDump)
+    {
+    if (options->KitFileName)
+      {
+      fprintf(stderr, "The \"--dump\" option cannot be used with "
+              "\"--kit\".\n");
+      exit(1);
+      }
+    for (i = 0; i < n; i++)
+      {
+      vtkWrapXML_DumpFileInfo(vtkParse_GetBatchOptions(i));
+      }
+    return 0;
+    }
 
-  /* print the lead-in */
-  vtkWrapXML_FileHeader(&ws, data);
+  /* each thread needs its own parser context */
+  nthreads = vtkParseThreads_NumberOfWorkers(options->NumberOfThreads, n);
+  contexts = (vtkParseContext **)malloc(
+    nthreads*sizeof(vtkParseContext *));
+  for (i = 0; i < nthreads; i++)
+    {
+    contexts[i] = vtkParse_NewContext();
+    }
 
-  /* print the documentation */
-  vtkWrapXML_FileDoc(&ws, data);
+  /* the largest headers will be parsed first */
+  costs = (size_t *)malloc(n*sizeof(size_t));
+  for (i = 0; i < n; i++)
+    {
+    costs[i] = vtkWrapXML_FileSize(vtkParse_GetBatchOptions(i)->InputFileName);
+    }
 
-  /* print the main body */
-  vtkWrapXML_Body(&ws, data->Contents);
+  /* each thread reuses its own output buffer */
+  jobs.buffers = (wrapxml_buffer_t *)calloc(
+    nthreads, sizeof(wrapxml_buffer_t));
 
-  /* print the closing tag */
-  vtkWrapXML_FileFooter(&ws, data);
+  /* the hierarchy and hints are loaded once and shared by all headers */
+  jobs.contexts = contexts;
+  jobs.session = vtkParseMerge_NewSession(
+    options->HierarchyFileName, vtkParse_GetHintTable());
 
-  fclose(fp);
+  /* the old manifest tells which outputs are already up to date */
+  manifestfile = options->ManifestFileName;
+  jobs.manifest = NULL;
+  if (manifestfile)
+    {
+    vtkWrapXML_ReadManifest(&manifest, manifestfile);
+    jobs.manifest = &manifest;
+    }
+  /* the manifest has an entry for each header, the kit, and the index */
+  jobs.entries = (wrapxml_entry_t *)calloc(n + 2, sizeof(wrapxml_entry_t));
 
-  vtkParse_Free(data);
+  /* the output for each header is kept until the kit is written */
+  jobs.parts = NULL;
+  if (options->KitFileName)
+    {
+    jobs.parts = (wrapxml_part_t *)malloc(n*sizeof(wrapxml_part_t));
+    }
+
+  vtkParseThreads_Run(nthreads, n, costs, vtkWrapXML_WrapHeader, &jobs);
+
+  if (jobs.parts)
+    {
+    vtkWrapXML_WriteKit(
+      options->KitFileName, options->IndexFileName, jobs.parts, n,
+      jobs.manifest, &jobs.entries[n]);
+    for (i = 0; i < n; i++)
+      {
+      free(jobs.parts[i].text);
+      free(jobs.parts[i].names);
+      }
+    free(jobs.parts);
+    }
+
+  /* write the new manifest after all of the outputs are written */
+  if (manifestfile)
+    {
+    vtkWrapXML_WriteManifest(manifestfile, jobs.entries, n + 2);
+    free(manifest.entries);
+    free(manifest.text);
+    }
+  free(jobs.entries);
+
+  /* free the session, including the superclass headers it parsed */
+  vtkParseMerge_FreeSession(jobs.session);
+
+  for (i = 0; i < nthreads; i++)
+    {
+    vtkParse_FreeContext(contexts[i]);
+    free(jobs.buffers[i].text);
+    }
+  free(jobs.buffers);
+  free(contexts);
+  free(costs);
 
   return 0;
 }